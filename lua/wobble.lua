@@ -0,0 +1,10 @@
+-- Swarm embedded script cursor: orbits the mouse on a slowly breathing ellipse
+-- {"op":"cursor/add", "behavior":"script", "script":"C:/path/to/wobble.lua"}
+r = 60 + math.random(40)
+phase = math.random() * math.pi * 2
+
+function update(dt, mouse)
+  local w = 2 + math.sin(t * 0.5)
+  x = mouse.x + math.cos(t * w + phase) * r
+  y = mouse.y + math.sin(t * w * 1.5 + phase) * r * 0.6
+end
@@ -0,0 +1,39 @@
+// Example native behavior plugin: damped springs chasing the system cursor
+// Build target SwarmSpringPlugin (lands in plugins\ next to SwarmOverlay.exe), then:
+//   {"op":"cursor/add","behavior":"plugin:spring","params":{"stiffness":80,"damping":6,"offsetX":40}}
+// Only swarm_plugin.h is shared with the overlay; everything crosses the boundary as plain C.
+#include "swarm_plugin.h"
+
+enum { kStiffness, kDamping, kOffsetX, kOffsetY, kVx, kVy, kParamCount };
+
+static const SwarmParamDesc kParams[kParamCount] = {
+    { "stiffness", 60.0f, 1.0f, 1000.0f, 0 },  // 1/s^2
+    { "damping", 8.0f, 0.0f, 200.0f, 0 },      // 1/s
+    { "offsetX", 0.0f, -2000.0f, 2000.0f, 0 }, // rest point relative to the system cursor
+    { "offsetY", 0.0f, -2000.0f, 2000.0f, 0 },
+    { "vx", 0.0f, -1e6f, 1e6f, SWARM_PARAM_STATE },
+    { "vy", 0.0f, -1e6f, 1e6f, SWARM_PARAM_STATE },
+};
+
+// Semi-implicit Euler per cursor; plain loops over the SoA arrays vectorize
+static void SpringUpdate(void *, const SwarmBehaviorSpan *s, float dt, float sysX, float sysY) {
+    float *k = s->params[kStiffness], *c = s->params[kDamping], *ox = s->params[kOffsetX], *oy = s->params[kOffsetY];
+    float *vx = s->params[kVx], *vy = s->params[kVy];
+    for(size_t i = 0; i < s->count; i++) {
+        vx[i] += (k[i] * (sysX + ox[i] - s->x[i]) - c[i] * vx[i]) * dt;
+        vy[i] += (k[i] * (sysY + oy[i] - s->y[i]) - c[i] * vy[i]) * dt;
+        s->x[i] += vx[i] * dt;
+        s->y[i] += vy[i] * dt;
+    }
+}
+
+extern "C" SWARM_PLUGIN_EXPORT int SwarmPluginInit(const SwarmHost *host) {
+    if(host->apiVersion != SWARM_PLUGIN_API_VERSION) return 1;
+    SwarmBehaviorDesc d {};
+    d.structSize = sizeof(d);
+    d.name = "spring";
+    d.params = kParams;
+    d.paramCount = kParamCount;
+    d.update = SpringUpdate;
+    return host->registerBehavior(host->context, &d);
+}
@@ -1,6 +1,8 @@
 // SwarmOverlay expanded prototype
 // Provides: multiple virtual cursors with behaviors + named pipe IPC
 
+#include <winsock2.h> // before <windows.h>, which would pull in the old winsock.h
+#include <ws2tcpip.h>
 #include <windows.h>
 #include <vector>
 #include <string>
@@ -8,10 +10,12 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <chrono>
 #include <commdlg.h> // for file dialogs
 #include <map>
 #include <cctype>
+#include <cwctype>
 #include <sstream>
 #include <optional>
 #include <algorithm>
@@ -22,6 +26,28 @@
 #include <atomic>
 #include <chrono>
 #include <unordered_map>
+#include <deque>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <string_view>
+#include <d3d11.h>
+#include <dxgi1_2.h>
+#include <d2d1_2.h>
+#include <dwrite.h>
+#include <dcomp.h>
+#include <wrl/client.h>
+#include "swarm_simd.h"
+#include "swarm_ring.h"
+#include "swarm_command.h"
+#include "swarm_profile.h"
+#include "swarm_trace.h"
+#include "swarm_manager.h"
+#include "swarm_record.h"
+#include "swarm_heartbeat.h"
+#include "swarm_net.h"
+
+using Microsoft::WRL::ComPtr;
 
 /*
  Swarm prototype
@@ -30,238 +56,757 @@
  - Future: independent scripted behaviors, AHK integration via IPC or shared memory
 */
 
-enum class BehaviorType { Mirror, Static, Orbit, FollowLag, Script };
-
-struct SwarmCursor {
-    int id {0};
-    BehaviorType behavior {BehaviorType::Mirror};
-    POINT pos {0,0}; // current render position
-    POINT target {0,0}; // for static / follow
-    COLORREF color {RGB(255,0,0)};
-    int size {12};
-    // behavior params
-    double offsetX {0};
-    double offsetY {0};
-    double radius {60};
-    double angle {0};
-    double speed {1}; // radians per second for orbit
-    double lagMs {120};
-    // For FollowLag EMA
-    bool initialized {false};
-    // Script integration
-    std::string scriptPath;              // .ahk path when behavior==Script
-    PROCESS_INFORMATION scriptPi{0};
-    bool scriptProcessRunning {false};
-};
+static SwarmManager gManager;
+static std::atomic<bool> gSolidMode {false};
+// Render backend: GDI color-key (WM_PAINT), per-pixel alpha via UpdateLayeredWindow, or Direct2D on DirectComposition
+enum class RenderMode { Gdi, Ulw, D2d };
+static const char *RenderModeName(RenderMode m) { return m==RenderMode::Ulw ? "ulw" : (m==RenderMode::D2d ? "d2d" : "gdi"); }
 
-class SwarmManager {
+// Backend interface: UpdateThread hands each frame's damage to frame(), WndProc forwards WM_PAINT to paint()
+class OverlayRenderer {
 public:
-    std::vector<SwarmCursor> cursors;
-    std::mutex mtx;
-    std::atomic<bool> running {true};
-    HWND overlayWnd {nullptr};
-    std::atomic<int> nextId {1};
-
-    int addCursor(const SwarmCursor &base) {
-        std::lock_guard<std::mutex> lock(mtx);
-        SwarmCursor c = base;
-        if(c.id==0) c.id = nextId++;
-        cursors.push_back(c);
-        return c.id;
-    }
-    bool removeCursor(int id) {
-        std::lock_guard<std::mutex> lock(mtx);
-        auto it = std::remove_if(cursors.begin(), cursors.end(), [&](auto &c){return c.id==id;});
-        if(it==cursors.end()) return false;
-        cursors.erase(it, cursors.end());
-        return true;
-    }
-    std::optional<SwarmCursor> getCursorCopy(int id) {
-        std::lock_guard<std::mutex> lock(mtx);
-        for(auto &c: cursors) {
-            if(c.id==id) return c;
-        }
-        return std::nullopt;
-    }
-    void updateAll(double dt, POINT systemPos) {
-        std::lock_guard<std::mutex> lock(mtx);
-        for(auto &c : cursors) {
-            switch(c.behavior) {
-                case BehaviorType::Mirror: {
-                    c.pos.x = (LONG)(systemPos.x + c.offsetX);
-                    c.pos.y = (LONG)(systemPos.y + c.offsetY);
-                } break;
-                case BehaviorType::Static: {
-                    c.pos = c.target;
-                } break;
-                case BehaviorType::Orbit: {
-                    c.angle += c.speed * dt;
-                    c.pos.x = (LONG)(systemPos.x + cos(c.angle) * c.radius);
-                    c.pos.y = (LONG)(systemPos.y + sin(c.angle) * c.radius);
-                } break;
-                case BehaviorType::FollowLag: {
-                    if(!c.initialized) { c.pos = systemPos; c.initialized=true; }
-                    double alpha = dt * 1000.0 / (c.lagMs > 1 ? c.lagMs : 1); // proportion per frame
-                    if(alpha>1) alpha=1;
-                    c.pos.x = (LONG)(c.pos.x + (systemPos.x - c.pos.x)*alpha);
-                    c.pos.y = (LONG)(c.pos.y + (systemPos.y - c.pos.y)*alpha);
-                } break;
-            }
-        }
-    }
+    virtual ~OverlayRenderer() = default;
+    virtual RenderMode mode() const = 0;
+    // false => window must be created with WS_EX_NOREDIRECTIONBITMAP (composition swap chain)
+    virtual bool needsRedirection() const { return true; }
+    virtual bool attach(HWND hWnd) = 0;                                // UI thread, after the window is prepared
+    virtual void detach() {}                                           // UI thread, before the window goes away
+    virtual void applyBackground(HWND) {}                              // solid debug background toggled
+    virtual void frame(HWND hWnd, const std::vector<RECT> &dirty) = 0; // UpdateThread, once per frame
+    virtual void paint(HWND hWnd) { PAINTSTRUCT ps; BeginPaint(hWnd, &ps); EndPaint(hWnd, &ps); }
+    RECT bounds {};                  // screen rect the window covers; cursors and damage are in screen pixels
+    std::atomic<bool> needsFull {true}; // next frame must redraw + present the whole surface
 };
-
-// Draw a simple arrow (cursor-like) shape centered at (cx,cy)
-// size ~= overall height of arrow
-static void DrawCursorShape(HDC hdc, int cx, int cy, int size, COLORREF color) {
-    // Base arrow coordinates (approx Windows arrow) in a 28px height box, origin at (0,0)
-    // Points (x,y): tip at (0,0), down to (0,20), across to (6,14), to (11,28), (15,26), (9,13), (20,13), back to tip
-    POINT base[] = {
-        {0,0},{0,20},{6,14},{11,28},{15,26},{9,13},{20,13}
-    };
-    const int n = (int)(sizeof(base)/sizeof(base[0]));
-    double scale = size / 28.0; // scale height
-    // Determine width for centering (approx max x)
-    int maxX = 20; int maxY = 28;
-    int w = (int)(maxX * scale);
-    int h = (int)(maxY * scale);
-    int ox = cx - w/2; // shift so shape centered at (cx,cy)
-    int oy = cy - h/2;
-    POINT pts[16];
-    for(int i=0;i<n;i++) {
-        pts[i].x = (LONG)(ox + base[i].x * scale);
-        pts[i].y = (LONG)(oy + base[i].y * scale);
-    }
-    HBRUSH b = CreateSolidBrush(color);
-    HBRUSH old = (HBRUSH)SelectObject(hdc, b);
-    HPEN pen = CreatePen(PS_SOLID, 1, color);
-    HPEN oldPen = (HPEN)SelectObject(hdc, pen);
-    Polygon(hdc, pts, n);
-    SelectObject(hdc, oldPen);
-    DeleteObject(pen);
-    SelectObject(hdc, old);
-    DeleteObject(b);
-}
-
-static SwarmManager gManager;
-static std::atomic<bool> gSolidMode {false};
+// One layered overlay per monitor, each with its own backend sized to that monitor, so a frame only clears
+// and paints the monitors its damage touches. [0] is the primary monitor's window, gManager.overlayWnd
+// (hotkeys, raw input, render switches, quit). The list is replaced on the UI thread only, so the UI
+// thread reads it without gRenderMtx. Nothing holding gRenderMtx may wait on the UI thread
+// (SendMessage, SetWindowPos, SetLayeredWindowAttributes) or do I/O.
+struct OverlaySurface {
+    HWND hwnd {nullptr};
+    RECT bounds {};
+    UINT dpi {96};
+    std::unique_ptr<OverlayRenderer> renderer;
+};
+static std::mutex gRenderMtx; // guards gSurfaces (frame vs paint vs backend switch / display rebuild)
+static std::vector<OverlaySurface> gSurfaces;
+static std::atomic<RenderMode> gRenderMode {RenderMode::Gdi};
+static std::atomic<int> gDisplayEpoch {0};        // bumped on WM_DISPLAYCHANGE (frame pacer re-reads the refresh rate)
+static const UINT WM_APP_SET_RENDER = WM_APP + 1; // wParam = RenderMode; switched on the UI thread
+static const UINT WM_APP_APPLY_BACKGROUND = WM_APP + 2; // solid/color-key background, applied on the UI thread
 // (windowed/overlay mode flags removed in simplified always-overlay build)
-static std::mutex gOutPipeMtx; // protects outbound pipe writes
-static HANDLE gOutPipe = INVALID_HANDLE_VALUE; // outbound event stream
-static std::atomic<bool> gOutPipeReady {false};
-static bool gShowHelp = true; // draw help text overlay in windowed mode for user guidance
+static std::atomic<bool> gShowHelp {true}; // draw help text overlay in windowed mode for user guidance
 static HHOOK gLLHook = nullptr; // low-level keyboard hook for Alt combos
-// Allow multiple simultaneous inbound clients to avoid ERROR_PIPE_BUSY.
-static const int kMaxInboundInstances = 16; // maximum instances parameter passed to CreateNamedPipe
-static const int kInboundListenerCount = 8; // number of concurrent listener threads (simultaneous pending ConnectNamedPipe)
 // Performance metrics
 static std::atomic<double> gAvgFrameMs {16.0};
 static std::atomic<double> gLastFPS {60.0};
+static std::atomic<double> gAvgRenderMs {0.0}; // EMA of render cost (WM_PAINT or ULW frame)
+static std::atomic<unsigned long long> gFrameCount {0}; // UpdateThread frames (stream "frame" numbers)
+static std::atomic<unsigned long long> gIdlePolls {0};  // UpdateThread idle-gate polls (heartbeat progress while idle)
 // Heartbeat control
 static std::atomic<bool> gHeartbeatRunning {true};
-static const char* kStateFile = "swarm_state.jsonl";
+static const char* kStateFile = "swarm_state.bin";       // state/save (binary snapshot)
+static const char* kStateTextFile = "swarm_state.jsonl"; // state/save {"mode":"jsonl"}; state/load falls back to it
 static const char* kConfigFile = "swarm_config.jsonl";
-static const char* kHeartbeatFile = "swarm_heartbeat.txt";
+static const char* kRecordingFile = "swarm_recording.swrec"; // record/start and play/start without a path
 static std::atomic<int> gApiCommandCount {0};
 static std::string gAhkExePath = "AutoHotkey64.exe"; // configurable via setAhk command
 
 // Forward declaration because script pipe reader feeds commands back
-void handleCommand(const std::string &line);
-
-// ---------------- Script per-cursor inbound pipe (script -> overlay) ---------------
-struct ScriptPipeInfo {
-    int id{0};
-    std::wstring pipeNameW; // \\.\pipe\SwarmScript_<id>
-    HANDLE pipe = INVALID_HANDLE_VALUE;
-    std::atomic<bool> running{true};
-    std::thread th;
+void handleCommand(std::string_view line);
+void sendOut(const std::string &line, uint64_t coalesceKey = 0);
+static void RingStats(unsigned long long &applied, unsigned long long &rejected, unsigned long long &dropped);
+static double SetStreamRate(int subscriber, double hz);
+static void StreamSubscriberClosed(int subscriber);
+static std::string StreamSubscription(int subscriber, const swarm_cmd::Command &k);
+
+// ---------------- Frame pacing ----------------
+// UpdateThread waits on a high-resolution waitable timer for an absolute per-frame deadline
+// (sleep_for rounds up to the 15.6 ms system tick: 15/31 ms judder). fps 0 follows the primary
+// display's refresh rate. The last kHistory frame times are kept so perf reports percentiles.
+class FramePacer {
+    using Clock = std::chrono::steady_clock;
+    HANDLE timer {nullptr};
+    bool highRes {false};
+    Clock::time_point next {};
+    std::atomic<int> displayHz {60};
+    int displayEpoch {-1}; // UpdateThread only
+    std::mutex histMtx;
+    std::array<float, 512> hist {};
+    size_t histCount {0};
+public:
+    std::atomic<double> targetFps {0}; // 0 = display refresh rate
+    std::atomic<double> maxDtMs {50};  // dt handed to updateAll is capped at this (stalls, breakpoints, drags)
+    std::atomic<unsigned long long> late {0}, clamped {0};
+    struct Stats { double p50, p95, p99, max; };
+
+    ~FramePacer() { if(timer) CloseHandle(timer); }
+    void open() {
+        timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        highRes = timer != nullptr;
+        if(!timer) timer = CreateWaitableTimerW(nullptr, FALSE, nullptr); // pre-1803: still better than sleep_for
+        printf("Frame pacing: %s waitable timer\n", highRes ? "high-resolution" : timer ? "standard" : "no");
+    }
+    bool isHighRes() const { return highRes; }
+    double effectiveFps() const {
+        double f = targetFps.load();
+        return std::clamp(f > 0 ? f : (double)displayHz.load(), 10.0, 500.0);
+    }
+    // Block until the next frame deadline. A missed deadline starts a new schedule instead of bursting.
+    void wait() {
+        if(displayEpoch != gDisplayEpoch.load()) { // WM_DISPLAYCHANGE may have switched modes
+            displayEpoch = gDisplayEpoch.load();
+            HDC dc = GetDC(nullptr);
+            int hz = dc ? GetDeviceCaps(dc, VREFRESH) : 0;
+            if(dc) ReleaseDC(nullptr, dc);
+            displayHz = hz > 1 ? hz : 60; // 0/1 = "hardware default"
+        }
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / effectiveFps()));
+        auto now = Clock::now();
+        next = (next == Clock::time_point{}) ? now + period : next + period;
+        if(next <= now) { late++; next = now; return; }
+        LARGE_INTEGER due; due.QuadPart = -(LONGLONG)(std::chrono::duration_cast<std::chrono::nanoseconds>(next - now).count() / 100); // relative, 100 ns
+        if(timer && SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE)) WaitForSingleObject(timer, INFINITE);
+        else std::this_thread::sleep_until(next);
+    }
+    void resync() { next = {}; } // after an idle wait: the gap is not a missed deadline
+    double clampDt(double dt) {
+        double cap = maxDtMs.load() / 1000.0;
+        if(cap > 0 && dt > cap) { clamped++; return cap; }
+        return dt;
+    }
+    void record(double frameMs) {
+        std::lock_guard<std::mutex> lk(histMtx);
+        hist[histCount++ % hist.size()] = (float)frameMs;
+    }
+    Stats stats() {
+        std::array<float, 512> h; size_t n;
+        { std::lock_guard<std::mutex> lk(histMtx); h = hist; n = std::min(histCount, hist.size()); }
+        if(!n) return Stats{0, 0, 0, 0};
+        auto pct = [&](double q) { size_t k = std::min(n-1, (size_t)(q * n)); std::nth_element(h.begin(), h.begin()+k, h.begin()+n); return (double)h[k]; };
+        return Stats{ pct(0.50), pct(0.95), pct(0.99), (double)*std::max_element(h.begin(), h.begin()+n) };
+    }
 };
-static std::mutex gScriptPipeMtx;
-static std::unordered_map<int,std::unique_ptr<ScriptPipeInfo>> gScriptPipes; // by cursor id
+static FramePacer gPacer;
 
-static std::wstring MakeScriptPipeNameW(int id) {
-    wchar_t buf[128]; swprintf(buf,128,L"\\\\.\\pipe\\SwarmScript_%d", id); return buf;
-}
+// ---------------- Idle mode ----------------
+// After kQuietFrames frames in a row with no damage (nothing moved, recolored or needs a full
+// repaint) UpdateThread stops ticking and blocks on ev. Mouse raw input on the overlay, every
+// command, script line and binary frame, and InvalidateOverlay wake it. Ring producers make no
+// syscalls and SetCursorPos movers raise no raw input, so the idle wait polls both every kPollMs.
+class IdleGate {
+    HANDLE ev {nullptr};
+    std::atomic<uint64_t> activity {0};
+public:
+    static constexpr int kQuietFrames = 30;
+    static constexpr DWORD kPollMs = 100;
+    std::atomic<bool> idle {false};
+    std::atomic<unsigned long long> transitions {0}; // active -> idle
+    std::atomic<double> idleMs {0};
 
-static void StopScriptPipe(int id) {
-    std::unique_ptr<ScriptPipeInfo> owned;
+    ~IdleGate() { if(ev) CloseHandle(ev); }
+    void open() { ev = CreateEventW(nullptr, FALSE, FALSE, nullptr); }
+    uint64_t mark() const { return activity.load(); }
+    // Any thread. seq_cst pairs with enter(): either the waker sees idle, or enter() sees the new mark
+    void wake() {
+        activity.fetch_add(1);
+        if(idle.load() && ev) SetEvent(ev);
+    }
+    // UpdateThread: false if something arrived since `since` (the frame start), so stay active
+    bool enter(uint64_t since) {
+        if(!ev) return false;
+        idle = true;
+        if(activity.load() != since) { idle = false; return false; }
+        transitions++;
+        return true;
+    }
+    bool waitOnce() { return WaitForSingleObject(ev, kPollMs) == WAIT_OBJECT_0; }
+    void leave(double ms) { idle = false; idleMs = idleMs.load() + ms; }
+};
+static IdleGate gIdle;
+
+// Full repaint (background mode/help changes); per-cursor damage goes through gManager.dirty
+static void InvalidateOverlay() {
+    gIdle.wake();
+    std::vector<HWND> windows;
     {
-        std::lock_guard<std::mutex> lk(gScriptPipeMtx);
-        auto it = gScriptPipes.find(id);
-        if(it!=gScriptPipes.end()) { owned = std::move(it->second); gScriptPipes.erase(it); }
+        std::lock_guard<std::mutex> lk(gRenderMtx);
+        for(auto &sf : gSurfaces) {
+            if(sf.renderer) sf.renderer->needsFull = true;
+            windows.push_back(sf.hwnd);
+        }
     }
-    if(!owned) return;
-    owned->running=false;
-    if(owned->pipe!=INVALID_HANDLE_VALUE) {
-        CancelIoEx(owned->pipe,nullptr);
-        DisconnectNamedPipe(owned->pipe);
-        CloseHandle(owned->pipe);
+    for(HWND w : windows) InvalidateRect(w, nullptr, FALSE);
+}
+
+// Copy of the overlay windows, for calls that may send messages to the UI thread (not under gRenderMtx)
+static std::vector<HWND> OverlayWindows() {
+    std::lock_guard<std::mutex> lk(gRenderMtx);
+    std::vector<HWND> w;
+    for(auto &sf : gSurfaces) w.push_back(sf.hwnd);
+    return w;
+}
+
+static void RecordRenderMs(double ms) {
+    gAvgRenderMs = gAvgRenderMs.load()*0.9 + ms*0.1;
+    Prof(Probe::Render).record((uint64_t)(ms * 1e6));
+}
+
+// Let the active backend apply the solid/color-key background, then repaint everything. Window attribute
+// calls belong to the UI thread: from any thread this only posts WM_APP_APPLY_BACKGROUND.
+static void ApplyLayeredMode() {
+    if(HWND w = gManager.overlayWnd) PostMessage(w, WM_APP_APPLY_BACKGROUND, 0, 0);
+}
+static void ApplyLayeredModeUi() { // UI thread
+    for(auto &sf : gSurfaces) if(sf.renderer) sf.renderer->applyBackground(sf.hwnd);
+    InvalidateOverlay();
+}
+
+// Backend switches run on the UI thread (D2D needs a window without a redirection bitmap)
+static void SetRenderMode(RenderMode m) {
+    if(gManager.overlayWnd) PostMessage(gManager.overlayWnd, WM_APP_SET_RENDER, (WPARAM)m, 0);
+}
+
+// ---------------- Event hub (SwarmPipeOut subscribers) ----------------
+// sendOut copies an event once into a shared buffer and extracts its name / cursor id once; the hub
+// then fans that same buffer out to every subscriber whose filter matches (event names, cursor ids,
+// max rate). Each subscriber has a bounded queue (full: drop, counted) in which keyed events coalesce
+// in place. One writer thread keeps an overlapped write in flight per subscriber, batching everything
+// queued into a single write, so a stalled reader only stalls (and drops for) itself.
+static const int kMaxSubscribers = 16; // SwarmPipeOut instances
+
+struct OutEvent {
+    std::shared_ptr<const std::string> text; // formatted once, shared by every subscriber
+    std::string_view name;                   // "event" value, points into *text
+    int id {0};                              // first "id" (cursor), 0 = none
+    uint64_t key {0};                        // coalesce key, 0 = never coalesced
+};
+
+static void EventMeta(OutEvent &e) {
+    std::string_view t = *e.text;
+    size_t p = t.find("\"event\":\"");
+    if(p!=std::string_view::npos) { p += 9; size_t q = t.find('"', p); if(q!=std::string_view::npos) e.name = t.substr(p, q-p); }
+    p = t.find("\"id\":");
+    if(p!=std::string_view::npos) { p += 5; std::from_chars(t.data()+p, t.data()+t.size(), e.id); }
+}
+
+// Names / ids from "a,b" or ["a","b"] (both spellings accepted by events/subscribe)
+template<class F> static void ForEachListItem(std::string_view v, F f) {
+    size_t i = 0;
+    while(i < v.size()) {
+        while(i < v.size() && (v[i]=='[' || v[i]==']' || v[i]=='"' || v[i]==',' || v[i]==' ')) i++;
+        size_t s = i;
+        while(i < v.size() && v[i]!='[' && v[i]!=']' && v[i]!='"' && v[i]!=',' && v[i]!=' ') i++;
+        if(i > s) f(v.substr(s, i-s));
     }
-    if(owned->th.joinable()) owned->th.detach();
 }
 
-static void ScriptPipeReader(int id, ScriptPipeInfo *spi) {
-    BOOL connected = ConnectNamedPipe(spi->pipe,nullptr) ? TRUE : (GetLastError()==ERROR_PIPE_CONNECTED);
-    if(!connected) {
-        sendOut(std::string("{\"event\":\"scriptError\",\"id\":")+std::to_string(id)+",\"code\":\"connect\"}\n");
-        return;
+struct EventFilter {
+    std::vector<std::string> events; // empty = every event
+    std::vector<int> ids;            // empty = every cursor; events without an id always pass
+    double maxHz {0};                // events/sec cap (burst of one second), 0 = unlimited
+    bool matches(const OutEvent &e) const {
+        if(!events.empty() && std::find(events.begin(), events.end(), e.name)==events.end()) return false;
+        if(!ids.empty() && e.id && std::find(ids.begin(), ids.end(), e.id)==ids.end()) return false;
+        return true;
+    }
+};
+
+class EventHub {
+public:
+    static const size_t kMaxQueued = 16384; // per subscriber
+    std::atomic<unsigned long long> queued {0}, dropped {0}, coalesced {0}, writes {0}, filtered {0}, rateLimited {0};
+
+    void start() {
+        wake = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        running = true;
+        th = std::thread([this]{ run(); });
+    }
+    // Flushes every queue (bounded: stalled writes are cancelled after 500 ms), then joins the writer
+    void stop() {
+        running = false;
+        if(wake) SetEvent(wake);
+        if(th.joinable()) th.join();
+        if(wake) { CloseHandle(wake); wake = nullptr; }
+    }
+    int subscriberCount() const { return active.load(); }
+
+    // Takes ownership of pipe (the server's handle duplicated, so either side may close first); 0 = full
+    int add(HANDLE pipe) {
+        std::lock_guard<std::mutex> lk(m);
+        if(!running || subs.size() >= (size_t)kMaxSubscribers * 2) { CloseHandle(pipe); return 0; } // *2: retiring entries
+        auto s = std::make_unique<Subscriber>();
+        s->id = nextId++; s->pipe = pipe; s->ev = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        int id = s->id;
+        subs.push_back(std::move(s));
+        active++;
+        return id;
     }
-    sendOut(std::string("{\"event\":\"scriptPipeConnected\",\"id\":")+std::to_string(id)+"}\n");
-    std::string buf; buf.reserve(256);
-    char chunk[128]; DWORD r=0;
-    while(spi->running && ReadFile(spi->pipe, chunk, sizeof(chunk), &r, nullptr)) {
-        if(r==0) break;
-        for(DWORD i=0;i<r;i++) {
-            char c = chunk[i];
-            if(c=='\n' || c=='\r') {
-                if(!buf.empty()) {
-                    std::string line = buf; buf.clear();
-                    std::istringstream iss(line); std::string cmd; iss>>cmd;
-                    if(cmd=="pos") {
-                        double x,y; if(iss>>x>>y) {
-                            std::lock_guard<std::mutex> lk(gManager.mtx);
-                            for(auto &c2: gManager.cursors) if(c2.id==id) { c2.pos.x=(LONG)x; c2.pos.y=(LONG)y; c2.target=c2.pos; }
-                        }
-                    } else if(cmd=="color") {
-                        std::string col; if(iss>>col && col.size()==7 && col[0]=='#') {
-                            auto hx=[&](char ch){ if(ch>='0'&&ch<='9') return ch-'0'; if(ch>='a'&&ch<='f') return 10+ch-'a'; if(ch>='A'&&ch<='F') return 10+ch-'A'; return 0; };
-                            int r2=hx(col[1])*16+hx(col[2]); int g2=hx(col[3])*16+hx(col[4]); int b2=hx(col[5])*16+hx(col[6]);
-                            std::lock_guard<std::mutex> lk(gManager.mtx);
-                            for(auto &c2: gManager.cursors) if(c2.id==id) c2.color=RGB(r2,g2,b2);
-                        }
-                    } else if(cmd=="remove") {
-                        StopScriptPipe(id);
-                        std::string rm = std::string("{\"cmd\":\"remove\",\"id\":")+std::to_string(id)+"}";
-                        handleCommand(rm);
-                    } else if(cmd=="log") {
-                        std::string rest; std::getline(iss,rest); if(!rest.empty() && rest[0]==' ') rest.erase(0,1);
-                        sendOut(std::string("{\"event\":\"scriptLog\",\"id\":")+std::to_string(id)+",\"msg\":\""+rest+"\"}\n");
+    void remove(int id) {
+        std::lock_guard<std::mutex> lk(m);
+        if(Subscriber *s = findLocked(id)) {
+            if(!s->closing) active--;
+            s->closing = true;
+            if(s->busy) CancelIoEx(s->pipe, &s->ov);
+        }
+        SetEvent(wake);
+        StreamSubscriberClosed(id); // its stream/subscribe ends with it
+    }
+    // events/subscribe from subscriber id: replaces its filter
+    void configure(int id, const swarm_cmd::Command &k) {
+        EventFilter f;
+        if(k.has(swarm_cmd::kEvents)) ForEachListItem(k.events, [&](std::string_view n){ f.events.emplace_back(n); });
+        if(k.has(swarm_cmd::kIds)) ForEachListItem(k.ids, [&](std::string_view n){ int v = swarm_cmd::ToNumber<int>(n); if(v) f.ids.push_back(v); });
+        if(k.has(swarm_cmd::kMaxHz) && k.maxHz > 0) f.maxHz = k.maxHz;
+        char buf[160];
+        snprintf(buf, sizeof(buf), "{\"event\":\"subscribed\",\"events\":%zu,\"ids\":%zu,\"maxHz\":%.1f}\n", f.events.size(), f.ids.size(), f.maxHz);
+        {
+            std::lock_guard<std::mutex> lk(m);
+            Subscriber *s = findLocked(id);
+            if(!s) return;
+            s->filter = std::move(f);
+            s->tokens = s->filter.maxHz; s->refill = std::chrono::steady_clock::now();
+        }
+        sendTo(id, buf);
+    }
+    // Fan one event out to every matching subscriber
+    void publish(const std::string &line, uint64_t key) {
+        if(!running || active.load()==0) return; // no reader: events are not kept for a future one
+        OutEvent e = makeEvent(line, key);
+        bool signal = false;
+        {
+            std::lock_guard<std::mutex> lk(m);
+            for(auto &sp : subs) {
+                Subscriber &s = *sp;
+                if(s.closing || s.failed) continue;
+                if(!s.filter.matches(e)) { filtered++; continue; }
+                signal |= enqueueLocked(s, e, true);
+            }
+        }
+        if(signal) SetEvent(wake);
+    }
+    // Direct reply to one subscriber (connected / subscribed / errors): no filter, no rate limit
+    void sendTo(int id, const std::string &line) {
+        OutEvent e = makeEvent(line, 0);
+        bool signal = false;
+        {
+            std::lock_guard<std::mutex> lk(m);
+            if(Subscriber *s = findLocked(id)) if(!s->closing) signal = enqueueLocked(*s, e, false);
+        }
+        if(signal) SetEvent(wake);
+    }
+
+private:
+    struct Subscriber {
+        int id {0};
+        HANDLE pipe {INVALID_HANDLE_VALUE}, ev {nullptr};
+        OVERLAPPED ov {};
+        bool busy {false}, closing {false}, failed {false};
+        EventFilter filter;
+        double tokens {0};
+        std::chrono::steady_clock::time_point refill;
+        std::vector<OutEvent> pending;
+        std::unordered_map<uint64_t, size_t> keyed; // coalesce key -> index in pending
+        std::string buf;                            // in-flight write
+    };
+    std::mutex m; // subs and everything inside them
+    std::vector<std::unique_ptr<Subscriber>> subs; // erased only by the writer thread
+    int nextId {1};
+    HANDLE wake {nullptr};
+    std::atomic<bool> running {false};
+    std::atomic<int> active {0};
+    std::thread th;
+
+    static OutEvent makeEvent(const std::string &line, uint64_t key) {
+        auto text = std::make_shared<std::string>(line);
+        if(text->empty() || text->back()!='\n') text->push_back('\n');
+        OutEvent e; e.text = std::move(text); e.key = key;
+        EventMeta(e);
+        return e;
+    }
+    Subscriber *findLocked(int id) {
+        for(auto &s : subs) if(s->id==id) return s.get();
+        return nullptr;
+    }
+    // True when the writer needs waking (queue was empty)
+    bool enqueueLocked(Subscriber &s, const OutEvent &e, bool limited) {
+        if(e.key) {
+            auto it = s.keyed.find(e.key);
+            if(it!=s.keyed.end()) { s.pending[it->second] = e; coalesced++; return false; }
+        }
+        if(limited && s.filter.maxHz > 0) {
+            auto now = std::chrono::steady_clock::now();
+            s.tokens = std::min(s.filter.maxHz, s.tokens + std::chrono::duration<double>(now - s.refill).count() * s.filter.maxHz);
+            s.refill = now;
+            if(s.tokens < 1.0) { rateLimited++; return false; }
+            s.tokens -= 1.0;
+        }
+        if(s.pending.size() >= kMaxQueued) { dropped++; return false; }
+        if(e.key) s.keyed[e.key] = s.pending.size();
+        s.pending.push_back(e);
+        queued++;
+        return s.pending.size()==1 && !s.busy;
+    }
+    // Everything queued goes out as one overlapped write; low bit on hEvent => no IOCP packet
+    void startWriteLocked(Subscriber &s) {
+        s.buf.clear();
+        for(auto &e : s.pending) s.buf += *e.text;
+        s.pending.clear(); s.keyed.clear();
+        s.ov = OVERLAPPED{}; s.ov.hEvent = (HANDLE)((ULONG_PTR)s.ev | 1);
+        DWORD written = 0;
+        if(WriteFile(s.pipe, s.buf.data(), (DWORD)s.buf.size(), &written, &s.ov)) { writes++; return; }
+        if(GetLastError()==ERROR_IO_PENDING) s.busy = true;
+        else s.failed = true; // reader gone; the pipe server removes it when its read fails
+    }
+    void run() {
+        SWARM_TRACE_THREAD("EventWriter");
+        HANDLE handles[kMaxSubscribers * 2 + 1];
+        Subscriber *waiting[kMaxSubscribers * 2];
+        std::chrono::steady_clock::time_point deadline {};
+        for(;;) {
+            int n = 0; bool pendingAny = false;
+            // Nothing is deferred (rate-limited events are dropped, queues start writing at once), so with
+            // no shutdown deadline the writer sleeps until publish/remove/stop or a write completes
+            DWORD timeout = INFINITE;
+            {
+                std::lock_guard<std::mutex> lk(m);
+                for(auto it = subs.begin(); it != subs.end();) {
+                    Subscriber &s = **it;
+                    if((s.closing || s.failed) && !s.busy) {
+                        if(!s.closing) active--;
+                        dropped += s.pending.size();
+                        CloseHandle(s.pipe); CloseHandle(s.ev);
+                        it = subs.erase(it);
+                        continue;
+                    }
+                    if(!s.busy && !s.pending.empty()) startWriteLocked(s);
+                    if(s.busy) waiting[n++] = &s;
+                    else if(s.failed) timeout = 0; // write failed synchronously: retire it on the next pass
+                    pendingAny |= !s.pending.empty();
+                    ++it;
+                }
+                if(!running) {
+                    auto now = std::chrono::steady_clock::now();
+                    if(deadline==std::chrono::steady_clock::time_point{}) deadline = now + std::chrono::milliseconds(500);
+                    if((n==0 && !pendingAny) || now >= deadline) {
+                        for(int i=0;i<n;i++) { DWORD w; CancelIoEx(waiting[i]->pipe, &waiting[i]->ov); GetOverlappedResult(waiting[i]->pipe, &waiting[i]->ov, &w, TRUE); }
+                        for(auto &s : subs) { CloseHandle(s->pipe); CloseHandle(s->ev); }
+                        subs.clear(); active = 0;
+                        return;
                     }
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+                    timeout = std::min<DWORD>(timeout, (DWORD)left);
                 }
-            } else if(buf.size()<1024) buf.push_back(c);
+            }
+            handles[0] = wake;
+            for(int i=0;i<n;i++) handles[i+1] = waiting[i]->ev;
+            WaitForMultipleObjects((DWORD)n + 1, handles, FALSE, timeout);
+            SWARM_TRACE_ZONE("eventWriteComplete");
+            std::lock_guard<std::mutex> lk(m);
+            for(int i=0;i<n;i++) {
+                Subscriber &s = *waiting[i];
+                DWORD w = 0;
+                if(GetOverlappedResult(s.pipe, &s.ov, &w, FALSE)) { s.busy = false; writes++; }
+                else if(GetLastError()!=ERROR_IO_INCOMPLETE) { s.busy = false; s.failed = true; }
+            }
         }
     }
-    sendOut(std::string("{\"event\":\"scriptExit\",\"id\":")+std::to_string(id)+"}\n");
+};
+static EventHub gEvents;
+
+// Coalesce key for per-cursor state events ("cursor")
+static uint64_t CursorEventKey(int id) { return (1ull << 32) | (uint32_t)id; }
+
+// ---------------- IOCP named pipe server ----------------
+// One completion port serves SwarmPipe (commands), SwarmScript_<id> (script lines) and SwarmPipeOut
+// (events) with overlapped ConnectNamedPipe/ReadFile; kIoWorkerCount threads run every completion, so
+// the number of concurrent clients no longer costs threads and shutdown is a cancel + join.
+static const int kIoWorkerCount = 4;
+static const int kCommandListeners = 4;   // pending SwarmPipe accepts (instances are unlimited)
+static const size_t kMaxCommandLine = 1u << 20; // line mode; batch envelopes make long lines normal
+
+static void HandleScriptLine(int id, uint32_t gen, const std::string &line);
+static void ApplyRecordBatch(const swarm_ring::Record *recs, size_t n);
+
+// One SwarmPipe binary frame (see swarm_ring.h)
+static void HandleBinaryFrame(uint8_t kind, std::string_view payload) {
+    if(kind==swarm_ring::kFrameCommand) handleCommand(payload);
+    else if(kind==swarm_ring::kFrameRecords && payload.size() % sizeof(swarm_ring::Record)==0) {
+        thread_local std::vector<swarm_ring::Record> recs; // payload is not Record-aligned: copy out
+        recs.resize(payload.size() / sizeof(swarm_ring::Record));
+        if(!recs.empty()) memcpy(recs.data(), payload.data(), payload.size());
+        ApplyRecordBatch(recs.data(), recs.size());
+    } else printf("Pipe: bad binary frame kind=%u bytes=%zu\n", kind, payload.size());
 }
 
-static void StartScriptPipe(int id) {
-    auto spi = std::make_unique<ScriptPipeInfo>(); spi->id=id; spi->pipeNameW = MakeScriptPipeNameW(id);
-    spi->pipe = CreateNamedPipeW(spi->pipeNameW.c_str(), PIPE_ACCESS_INBOUND, PIPE_TYPE_BYTE|PIPE_READMODE_BYTE|PIPE_WAIT, 1, 512,512,0,nullptr);
-    if(spi->pipe==INVALID_HANDLE_VALUE) {
-        sendOut(std::string("{\"event\":\"scriptError\",\"id\":")+std::to_string(id)+",\"code\":\"createPipe\"}\n");
-        return;
+class PipeServer {
+public:
+    enum class Kind { Command, Script, Events };
+    enum class Framing : uint8_t { Unknown, Lines, Binary }; // command pipe: decided by the first 4 bytes
+    struct Conn {
+        OVERLAPPED ov {};
+        Kind kind {Kind::Command};
+        HANDLE pipe {INVALID_HANDLE_VALUE};
+        bool connected {false}; // worker thread only
+        int subscriber {0};     // events: EventHub id
+        Framing framing {Framing::Unknown};
+        std::mutex m;           // closing + arming the next overlapped op
+        bool closing {false};
+        int scriptId {0};
+        uint32_t gen {0};       // cursor generation the script pipe was created for
+        char buf[512];
+        std::string line;       // partial line, or partial frames in binary mode
+    };
+
+    bool start() {
+        port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, kIoWorkerCount);
+        if(!port) { printf("PipeServer: CreateIoCompletionPort failed gle=%lu\n", GetLastError()); return false; }
+        for(int i=0;i<kCommandListeners;i++) listen(Kind::Command);
+        ensureEventsAccept();
+        for(int i=0;i<kIoWorkerCount;i++) workers.emplace_back([this]{ worker(); });
+        printf("Pipe server: IOCP with %d workers, %d pending command accepts.\n", kIoWorkerCount, kCommandListeners);
+        return true;
     }
-    ScriptPipeInfo *raw = spi.get();
-    spi->th = std::thread([id,raw]{ ScriptPipeReader(id, raw); });
-    {
-        std::lock_guard<std::mutex> lk(gScriptPipeMtx);
-        gScriptPipes[id] = std::move(spi);
+    // Cancel every pending op, wait (bounded) for the completions, then stop the workers
+    void stop() {
+        if(!port) return;
+        stopping = true;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            for(auto &kv : conns) { std::lock_guard<std::mutex> cl(kv.first->m); kv.first->closing = true; CancelIoEx(kv.first->pipe, nullptr); }
+        }
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            if(!drained.wait_for(lk, std::chrono::seconds(2), [this]{ return conns.empty(); }))
+                printf("Pipe server: %zu connections still busy at shutdown\n", conns.size());
+        }
+        for(size_t i=0;i<workers.size();i++) PostQueuedCompletionStatus(port, 0, 0, nullptr);
+        for(auto &t : workers) t.join();
+        workers.clear();
+        CloseHandle(port); port = nullptr;
+    }
+    bool addScript(int id, uint32_t gen) {
+        stopScript(id);
+        Conn *c = listen(Kind::Script, id, gen);
+        return c != nullptr;
+    }
+    void stopScript(int id) {
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = scripts.find(id);
+        if(it==scripts.end()) return;
+        Conn *c = it->second; scripts.erase(it);
+        std::lock_guard<std::mutex> cl(c->m);
+        c->closing = true;
+        CancelIoEx(c->pipe, nullptr); // pending op completes aborted; an op being handled sees closing on re-arm
+    }
+    size_t connectionCount() { std::lock_guard<std::mutex> lk(mtx); return conns.size(); }
+
+private:
+    HANDLE port {nullptr};
+    std::vector<std::thread> workers;
+    std::mutex mtx; // conns, scripts, eventAccepts
+    int eventAccepts {0}; // SwarmPipeOut instances waiting for a subscriber
+    std::condition_variable drained;
+    std::unordered_map<Conn*, std::unique_ptr<Conn>> conns;
+    std::unordered_map<int, Conn*> scripts;
+    std::atomic<bool> stopping {false};
+
+    Conn *listen(Kind k, int scriptId = 0, uint32_t gen = 0) {
+        if(stopping || !port) return nullptr; // not started: the pipe would be bound to no completion port
+        std::wstring name; DWORD access = PIPE_ACCESS_INBOUND, instances = PIPE_UNLIMITED_INSTANCES, bufSize = 4096;
+        if(k==Kind::Command) name = L"\\\\.\\pipe\\SwarmPipe";
+        else if(k==Kind::Script) { wchar_t b[128]; swprintf(b,128,L"\\\\.\\pipe\\SwarmScript_%d", scriptId); name = b; instances = 1; bufSize = 512; }
+        else { name = L"\\\\.\\pipe\\SwarmPipeOut"; access = PIPE_ACCESS_DUPLEX; instances = kMaxSubscribers; } // duplex: filters in, disconnect seen by the read
+        HANDLE h = CreateNamedPipeW(name.c_str(), access | FILE_FLAG_OVERLAPPED, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+                                    instances, bufSize, bufSize, 0, nullptr);
+        if(h==INVALID_HANDLE_VALUE) { printf("PipeServer: CreateNamedPipe %ls failed gle=%lu\n", name.c_str(), GetLastError()); return nullptr; }
+        auto owned = std::make_unique<Conn>();
+        Conn *c = owned.get();
+        c->kind = k; c->pipe = h; c->scriptId = scriptId; c->gen = gen;
+        if(!CreateIoCompletionPort(h, port, (ULONG_PTR)c, 0)) { CloseHandle(h); return nullptr; }
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            conns[c] = std::move(owned);
+            if(k==Kind::Script) scripts[scriptId] = c;
+            if(k==Kind::Events) eventAccepts++;
+        }
+        if(!arm(c)) { finish(c, false); return nullptr; } // no relisten: avoid a failing CreateNamedPipe loop
+        return c;
+    }
+    // Issue the next overlapped op (accept, then reads). False = closing or failed; caller finishes c.
+    bool arm(Conn *c) {
+        std::lock_guard<std::mutex> cl(c->m);
+        if(c->closing || stopping) return false;
+        c->ov = OVERLAPPED{};
+        if(!c->connected) {
+            if(ConnectNamedPipe(c->pipe, &c->ov)) return true;
+            DWORD gle = GetLastError();
+            if(gle==ERROR_IO_PENDING) return true;
+            if(gle==ERROR_PIPE_CONNECTED) return PostQueuedCompletionStatus(port, 0, (ULONG_PTR)c, &c->ov) != FALSE; // no packet queued for this case
+            return false;
+        }
+        if(ReadFile(c->pipe, c->buf, (DWORD)sizeof(c->buf), nullptr, &c->ov)) return true; // completion still queued
+        return GetLastError()==ERROR_IO_PENDING;
+    }
+    void finish(Conn *c, bool relisten = true) {
+        if(c->connected) {
+            if(c->kind==Kind::Command && c->framing==Framing::Lines && !c->line.empty()) handleCommand(c->line);
+            if(c->kind==Kind::Script) sendOut(std::string("{\"event\":\"scriptExit\",\"id\":")+std::to_string(c->scriptId)+"}\n");
+            if(c->kind==Kind::Events && c->subscriber) gEvents.remove(c->subscriber); // drops its queue
+            DisconnectNamedPipe(c->pipe);
+        }
+        CloseHandle(c->pipe);
+        Kind k = c->kind; bool wasConnected = c->connected;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            auto it = scripts.find(c->scriptId);
+            if(k==Kind::Script && it!=scripts.end() && it->second==c) scripts.erase(it);
+            if(k==Kind::Events && !wasConnected) eventAccepts--;
+            conns.erase(c); // frees c
+            if(conns.empty()) drained.notify_all();
+        }
+        // Keep one subscriber accept pending; replace a command listener that died before any client
+        if(relisten && k==Kind::Events) ensureEventsAccept();
+        if(relisten && k==Kind::Command && !wasConnected) listen(k);
+    }
+    void ensureEventsAccept() {
+        { std::lock_guard<std::mutex> lk(mtx); if(eventAccepts > 0) return; }
+        listen(Kind::Events); // fails with ERROR_PIPE_BUSY while kMaxSubscribers are connected; retried on the next disconnect
+    }
+    void onConnected(Conn *c) {
+        c->connected = true;
+        if(c->kind==Kind::Command) listen(Kind::Command); // keep kCommandListeners accepts pending
+        else if(c->kind==Kind::Events) {
+            { std::lock_guard<std::mutex> lk(mtx); eventAccepts--; }
+            HANDLE dup = nullptr; // the hub's writer owns its own handle to the instance
+            if(DuplicateHandle(GetCurrentProcess(), c->pipe, GetCurrentProcess(), &dup, 0, FALSE, DUPLICATE_SAME_ACCESS))
+                c->subscriber = gEvents.add(dup);
+            if(c->subscriber) gEvents.sendTo(c->subscriber, "{\"event\":\"connected\"}\n");
+            ensureEventsAccept();
+        } else sendOut(std::string("{\"event\":\"scriptPipeConnected\",\"id\":")+std::to_string(c->scriptId)+"}\n");
+    }
+    void feedLines(Conn *c, const char *p, size_t n) {
+        for(size_t i=0;i<n;i++) {
+            char ch = p[i];
+            if(ch=='\n') { if(!c->line.empty()) handleCommand(c->line); c->line.clear(); }
+            else if(c->line.size() < kMaxCommandLine) c->line.push_back(ch); // limit line size
+        }
+    }
+    // False on a malformed length: the connection is dropped (no way to resync)
+    bool feedFrames(Conn *c, const char *p, size_t n) {
+        c->line.append(p, n);
+        size_t off = 0;
+        while(c->line.size() - off >= 4) {
+            uint32_t len; memcpy(&len, c->line.data() + off, 4);
+            if(len==0 || len > swarm_ring::kMaxFrameBytes) { printf("Pipe: binary frame length %u rejected, closing\n", len); return false; }
+            if(c->line.size() - off - 4 < len) break;
+            HandleBinaryFrame((uint8_t)c->line[off+4], std::string_view(c->line.data() + off + 5, len - 1));
+            off += 4 + len;
+        }
+        c->line.erase(0, off);
+        return true;
     }
+    bool onCommandData(Conn *c, const char *p, size_t n) {
+        if(c->framing==Framing::Unknown) {
+            size_t take = std::min(n, sizeof(swarm_ring::kPipeMagic) - c->line.size());
+            c->line.append(p, take); p += take; n -= take;
+            if(memcmp(c->line.data(), swarm_ring::kPipeMagic, c->line.size()) != 0) {
+                c->framing = Framing::Lines;
+                std::string head; head.swap(c->line);
+                feedLines(c, head.data(), head.size());
+            } else if(c->line.size()==sizeof(swarm_ring::kPipeMagic)) {
+                c->framing = Framing::Binary; c->line.clear();
+            } else return true; // magic prefix so far: wait for more bytes
+        }
+        if(c->framing==Framing::Lines) { feedLines(c, p, n); return true; }
+        return feedFrames(c, p, n);
+    }
+    // Lines a subscriber writes on SwarmPipeOut: {"op":"events/subscribe",...}
+    void onSubscriberData(Conn *c, DWORD n) {
+        for(DWORD i=0;i<n;i++) {
+            char ch = c->buf[i];
+            if(ch!='\n') { if(c->line.size() < 4096) c->line.push_back(ch); continue; }
+            swarm_cmd::Command k;
+            if(c->subscriber && swarm_cmd::Parse(c->line, k)) {
+                if(k.op==swarm_cmd::Op::Subscribe) gEvents.configure(c->subscriber, k);
+                else if(k.op==swarm_cmd::Op::StreamSubscribe || k.op==swarm_cmd::Op::StreamUnsubscribe) gEvents.sendTo(c->subscriber, StreamSubscription(c->subscriber, k));
+                else gEvents.sendTo(c->subscriber, std::string("{\"event\":\"error\",\"msg\":\"only events/subscribe and stream/subscribe|unsubscribe are accepted on SwarmPipeOut\"}\n"));
+            }
+            c->line.clear();
+        }
+    }
+    bool onData(Conn *c, DWORD n) {
+        if(c->kind==Kind::Events) { onSubscriberData(c, n); return true; }
+        if(c->kind==Kind::Command) return onCommandData(c, c->buf, n);
+        for(DWORD i=0;i<n;i++) {
+            char ch = c->buf[i];
+            if(ch=='\n' || ch=='\r') { if(!c->line.empty()) HandleScriptLine(c->scriptId, c->gen, c->line); c->line.clear(); }
+            else if(c->line.size() < 1024) c->line.push_back(ch);
+        }
+        return true;
+    }
+    void worker() {
+        SWARM_TRACE_THREAD("PipeWorker");
+        for(;;) {
+            DWORD n = 0; ULONG_PTR key = 0; OVERLAPPED *ov = nullptr;
+            BOOL ok = GetQueuedCompletionStatus(port, &n, &key, &ov, INFINITE);
+            if(!ov) { if(key==0) return; continue; } // quit packet from stop()
+            SWARM_TRACE_ZONE("pipeCompletion");
+            Conn *c = (Conn*)key;
+            if(!c->connected) {
+                if(!ok) { finish(c); continue; }
+                onConnected(c);
+            } else {
+                if(!ok || n==0) { finish(c); continue; } // client closed, broken pipe or cancelled
+                if(!onData(c, n)) { finish(c); continue; }
+            }
+            if(!arm(c)) finish(c);
+        }
+    }
+};
+static PipeServer gPipes;
+
+static void StopScriptPipe(int id) { gPipes.stopScript(id); }
+
+static void HandleScriptLine(int id, uint32_t gen, const std::string &line) {
+    SWARM_TRACE_ZONE("scriptLine");
+    gIdle.wake();
+    std::istringstream iss(line); std::string cmd; iss>>cmd;
+    if(cmd=="pos") {
+        double x,y; if(iss>>x>>y) {
+            ManagerLock lk(gManager.mtx);
+            gManager.setPosLocked(id, (LONG)x, (LONG)y, gen);
+        }
+    } else if(cmd=="color") {
+        std::string col; if(iss>>col && col.size()==7 && col[0]=='#') {
+            auto hx=[&](char ch){ if(ch>='0'&&ch<='9') return ch-'0'; if(ch>='a'&&ch<='f') return 10+ch-'a'; if(ch>='A'&&ch<='F') return 10+ch-'A'; return 0; };
+            int r2=hx(col[1])*16+hx(col[2]); int g2=hx(col[3])*16+hx(col[4]); int b2=hx(col[5])*16+hx(col[6]);
+            ManagerLock lk(gManager.mtx);
+            gManager.modifyLocked(id, [&](SwarmCursor &c2){ c2.color=RGB(r2,g2,b2); }, gen);
+        }
+    } else if(cmd=="remove") {
+        StopScriptPipe(id);
+        std::string rm = std::string("{\"cmd\":\"remove\",\"id\":")+std::to_string(id)+",\"gen\":"+std::to_string(gen)+"}";
+        handleCommand(rm);
+    } else if(cmd=="log") {
+        std::string rest; std::getline(iss,rest); if(!rest.empty() && rest[0]==' ') rest.erase(0,1);
+        sendOut(std::string("{\"event\":\"scriptLog\",\"id\":")+std::to_string(id)+",\"msg\":\""+rest+"\"}\n");
+    }
+}
+
+static std::wstring MakeScriptPipeNameW(int id) {
+    wchar_t buf[128]; swprintf(buf,128,L"\\\\.\\pipe\\SwarmScript_%d", id); return buf;
+}
+
+static void StartScriptPipe(int id, uint32_t gen) {
+    if(!gPipes.addScript(id, gen))
+        sendOut(std::string("{\"event\":\"scriptError\",\"id\":")+std::to_string(id)+",\"code\":\"createPipe\"}\n");
 }
 
 // Forward declarations for new helpers
-void SaveState();
-void LoadState();
+void SaveState(bool text=false);
+void LoadState(bool text=false);
+static void AutosaveIfDue();
 POINT GetCursorPosForId(int id, bool *ok);
 void PerformMouseAction(POINT p, const std::string &action, int button);
 void ReloadConfigIfChanged(bool force=false);
@@ -269,12 +814,20 @@ void ReloadConfigIfChanged(bool force=false);
 // Forward declarations
 // (keyboard hook & overlay key handling removed)
 
-void sendOut(const std::string &line) {
-    std::lock_guard<std::mutex> lock(gOutPipeMtx);
-    if(gOutPipeReady && gOutPipe!=INVALID_HANDLE_VALUE) {
-        std::string data = line; if(data.empty() || data.back()!='\n') data.push_back('\n');
-        DWORD written=0; WriteFile(gOutPipe, data.data(), (DWORD)data.size(), &written, nullptr);
+// "rid" of the command being handled on this thread; set by handleCommand for its duration
+static thread_local std::string_view tRequestId;
+
+void sendOut(const std::string &line, uint64_t coalesceKey) {
+    size_t close;
+    if(!tRequestId.empty() && (close = line.rfind('}')) != std::string::npos) {
+        // Reply to a tagged request: add "rid" and never coalesce it away (the client is timing it)
+        std::string tagged;
+        tagged.reserve(line.size() + tRequestId.size() + 10);
+        tagged.append(line, 0, close).append(",\"rid\":\"").append(tRequestId).append("\"").append(line, close, std::string::npos);
+        gEvents.publish(tagged, 0);
+        return;
     }
+    gEvents.publish(line, coalesceKey); // never blocks on a reader
 }
 
 static void ExecuteHotChar(char ch) {
@@ -283,13 +836,8 @@ static void ExecuteHotChar(char ch) {
             bool newVal = !gSolidMode.load();
             gSolidMode = newVal;
             if(gManager.overlayWnd) {
-                if(newVal) {
-                    SetLayeredWindowAttributes(gManager.overlayWnd, 0, (BYTE)200, LWA_ALPHA);
-                    printf("Hotkey: solid background ON (via %c)\n", ch);
-                } else {
-                    SetLayeredWindowAttributes(gManager.overlayWnd, RGB(0,0,0), 0, LWA_COLORKEY);
-                    printf("Hotkey: solid background OFF (via %c)\n", ch);
-                }
+                ApplyLayeredMode();
+                printf("Hotkey: solid background %s (via %c)\n", newVal?"ON":"OFF", ch);
             }
         } break;
         case 'O': {
@@ -299,7 +847,7 @@ static void ExecuteHotChar(char ch) {
             SwarmCursor c; c.behavior=BehaviorType::FollowLag; c.lagMs=400; c.color=RGB(120,160,255); c.size=12; gManager.addCursor(c); printf("Hotkey: added follow cursor (via %c)\n", ch);
         } break;
         case 'C': {
-            std::lock_guard<std::mutex> lock(gManager.mtx); gManager.cursors.clear(); printf("Hotkey: cleared cursors (via %c)\n", ch);
+            handleCommand("{\"cmd\":\"clear\"}"); printf("Hotkey: cleared cursors (via %c)\n", ch); // also stops script processes
         } break;
         case 'X': {
             printf("Hotkey: exiting (via %c)\n", ch); gManager.running=false; if(gManager.overlayWnd) PostMessage(gManager.overlayWnd, WM_CLOSE, 0,0);
@@ -339,7 +887,7 @@ static void ExecuteHotChar(char ch) {
                 wchar_t fileBuf[512] = L"";
                 OPENFILENAMEW ofn{}; ofn.lStructSize = sizeof(ofn);
                 ofn.hwndOwner = gManager.overlayWnd;
-                ofn.lpstrFilter = L"AutoHotkey Script (*.ahk)\0*.ahk\0All Files (*.*)\0*.*\0";
+                ofn.lpstrFilter = L"Cursor Script (*.ahk;*.lua)\0*.ahk;*.lua\0All Files (*.*)\0*.*\0";
                 ofn.lpstrFile = fileBuf; ofn.nMaxFile = 512;
                 ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
                 if(GetOpenFileNameW(&ofn)) {
@@ -371,38 +919,7 @@ static LRESULT CALLBACK LowLevelKeyboardProc(int code, WPARAM wParam, LPARAM lPa
 
 // (windowed/overlay switching removed)
 
-// --- Minimal JSON-ish parser for flat objects (string/number) ---
-static std::map<std::string,std::string> parseSimpleJson(const std::string &line) {
-    std::map<std::string,std::string> out;
-    size_t i=0; while(i<line.size() && isspace((unsigned char)line[i])) i++;
-    if(i>=line.size() || line[i] != '{') return out; 
-    i++;
-    while(i<line.size()) {
-        while(i<line.size() && isspace((unsigned char)line[i])) i++;
-        if(i<line.size() && line[i]=='}') break;
-    if(line[i] != '"') break; 
-    i++;
-        size_t start=i; while(i<line.size() && line[i] != '"') i++; if(i>=line.size()) break;
-        std::string key = line.substr(start, i-start); i++; // skip closing quote
-        while(i<line.size() && (isspace((unsigned char)line[i])|| line[i]==':')) { if(line[i]==':'){ i++; break;} i++; }
-        while(i<line.size() && isspace((unsigned char)line[i])) i++;
-        std::string value;
-        if(i<line.size() && line[i]=='"') {
-            i++; size_t vstart=i; while(i<line.size() && line[i] != '"') i++; value = line.substr(vstart, i-vstart); if(i<line.size()) i++;
-        } else {
-            size_t vstart=i; while(i<line.size() && line[i] != ',' && line[i] != '}') i++; value = line.substr(vstart, i-vstart);
-            // trim
-            size_t a=0; while(a<value.size() && isspace((unsigned char)value[a])) a++; size_t b=value.size(); while(b> a && isspace((unsigned char)value[b-1])) b--; value = value.substr(a,b-a);
-        }
-        out[key]=value;
-        while(i<line.size() && isspace((unsigned char)line[i])) i++;
-        if(i<line.size() && line[i]==',') { i++; continue; }
-        if(i<line.size() && line[i]=='}') break;
-    }
-    return out;
-}
-
-static COLORREF parseColor(const std::string &s) {
+static COLORREF parseColor(std::string_view s) {
     if(s.size()==7 && s[0]=='#') {
         auto hexVal=[&](char c)->int { if(c>='0'&&c<='9') return c-'0'; if(c>='a'&&c<='f') return 10+c-'a'; if(c>='A'&&c<='F') return 10+c-'A'; return 0; };
         int r = hexVal(s[1])*16 + hexVal(s[2]);
@@ -413,35 +930,95 @@ static COLORREF parseColor(const std::string &s) {
     return RGB(255,255,255);
 }
 
-static BehaviorType parseBehavior(const std::string &b) {
+static BehaviorType parseBehavior(std::string_view b) {
     if(b=="static") return BehaviorType::Static;
     if(b=="orbit") return BehaviorType::Orbit;
     if(b=="follow"||b=="followlag") return BehaviorType::FollowLag;
     if(b=="script") return BehaviorType::Script;
+    if(b=="flock") return BehaviorType::Flock;
     return BehaviorType::Mirror;
 }
 
-static bool LaunchScriptProcess(SwarmCursor &c) {
+static bool IsEmbeddedScript(const std::string &path) {
+    if(path.size() < 5) return false;
+    std::string ext = path.substr(path.size() - 4);
+    for(char &ch : ext) ch = (char)tolower((unsigned char)ch);
+    return ext == ".lua";
+}
+
+// .lua cursors are added under gManager.mtx, but reading and compiling the file must not hold it: the
+// add queues the cursor here, and the caller runs LoadPendingScripts once it has released the lock.
+// The in-process VM needs no process, pipe or thread; a cursor that already has one keeps it.
+struct PendingScript { int id; uint32_t gen; std::string path; };
+static std::mutex gPendingScriptsMtx;
+static std::vector<PendingScript> gPendingScripts;
+
+// Caller holds gManager.mtx
+static bool QueueEmbeddedScript(int id, const std::string &path) {
+    if(gManager.vms.count(id)) return true;
+    std::lock_guard<std::mutex> g(gPendingScriptsMtx);
+    gPendingScripts.push_back(PendingScript{ id, gManager.genLocked(id), path });
+    return true;
+}
+
+// Caller must not hold gManager.mtx
+static bool LoadEmbeddedScript(const PendingScript &p) {
+    std::ifstream in(p.path, std::ios::in | std::ios::binary);
+    std::string src, err;
+    bool opened = (bool)in;
+    if(opened) src.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    auto prog = std::make_shared<swarm_vm::Program>();
+    if(!opened) err = "cannot open";
+    else if(swarm_vm::Compile(src, *prog, err)) { // Compile fills err
+        ManagerLock lock(gManager.mtx);
+        BehaviorType b; size_t i;
+        if(!gManager.findLocked(p.id, b, i, p.gen)) err = "cursor gone"; // removed (or its id reused) meanwhile
+        else if(gManager.vms.count(p.id)) return true;
+        else if(!gManager.attachScriptLocked(p.id, prog)) err = "cursor gone";
+    }
+    if(!err.empty()) {
+        printf("Script load failed id=%d path=%s: %s\n", p.id, p.path.c_str(), err.c_str());
+        for(char &ch : err) if(ch=='"' || ch=='\\') ch = '\'';
+        sendOut(std::string("{\"event\":\"scriptError\",\"id\":")+std::to_string(p.id)+",\"code\":\"compile\",\"msg\":\""+err+"\"}\n");
+        return false;
+    }
+    printf("Script loaded id=%d path=%s (%zu instructions, %zu variables)\n", p.id, p.path.c_str(), prog->code.size(), prog->names.size());
+    char buf[128]; snprintf(buf, sizeof(buf), "{\"event\":\"scriptLoaded\",\"id\":%d,\"instructions\":%zu,\"update\":%s}\n",
+        p.id, prog->code.size(), prog->updatePc >= 0 ? "true" : "false");
+    sendOut(buf);
+    return true;
+}
+
+// Caller must not hold gManager.mtx
+static void LoadPendingScripts() {
+    std::vector<PendingScript> todo;
+    { std::lock_guard<std::mutex> g(gPendingScriptsMtx); todo.swap(gPendingScripts); }
+    for(const PendingScript &p : todo) LoadEmbeddedScript(p);
+}
+
+// Caller holds gManager.mtx
+static bool LaunchScriptProcess(int id, CursorCold &c) {
     if(c.scriptPath.empty()) return false;
-    StartScriptPipe(c.id);
-    std::wstring pipeW = MakeScriptPipeNameW(c.id);
+    if(IsEmbeddedScript(c.scriptPath)) return QueueEmbeddedScript(id, c.scriptPath); // loaded by LoadPendingScripts
+    StartScriptPipe(id, gManager.genLocked(id));
+    std::wstring pipeW = MakeScriptPipeNameW(id);
     std::string pipeName(pipeW.begin(), pipeW.end());
-    std::string cmd = gAhkExePath + " \"" + c.scriptPath + "\" " + std::to_string(c.id) + " " + pipeName;
+    std::string cmd = gAhkExePath + " \"" + c.scriptPath + "\" " + std::to_string(id) + " " + pipeName;
     STARTUPINFOA si{}; si.cb = sizeof(si);
     PROCESS_INFORMATION pi{};
     BOOL ok = CreateProcessA(nullptr, cmd.data(), nullptr,nullptr,FALSE, CREATE_NO_WINDOW, nullptr,nullptr,&si,&pi);
     if(!ok) {
-        printf("Script launch failed id=%d gle=%lu path=%s\n", c.id, GetLastError(), c.scriptPath.c_str());
-        sendOut(std::string("{\"event\":\"scriptError\",\"id\":")+std::to_string(c.id)+",\"code\":\"launchFail\"}\n");
+        printf("Script launch failed id=%d gle=%lu path=%s\n", id, GetLastError(), c.scriptPath.c_str());
+        sendOut(std::string("{\"event\":\"scriptError\",\"id\":")+std::to_string(id)+",\"code\":\"launchFail\"}\n");
         return false;
     }
     c.scriptPi = pi; c.scriptProcessRunning=true;
-    printf("Script launched id=%d pid=%lu path=%s pipe=%s\n", c.id, pi.dwProcessId, c.scriptPath.c_str(), pipeName.c_str());
-    sendOut(std::string("{\"event\":\"scriptLaunched\",\"id\":")+std::to_string(c.id)+"}\n");
+    printf("Script launched id=%d pid=%lu path=%s pipe=%s\n", id, pi.dwProcessId, c.scriptPath.c_str(), pipeName.c_str());
+    sendOut(std::string("{\"event\":\"scriptLaunched\",\"id\":")+std::to_string(id)+"}\n");
     return true;
 }
 
-static void CleanupScriptProcess(SwarmCursor &c) {
+static void CleanupScriptProcess(CursorCold &c) {
     if(!c.scriptProcessRunning) return;
     DWORD res = WaitForSingleObject(c.scriptPi.hProcess, 0);
     if(res!=WAIT_OBJECT_0) {
@@ -453,387 +1030,1092 @@ static void CleanupScriptProcess(SwarmCursor &c) {
     c.scriptProcessRunning=false;
 }
 
-void handleCommand(const std::string &line) {
-    auto kv = parseSimpleJson(line);
-    // New structured protocol prefers 'op' over legacy 'cmd'
-    auto opIt = kv.find("op");
-    if(opIt!=kv.end()) {
-        std::string op = opIt->second; // e.g. "cursor/add"
-        gApiCommandCount++;
-        // Dispatch new ops
-        if(op=="help") {
-            const char *ops[] = {
-                "cursor/add","cursor/update","cursor/remove","cursor/clear","cursor/list",
-                "mouse/click","mouse/down","mouse/up","mouse/drag",
-                "state/save","state/load","state/reload",
-                "sys/exit","sys/perf","config/setAhk","debug/mode"
-            };
-            for(auto &o: ops) { sendOut(std::string("{\"event\":\"help\",\"op\":\"")+o+"\"}\n"); }
-            sendOut("{\"event\":\"helpDone\"}\n");
-            return;
-        } else if(op=="cursor/add") {
-            kv["cmd"] = "add"; // reuse legacy path
-        } else if(op=="cursor/update") {
-            kv["cmd"] = "set";
-        } else if(op=="cursor/remove") { kv["cmd"] = "remove"; }
-        else if(op=="cursor/clear") { kv["cmd"] = "clear"; }
-        else if(op=="cursor/list") { kv["cmd"] = "list"; }
-        else if(op=="mouse/click") { kv["cmd"] = "clickId"; }
-        else if(op=="mouse/down") { kv["cmd"] = "downId"; }
-        else if(op=="mouse/up") { kv["cmd"] = "upId"; }
-        else if(op=="mouse/drag") { kv["cmd"] = "dragId"; }
-        else if(op=="state/save") { kv["cmd"] = "save"; }
-        else if(op=="state/load") { kv["cmd"] = "load"; }
-        else if(op=="state/reload") { kv["cmd"] = "reload"; }
-        else if(op=="sys/exit") { kv["cmd"] = "exit"; }
-        else if(op=="sys/perf") { kv["cmd"] = "perf"; }
-        else if(op=="config/setAhk") { kv["cmd"] = "setAhk"; }
-        else if(op=="debug/mode") { kv["cmd"] = "debug"; }
-        else if(op=="cursor/tweak") { kv["cmd"] = "tweak"; }
-        else {
-            sendOut(std::string("{\"event\":\"error\",\"msg\":\"unknown op ")+op+"\"}\n");
-            return;
-        }
+// ---------------- Native behavior plugins (swarm_plugin.h) ----------------
+// Every plugins\*.dll next to the exe is loaded once at startup, before the pipes and UpdateThread start,
+// so the registered behaviors never change while commands or frames run. Unloaded after UpdateThread exits.
+struct PluginDll { HMODULE dll {nullptr}; SwarmPluginShutdownFn shutdown {nullptr}; std::string file; };
+static std::deque<PluginDll> gPluginDlls; // deque: file.c_str() is the host context and must not move
+
+static bool ValidPluginName(const char *n, size_t maxLen) {
+    size_t len = n ? strlen(n) : 0;
+    if(!len || len > maxLen) return false;
+    for(size_t i=0;i<len;i++) if(!isalnum((unsigned char)n[i]) && n[i]!='_' && n[i]!='-') return false;
+    return true;
+}
+
+static int HostRegisterBehavior(void *context, const SwarmBehaviorDesc *d) {
+    const char *file = (const char*)context;
+    if(!d || d->structSize < sizeof(SwarmBehaviorDesc) || !d->update || !ValidPluginName(d->name, 48)
+        || d->paramCount > SWARM_PLUGIN_MAX_PARAMS || (d->paramCount && !d->params)) {
+        printf("Plugin %s: rejected behavior descriptor\n", file);
+        return 1;
     }
-    auto cmdIt = kv.find("cmd"); if(cmdIt==kv.end()) return; // still nothing
-    std::string cmd = cmdIt->second;
-    printf("IPC command: %s (line=%s)\n", cmd.c_str(), line.c_str());
-    gApiCommandCount++;
-    if(cmd=="add") {
-        SwarmCursor c; c.size=12; c.color=RGB(0,200,255);
-        if(kv.count("id")) { c.id = atoi(kv["id"].c_str()); if(c.id>=gManager.nextId.load()) gManager.nextId = c.id+1; }
-        if(kv.count("color")) c.color = parseColor(kv["color"]);
-        if(kv.count("behavior")) c.behavior = parseBehavior(kv["behavior"]);
-        if(kv.count("offsetX")) c.offsetX = atof(kv["offsetX"].c_str());
-        if(kv.count("offsetY")) c.offsetY = atof(kv["offsetY"].c_str());
-        if(kv.count("radius")) c.radius = atof(kv["radius"].c_str());
-        if(kv.count("speed")) c.speed = atof(kv["speed"].c_str());
-        if(kv.count("x")) c.target.x = (LONG)atof(kv["x"].c_str());
-        if(kv.count("y")) c.target.y = (LONG)atof(kv["y"].c_str());
-        if(kv.count("lagMs")) c.lagMs = atof(kv["lagMs"].c_str());
-	if(kv.count("size")) { int s = atoi(kv["size"].c_str()); if(s>2 && s<400) c.size = s; }
-        if(kv.count("script")) c.scriptPath = kv["script"];
-        if(c.behavior==BehaviorType::Static) c.pos = c.target;
-        int id = gManager.addCursor(c);
-	printf("Added cursor id=%d behavior=%d color=%06lX lagMs=%.1f radius=%.1f script=%s\n", id, (int)c.behavior, (unsigned long)c.color, c.lagMs, c.radius, c.scriptPath.c_str());
-        if(c.behavior==BehaviorType::Script) {
-            // launch process for this cursor
-            std::lock_guard<std::mutex> lock(gManager.mtx);
-            for(auto &rc : gManager.cursors) if(rc.id==id) LaunchScriptProcess(rc);
-        }
-        char buf[256];
-        snprintf(buf, sizeof(buf), "{\"event\":\"added\",\"id\":%d,\"behavior\":%d}\n", id, (int)c.behavior);
-        sendOut(buf);
-    } else if(cmd=="setAhk") {
-        if(kv.count("path")) { gAhkExePath = kv["path"]; printf("Set AHK path: %s\n", gAhkExePath.c_str()); sendOut(std::string("{\"event\":\"ahkPath\",\"path\":\"")+gAhkExePath+"\"}\n"); }
-    } else if(cmd=="remove") {
-        if(kv.count("id")) {
-            int id = atoi(kv["id"].c_str());
-            bool ok=false; {
-                std::lock_guard<std::mutex> lock(gManager.mtx);
-                for(auto &c : gManager.cursors) if(c.id==id && c.behavior==BehaviorType::Script) CleanupScriptProcess(c);
-                StopScriptPipe(id);
-                ok = gManager.removeCursor(id);
-            }
-            printf("Remove cursor id=%d result=%s\n", id, ok?"ok":"notfound");
-            char buf[128];
-            snprintf(buf, sizeof(buf), "{\"event\":\"removed\",\"id\":%d,\"ok\":%s}\n", id, ok?"true":"false");
-            sendOut(buf);
-        }
-    } else if(cmd=="set") {
-    if(!kv.count("id")) return; 
-    int id = atoi(kv["id"].c_str());
-        std::lock_guard<std::mutex> lock(gManager.mtx);
-        for(auto &c : gManager.cursors) if(c.id==id) {
-            if(kv.count("behavior")) c.behavior = parseBehavior(kv["behavior"]);
-            if(kv.count("offsetX")) c.offsetX = atof(kv["offsetX"].c_str());
-            if(kv.count("offsetY")) c.offsetY = atof(kv["offsetY"].c_str());
-            if(kv.count("radius")) c.radius = atof(kv["radius"].c_str());
-            if(kv.count("speed")) c.speed = atof(kv["speed"].c_str());
-            if(kv.count("x")) c.target.x = (LONG)atof(kv["x"].c_str());
-            if(kv.count("y")) c.target.y = (LONG)atof(kv["y"].c_str());
-            if(kv.count("lagMs")) c.lagMs = atof(kv["lagMs"].c_str());
-            if(kv.count("color")) c.color = parseColor(kv["color"]);
-            if(kv.count("size")) { int s = atoi(kv["size"].c_str()); if(s>2 && s<400) c.size = s; }
-            printf("Updated cursor id=%d behavior=%d\n", id, (int)c.behavior);
-            char buf[160];
-            snprintf(buf, sizeof(buf), "{\"event\":\"updated\",\"id\":%d,\"behavior\":%d}\n", id, (int)c.behavior);
-            sendOut(buf);
-        }
-    } else if(cmd=="debug") {
-        if(kv.count("mode")) {
-            std::string m = kv["mode"];
-            if(m=="solidOn") {
-                gSolidMode = true;
-                if(gManager.overlayWnd) {
-                    // Remove color key, set semi opaque alpha
-                    SetLayeredWindowAttributes(gManager.overlayWnd, 0, (BYTE)200, LWA_ALPHA);
-                    printf("Debug solid mode ON (alpha background).\n");
-                }
-            } else if(m=="solidOff") {
-                gSolidMode = false;
-                if(gManager.overlayWnd) {
-                    SetLayeredWindowAttributes(gManager.overlayWnd, RGB(0,0,0), 0, LWA_COLORKEY);
-                    printf("Debug solid mode OFF (color key transparency).\n");
-                }
-            } else if(m=="windowed" || m=="overlay") {
-                printf("Debug: windowed/overlay disabled (always overlay).\n");
-            } else if(m=="topOff") {
-                if(gManager.overlayWnd) {
-                    LONG_PTR ex2 = GetWindowLongPtr(gManager.overlayWnd, GWL_EXSTYLE);
-                    SetWindowLongPtr(gManager.overlayWnd, GWL_EXSTYLE, ex2 & ~WS_EX_TOPMOST);
-                    SetWindowPos(gManager.overlayWnd, HWND_NOTOPMOST, 0,0,0,0, SWP_NOMOVE|SWP_NOSIZE|SWP_NOACTIVATE|SWP_NOREDRAW);
-                    printf("Debug: topmost OFF.\n");
-                }
-            } else if(m=="topOn") {
-                if(gManager.overlayWnd) {
-                    LONG_PTR ex2 = GetWindowLongPtr(gManager.overlayWnd, GWL_EXSTYLE);
-                    SetWindowLongPtr(gManager.overlayWnd, GWL_EXSTYLE, ex2 | WS_EX_TOPMOST);
-                    SetWindowPos(gManager.overlayWnd, HWND_TOPMOST, 0,0,0,0, SWP_NOMOVE|SWP_NOSIZE|SWP_NOACTIVATE|SWP_NOREDRAW);
-                    printf("Debug: topmost ON.\n");
-                }
-            } else if(m=="keysOn" || m=="keysOff" || m=="clickOn" || m=="clickOff" || m=="mouseOn" || m=="mouseOff") {
-                printf("Debug: keys/mouse capture disabled (always overlay pass-through).\n");
-            }
-        }
-    } else if(cmd=="clear") {
-        {
-            std::lock_guard<std::mutex> lock(gManager.mtx);
-            for(auto &c : gManager.cursors) if(c.behavior==BehaviorType::Script) { CleanupScriptProcess(c); StopScriptPipe(c.id);}            
-            gManager.cursors.clear();
-        }
-        printf("All cursors cleared.\n");
-        sendOut("{\"event\":\"cleared\"}\n");
-    } else if(cmd=="list") {
-        std::vector<SwarmCursor> copy; {
-            std::lock_guard<std::mutex> lock(gManager.mtx); copy = gManager.cursors; }
-        for(auto &c : copy) {
-            char buf[256];
-            snprintf(buf, sizeof(buf), "{\"event\":\"cursor\",\"id\":%d,\"behavior\":%d,\"x\":%ld,\"y\":%ld}\n", c.id, (int)c.behavior, c.pos.x, c.pos.y);
-            sendOut(buf);
-        }
-        sendOut("{\"event\":\"listDone\"}\n");
-    } else if(cmd=="exit") {
-        printf("Exit command received. Shutting down...\n");
-        sendOut("{\"event\":\"exiting\"}\n");
-        gManager.running = false;
-        if(gManager.overlayWnd) PostMessage(gManager.overlayWnd, WM_CLOSE, 0, 0);
-    } else if(cmd=="click" || cmd=="clickId" || cmd=="downId" || cmd=="upId" || cmd=="dragId") {
-        int id = kv.count("id") ? atoi(kv["id"].c_str()) : 0;
-        bool ok=false; POINT p = GetCursorPosForId(id, &ok);
-        if(!ok) { printf("Mouse action: invalid id=%d\n", id); return; }
-        int button = kv.count("button") ? atoi(kv["button"].c_str()) : 0; // 0=left,1=right,2=middle
-        if(cmd=="click") {
-            PerformMouseAction(p, "down", button); PerformMouseAction(p, "up", button);
-        } else if(cmd=="clickId") {
-            PerformMouseAction(p, "down", button); PerformMouseAction(p, "up", button);
-        } else if(cmd=="downId") {
-            PerformMouseAction(p, "down", button);
-        } else if(cmd=="upId") {
-            PerformMouseAction(p, "up", button);
-        } else if(cmd=="dragId") {
-            // dragId requires dx & dy or tx & ty absolute target
-            POINT target = p;
-            if(kv.count("tx") && kv.count("ty")) { target.x = atol(kv["tx"].c_str()); target.y = atol(kv["ty"].c_str()); }
-            else if(kv.count("dx") && kv.count("dy")) { target.x += atol(kv["dx"].c_str()); target.y += atol(kv["dy"].c_str()); }
-            PerformMouseAction(p, "down", button);
-            SetCursorPos(target.x, target.y);
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
-            PerformMouseAction(target, "up", button);
-        }
-    } else if(cmd=="perf") {
-        char buf[256];
-        snprintf(buf,sizeof(buf),"{\"event\":\"perf\",\"fps\":%.1f,\"avgFrameMs\":%.3f,\"cursorCount\":%zu,\"apiCount\":%d}\n", gLastFPS.load(), gAvgFrameMs.load(), gManager.cursors.size(), gApiCommandCount.load());
-        sendOut(buf);
-    } else if(cmd=="save") {
-        SaveState();
-    } else if(cmd=="load") {
-        LoadState();
-    } else if(cmd=="reload") {
-        ReloadConfigIfChanged(true);
-    } else if(cmd=="tweak") {
-        if(!kv.count("id")) return; int id = atoi(kv["id"].c_str());
-        std::lock_guard<std::mutex> lock(gManager.mtx);
-        for(auto &c : gManager.cursors) if(c.id==id) {
-            if(kv.count("radius")) c.radius = atof(kv["radius"].c_str());
-            if(kv.count("radiusDelta")) c.radius += atof(kv["radiusDelta"].c_str());
-            if(kv.count("speed")) c.speed = atof(kv["speed"].c_str());
-            if(kv.count("speedDelta")) c.speed += atof(kv["speedDelta"].c_str());
-            if(kv.count("lagMs")) c.lagMs = atof(kv["lagMs"].c_str());
-            if(kv.count("offsetX")) c.offsetX = atof(kv["offsetX"].c_str());
-            if(kv.count("offsetY")) c.offsetY = atof(kv["offsetY"].c_str());
-            if(kv.count("size")) { int s=atoi(kv["size"].c_str()); if(s>2 && s<400) c.size=s; }
-            if(kv.count("color")) c.color = parseColor(kv["color"]);
-            char buf2[200]; snprintf(buf2,sizeof(buf2),"{\"event\":\"tweaked\",\"id\":%d}\n", id); sendOut(buf2); break;
-        }
-    }
-}
-
-// Per-client reader handling inbound commands line-delimited.
-static void InboundClientHandler(HANDLE hPipe) {
-    std::string buffer; buffer.reserve(512);
-    char chunk[256]; DWORD read=0;
-    while(gManager.running && ReadFile(hPipe, chunk, sizeof(chunk), &read, nullptr)) {
-        if(read==0) break;
-        for(DWORD i=0;i<read;i++) {
-            char c = chunk[i];
-            if(c=='\n') { if(!buffer.empty()) handleCommand(buffer); buffer.clear(); }
-            else if(buffer.size() < 4096) buffer.push_back(c); // limit line size
-        }
-    }
-    if(!buffer.empty()) handleCommand(buffer);
-    FlushFileBuffers(hPipe);
-    DisconnectNamedPipe(hPipe);
-    CloseHandle(hPipe);
-}
-
-// Individual listener worker: waits for a client, hands off to handler synchronously, then loops.
-static void InboundListenerWorker(int idx) {
-    const wchar_t *pipeName = L"\\\\.\\pipe\\SwarmPipe";
-    while(gManager.running) {
-        HANDLE hPipe = CreateNamedPipeW(
-            pipeName,
-            PIPE_ACCESS_INBOUND,
-            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
-            kMaxInboundInstances,
-            4096, 4096, 0, nullptr);
-        if(hPipe==INVALID_HANDLE_VALUE) {
-            DWORD gle = GetLastError();
-            if((idx==0)) printf("Inbound listener %d CreateNamedPipe failed gle=%lu\n", idx, gle);
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    PluginBehavior b;
+    b.name = d->name; b.update = d->update; b.user = d->user;
+    for(uint32_t i=0;i<d->paramCount;i++) {
+        const SwarmParamDesc &p = d->params[i];
+        if(!ValidPluginName(p.name, 32) || b.param(p.name) >= 0 || !(p.minValue <= p.maxValue)) { printf("Plugin %s: bad param %u of %s\n", file, i, d->name); return 1; }
+        b.params.push_back(PluginBehavior::Param{ p.name, std::clamp(p.defaultValue, p.minValue, p.maxValue), p.minValue, p.maxValue, p.flags });
+    }
+    int idx = gManager.registerPlugin(std::move(b));
+    if(idx < 0) { printf("Plugin %s: behavior %s not registered (duplicate name or too many)\n", file, d->name); return 1; }
+    printf("Plugin %s: behavior plugin:%s (%u params)\n", file, d->name, d->paramCount);
+    return 0;
+}
+static void HostLog(void *context, const char *msg) { printf("Plugin %s: %s\n", (const char*)context, msg ? msg : ""); }
+
+static void LoadPlugins() {
+    wchar_t exe[MAX_PATH]; DWORD n = GetModuleFileNameW(nullptr, exe, MAX_PATH);
+    if(!n || n >= MAX_PATH) return;
+    std::wstring dir(exe, n);
+    dir = dir.substr(0, dir.find_last_of(L"\\/") + 1) + L"plugins\\";
+    WIN32_FIND_DATAW fd;
+    HANDLE find = FindFirstFileW((dir + L"*.dll").c_str(), &fd);
+    if(find == INVALID_HANDLE_VALUE) return;
+    do {
+        std::wstring path = dir + fd.cFileName;
+        std::wstring nameW(fd.cFileName);
+        gPluginDlls.emplace_back();
+        PluginDll &p = gPluginDlls.back();
+        p.file.assign(nameW.begin(), nameW.end());
+        p.dll = LoadLibraryW(path.c_str());
+        auto init = p.dll ? (SwarmPluginInitFn)(void*)GetProcAddress(p.dll, "SwarmPluginInit") : nullptr;
+        if(!init) {
+            printf("Plugin %s: %s\n", p.file.c_str(), p.dll ? "no SwarmPluginInit export" : "LoadLibrary failed");
+            if(p.dll) FreeLibrary(p.dll);
+            gPluginDlls.pop_back();
             continue;
         }
-        BOOL connected = ConnectNamedPipe(hPipe, nullptr) ? TRUE : (GetLastError()==ERROR_PIPE_CONNECTED);
-        if(connected) {
-            // Handle in current thread (limits threads to listener count)
-            InboundClientHandler(hPipe); // closes handle internally
-        } else {
-            CloseHandle(hPipe);
+        SwarmHost host { SWARM_PLUGIN_API_VERSION, (void*)p.file.c_str(), HostRegisterBehavior, HostLog };
+        size_t before = gManager.plugins.size();
+        int rc = init(&host);
+        if(rc != 0) {
+            printf("Plugin %s: init returned %d, unloading\n", p.file.c_str(), rc);
+            gManager.truncatePlugins(before);
+            FreeLibrary(p.dll);
+            gPluginDlls.pop_back();
+            continue;
         }
+        p.shutdown = (SwarmPluginShutdownFn)(void*)GetProcAddress(p.dll, "SwarmPluginShutdown");
+    } while(FindNextFileW(find, &fd));
+    FindClose(find);
+    printf("Plugins: %zu DLLs, %zu behaviors\n", gPluginDlls.size(), gManager.plugins.size());
+}
+
+// After UpdateThread has exited: no update callback can run any more
+static void UnloadPlugins() {
+    for(auto &p : gPluginDlls) {
+        if(p.shutdown) p.shutdown();
+        FreeLibrary(p.dll);
     }
+    gPluginDlls.clear();
 }
 
-// Launch a pool of listener workers so multiple clients can connect simultaneously without transient ERROR_PIPE_BUSY.
-void InboundListenerPool() {
-    printf("Inbound pipe server pool starting with %d listeners (max instances %d).\n", kInboundListenerCount, kMaxInboundInstances);
-    std::vector<std::thread> workers; workers.reserve(kInboundListenerCount);
-    for(int i=0;i<kInboundListenerCount;i++) workers.emplace_back(InboundListenerWorker, i);
-    while(gManager.running) std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    // Shutdown: listeners will exit after gManager.running becomes false (may remain blocked until a client connects); we detach after a timeout to avoid hang.
-    for(auto &t : workers) { if(t.joinable()) t.detach(); }
+// ---------------- Command handlers (dispatched by swarm_cmd::Op) ----------------
+using swarm_cmd::Command;
+using CommandHandler = void(*)(const Command&);
+
+static void CmdHelp(const Command&) {
+    const char *ops[] = {
+        "cursor/add","cursor/update","cursor/remove","cursor/clear","cursor/list",
+        "mouse/click","mouse/down","mouse/up","mouse/drag",
+        "state/save","state/load","state/reload","state/autosave",
+        "sys/exit","sys/perf","config/setAhk","config/frame","debug/mode","plugin/list",
+        "record/start","record/stop","play/start","play/stop",
+        "net/broadcast","net/subscribe","net/stop"
+    };
+    for(auto &o: ops) { sendOut(std::string("{\"event\":\"help\",\"op\":\"")+o+"\"}\n"); }
+    sendOut("{\"event\":\"helpDone\"}\n");
 }
 
-void OutPipeThread() {
-    const wchar_t *pipeName = L"\\\\.\\pipe\\SwarmPipeOut";
-    while(gManager.running) {
-        HANDLE hPipe = CreateNamedPipeW(
-            pipeName,
-            PIPE_ACCESS_OUTBOUND,
-            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
-            1, 4096, 4096, 0, nullptr);
-        if(hPipe==INVALID_HANDLE_VALUE) {
-            std::this_thread::sleep_for(std::chrono::seconds(2));
-            continue;
-        }
-        BOOL connected = ConnectNamedPipe(hPipe, nullptr) ? TRUE : (GetLastError()==ERROR_PIPE_CONNECTED);
-        if(connected) {
-            {
-                std::lock_guard<std::mutex> lock(gOutPipeMtx);
-                gOutPipe = hPipe;
-                gOutPipeReady = true;
-            }
-            sendOut("{\"event\":\"connected\"}\n");
-            // Block until client disconnects or shutdown
-            while(gManager.running) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
-                if(WaitForSingleObject(hPipe, 0)==WAIT_OBJECT_0) break; // unlikely
-            }
+// "plugin:<name>" -> registered behavior index; -1 for built-in names, -2 for an unknown plugin
+static int PluginOf(std::string_view b) {
+    if(b.substr(0, 7) != "plugin:") return -1;
+    int p = gManager.findPlugin(b.substr(7));
+    return p >= 0 ? p : -2;
+}
+// cursor/add|update naming a plugin that is not loaded: reports it (unless quiet) and returns true
+static bool RejectUnknownPlugin(const Command &k, bool quiet = false) {
+    if(!k.has(swarm_cmd::kBehavior) || PluginOf(k.behavior) != -2) return false;
+    if(!quiet) sendOut(std::string("{\"event\":\"error\",\"msg\":\"unknown behavior ")+std::string(k.behavior)+"\"}\n");
+    return true;
+}
+// "params":{"name":value,...} onto a plugin cursor: unknown and state params are ignored, values clamped to the schema
+static void ApplyPluginParams(SwarmCursor &c, std::string_view params) {
+    const PluginBehavior &b = gManager.plugins[c.plugin];
+    std::string_view key, value;
+    while(swarm_cmd::NextPair(params, key, value)) {
+        int i = b.param(key);
+        if(i < 0 || (b.params[i].flags & SWARM_PARAM_STATE)) continue;
+        double v = swarm_cmd::ToNumber<double>(value);
+        c.pluginParams[i] = (float)std::clamp(v, (double)b.params[i].lo, (double)b.params[i].hi);
+    }
+}
+
+// Flock weights and speed cap (cursor/add, cursor/update and cursor/tweak)
+static void ApplyFlockFields(SwarmCursor &c, const Command &k) {
+    if(k.has(swarm_cmd::kSeparation)) c.separation = k.separation;
+    if(k.has(swarm_cmd::kAlignment)) c.alignment = k.alignment;
+    if(k.has(swarm_cmd::kCohesion)) c.cohesion = k.cohesion;
+    if(k.has(swarm_cmd::kSeek)) c.seek = k.seek;
+    if(k.has(swarm_cmd::kMaxSpeed) && k.maxSpeed > 0) c.maxSpeed = k.maxSpeed;
+}
+
+// Fields cursor/add and cursor/update share
+static void ApplyCursorFields(SwarmCursor &c, const Command &k) {
+    if(k.has(swarm_cmd::kBehavior)) {
+        int p = PluginOf(k.behavior);
+        if(p == -1) c.behavior = parseBehavior(k.behavior);
+        else if(p >= 0 && (c.behavior != BehaviorType::Plugin || c.plugin != p)) { // entering a plugin: schema defaults
+            c.behavior = BehaviorType::Plugin; c.plugin = p;
+            c.pluginParams.clear();
+            for(auto &d : gManager.plugins[p].params) c.pluginParams.push_back(d.def);
         }
+    }
+    if(k.has(swarm_cmd::kParams) && c.behavior==BehaviorType::Plugin) ApplyPluginParams(c, k.params);
+    if(k.has(swarm_cmd::kOffsetX)) c.offsetX = k.offsetX;
+    if(k.has(swarm_cmd::kOffsetY)) c.offsetY = k.offsetY;
+    if(k.has(swarm_cmd::kRadius)) c.radius = k.radius;
+    if(k.has(swarm_cmd::kSpeed)) c.speed = k.speed;
+    if(k.has(swarm_cmd::kX)) c.target.x = (LONG)k.x;
+    if(k.has(swarm_cmd::kY)) c.target.y = (LONG)k.y;
+    if(k.has(swarm_cmd::kLagMs)) c.lagMs = k.lagMs;
+    if(k.has(swarm_cmd::kColor)) c.color = parseColor(k.color);
+    if(k.has(swarm_cmd::kSize) && k.size>2 && k.size<400) c.size = k.size;
+    ApplyFlockFields(c, k);
+}
+static void ApplyTweakFields(SwarmCursor &c, const Command &k) {
+    if(k.has(swarm_cmd::kRadius)) c.radius = k.radius;
+    if(k.has(swarm_cmd::kRadiusDelta)) c.radius += k.radiusDelta;
+    if(k.has(swarm_cmd::kSpeed)) c.speed = k.speed;
+    if(k.has(swarm_cmd::kSpeedDelta)) c.speed += k.speedDelta;
+    if(k.has(swarm_cmd::kLagMs)) c.lagMs = k.lagMs;
+    if(k.has(swarm_cmd::kOffsetX)) c.offsetX = k.offsetX;
+    if(k.has(swarm_cmd::kOffsetY)) c.offsetY = k.offsetY;
+    if(k.has(swarm_cmd::kSize) && k.size>2 && k.size<400) c.size = k.size;
+    if(k.has(swarm_cmd::kColor)) c.color = parseColor(k.color);
+    ApplyFlockFields(c, k);
+}
+static SwarmCursor CursorFromCommand(const Command &k) {
+    SwarmCursor c; c.size=12; c.color=RGB(0,200,255);
+    if(k.has(swarm_cmd::kId)) c.id = k.id;
+    ApplyCursorFields(c, k);
+    if(k.has(swarm_cmd::kScript)) c.scriptPath = std::string(k.script);
+    // static, flock and plugin cursors start at x,y
+    if(c.behavior==BehaviorType::Static || c.behavior==BehaviorType::Flock || c.behavior==BehaviorType::Plugin) c.pos = c.target;
+    return c;
+}
+
+static void CmdAdd(const Command &k) {
+    if(RejectUnknownPlugin(k)) return;
+    SwarmCursor c = CursorFromCommand(k);
+    uint32_t gen = 0;
+    int id = gManager.addCursor(c, &gen);
+    if(!id) {
+        printf("Add cursor rejected id=%d (out of range or in use)\n", c.id);
+        char eb[128]; snprintf(eb, sizeof(eb), "{\"event\":\"error\",\"msg\":\"id unavailable\",\"id\":%d}\n", c.id);
+        sendOut(eb);
+        return;
+    }
+    printf("Added cursor id=%d behavior=%d color=%06lX lagMs=%.1f radius=%.1f script=%s\n", id, (int)c.behavior, (unsigned long)c.color, c.lagMs, c.radius, c.scriptPath.c_str());
+    if(c.behavior==BehaviorType::Script) {
+        // launch process for this cursor
         {
-            std::lock_guard<std::mutex> lock(gOutPipeMtx);
-            if(gOutPipe==hPipe) {
-                gOutPipeReady = false; gOutPipe = INVALID_HANDLE_VALUE;
-            }
+            ManagerLock lock(gManager.mtx);
+            if(CursorCold *cc = gManager.coldLocked(id)) LaunchScriptProcess(id, *cc);
         }
-        DisconnectNamedPipe(hPipe);
-        CloseHandle(hPipe);
+        LoadPendingScripts();
     }
+    char buf[256];
+    snprintf(buf, sizeof(buf), "{\"event\":\"added\",\"id\":%d,\"gen\":%u,\"behavior\":%d}\n", id, gen, (int)c.behavior);
+    sendOut(buf);
 }
 
-LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    switch(msg) {
-    case WM_NCHITTEST: return HTTRANSPARENT;
-    case WM_PAINT: {
-            PAINTSTRUCT ps; HDC hdc = BeginPaint(hWnd, &ps);
-            RECT rc; GetClientRect(hWnd, &rc);
-            if(gSolidMode) {
-                // Solid dark background so user can see overlay area in debug
-                HBRUSH bg = CreateSolidBrush(RGB(20,20,20));
-                FillRect(hdc, &rc, bg);
-                DeleteObject(bg);
-            } else {
-                // Transparent via color key (black)
-                FillRect(hdc, &rc, (HBRUSH)GetStockObject(BLACK_BRUSH));
-            }
-            // Draw translucent background by layering attributes (set elsewhere)
-            std::vector<SwarmCursor> copy;
-            {
-                std::lock_guard<std::mutex> lock(gManager.mtx);
-                copy = gManager.cursors;
-            }
-            for(const auto &c : copy) {
-                DrawCursorShape(hdc, c.pos.x, c.pos.y, c.size, c.color);
-            }
-            if(gShowHelp) {
-                SetBkMode(hdc, TRANSPARENT);
-                SetTextColor(hdc, RGB(230,230,230));
-                const wchar_t *lines[] = {
-                    L"Swarm Alt Hotkeys:",
-                    L"Alt+D solid bg toggle (debug)",
-                    L"Alt+O add orbit cursor",
-                    L"Alt+F add follow cursor",
-                    L"Alt+C clear cursors",
-                    L"Alt+S add script cursor (Shift=New)",
-                    L"Alt+X exit",
-                    L"H (focus) toggle help",
-                    L"Always full-screen transparent overlay"
-                };
-                int y=10; for(auto *ln: lines){ TextOutW(hdc, 10, y, ln, (int)wcslen(ln)); y+=18; }
-            }
-            static int paintCount = 0;
-            if(paintCount < 60) {
-                printf("WM_PAINT frame=%d cursors=%zu firstPos=(%ld,%ld)\n", paintCount, copy.size(), copy.empty()?0:copy[0].pos.x, copy.empty()?0:copy[0].pos.y);
-                paintCount++;
+static void CmdSetAhk(const Command &k) {
+    if(!k.has(swarm_cmd::kPath)) return;
+    gAhkExePath = std::string(k.path); printf("Set AHK path: %s\n", gAhkExePath.c_str());
+    sendOut(std::string("{\"event\":\"ahkPath\",\"path\":\"")+gAhkExePath+"\"}\n");
+}
+
+static void CmdRemove(const Command &k) {
+    if(!k.has(swarm_cmd::kId)) return;
+    int id = k.id;
+    uint32_t gen = k.gen; // optional stale-id guard (0 = any)
+    bool ok=false, live=false; {
+        ManagerLock lock(gManager.mtx);
+        BehaviorType b; size_t i;
+        live = gManager.findLocked(id, b, i, gen);
+        if(CursorCold *cc = live ? gManager.coldLocked(id) : nullptr) CleanupScriptProcess(*cc);
+    }
+    if(live) StopScriptPipe(id);
+    ok = live && gManager.removeCursor(id, gen); // takes mtx itself
+    printf("Remove cursor id=%d result=%s\n", id, ok?"ok":"notfound");
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{\"event\":\"removed\",\"id\":%d,\"ok\":%s}\n", id, ok?"true":"false");
+    sendOut(buf);
+}
+
+static void CmdSet(const Command &k) {
+    if(!k.has(swarm_cmd::kId) || RejectUnknownPlugin(k)) return;
+    int id = k.id;
+    ManagerLock lock(gManager.mtx);
+    gManager.modifyLocked(id, [&](SwarmCursor &c) {
+        ApplyCursorFields(c, k);
+        printf("Updated cursor id=%d behavior=%d\n", id, (int)c.behavior);
+        char buf[160];
+        snprintf(buf, sizeof(buf), "{\"event\":\"updated\",\"id\":%d,\"behavior\":%d}\n", id, (int)c.behavior);
+        sendOut(buf);
+    }, k.gen);
+}
+
+static void CmdDebug(const Command &k) {
+    if(k.has(swarm_cmd::kMode)) {
+        std::string_view m = k.mode;
+        if(m=="solidOn") {
+            gSolidMode = true;
+            if(gManager.overlayWnd) {
+                ApplyLayeredMode();
+                printf("Debug solid mode ON (alpha background).\n");
+            }
+        } else if(m=="solidOff") {
+            gSolidMode = false;
+            if(gManager.overlayWnd) {
+                ApplyLayeredMode();
+                printf("Debug solid mode OFF (color key transparency).\n");
+            }
+        } else if(m=="windowed" || m=="overlay") {
+            printf("Debug: windowed/overlay disabled (always overlay).\n");
+        } else if(m=="topOff") {
+            for(HWND w : OverlayWindows()) {
+                LONG_PTR ex2 = GetWindowLongPtr(w, GWL_EXSTYLE);
+                SetWindowLongPtr(w, GWL_EXSTYLE, ex2 & ~WS_EX_TOPMOST);
+                SetWindowPos(w, HWND_NOTOPMOST, 0,0,0,0, SWP_NOMOVE|SWP_NOSIZE|SWP_NOACTIVATE|SWP_NOREDRAW);
+            }
+            printf("Debug: topmost OFF.\n");
+        } else if(m=="topOn") {
+            for(HWND w : OverlayWindows()) {
+                LONG_PTR ex2 = GetWindowLongPtr(w, GWL_EXSTYLE);
+                SetWindowLongPtr(w, GWL_EXSTYLE, ex2 | WS_EX_TOPMOST);
+                SetWindowPos(w, HWND_TOPMOST, 0,0,0,0, SWP_NOMOVE|SWP_NOSIZE|SWP_NOACTIVATE|SWP_NOREDRAW);
             }
-            EndPaint(hWnd, &ps);
+            printf("Debug: topmost ON.\n");
+        } else if(m=="keysOn" || m=="keysOff" || m=="clickOn" || m=="clickOff" || m=="mouseOn" || m=="mouseOff") {
+            printf("Debug: keys/mouse capture disabled (always overlay pass-through).\n");
+        }
+    }
+    if(k.has(swarm_cmd::kRender)) {
+        std::string_view r = k.render; // renderMode event follows once the UI thread has switched
+        if(r=="ulw") SetRenderMode(RenderMode::Ulw);
+        else if(r=="gdi") SetRenderMode(RenderMode::Gdi);
+        else if(r=="d2d") SetRenderMode(RenderMode::D2d);
+        else sendOut(std::string("{\"event\":\"error\",\"msg\":\"unknown render ")+std::string(r)+"\"}\n");
+    }
+}
+
+static void CmdClear(const Command&) {
+    {
+        ManagerLock lock(gManager.mtx);
+        for(auto &kc : gManager.cold) { CleanupScriptProcess(kc.second); StopScriptPipe(kc.first); }
+        gManager.clearCursorsLocked();
+    }
+    printf("All cursors cleared.\n");
+    sendOut("{\"event\":\"cleared\"}\n");
+}
+
+static void CmdList(const Command&) {
+    std::vector<CursorRenderRecord> copy; // copied out so sendOut never blocks while pinning the snapshot
+    { RenderSnapshot::View view(gManager.snapshot); copy = view.records(); }
+    for(auto &c : copy) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "{\"event\":\"cursor\",\"id\":%d,\"behavior\":%d,\"x\":%ld,\"y\":%ld}\n", c.id, (int)c.behavior, c.pos.x, c.pos.y);
+        sendOut(buf, CursorEventKey(c.id));
+    }
+    sendOut("{\"event\":\"listDone\"}\n");
+}
+
+static void CmdExit(const Command&) {
+    printf("Exit command received. Shutting down...\n");
+    sendOut("{\"event\":\"exiting\"}\n");
+    gManager.running = false;
+    if(gManager.overlayWnd) PostMessage(gManager.overlayWnd, WM_CLOSE, 0, 0);
+}
+
+// click / clickId / downId / upId / dragId
+static void CmdMouse(const Command &k) {
+    int id = k.id;
+    bool ok=false; POINT p = GetCursorPosForId(id, &ok);
+    if(!ok) { printf("Mouse action: invalid id=%d\n", id); return; }
+    int button = k.button; // 0=left,1=right,2=middle
+    switch(k.op) {
+        case swarm_cmd::Op::Click:
+        case swarm_cmd::Op::ClickId: PerformMouseAction(p, "down", button); PerformMouseAction(p, "up", button); break;
+        case swarm_cmd::Op::DownId: PerformMouseAction(p, "down", button); break;
+        case swarm_cmd::Op::UpId: PerformMouseAction(p, "up", button); break;
+        default: {
+            // dragId requires dx & dy or tx & ty absolute target
+            POINT target = p;
+            if(k.has(swarm_cmd::kTx) && k.has(swarm_cmd::kTy)) { target.x = k.tx; target.y = k.ty; }
+            else if(k.has(swarm_cmd::kDx) && k.has(swarm_cmd::kDy)) { target.x += k.dx; target.y += k.dy; }
+            PerformMouseAction(p, "down", button);
+            SetCursorPos(target.x, target.y);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            PerformMouseAction(target, "up", button);
+        }
+    }
+}
+
+// {"event":"profile","unit":"us","<probe>":{"n","p50","p95","p99","max"},...} from the probe histograms
+static void SendProfile(bool reset) {
+    std::string out = "{\"event\":\"profile\",\"unit\":\"us\"";
+    for(size_t i=0;i<(size_t)Probe::Count;i++) {
+        const swarm_prof::Histogram &h = gProbes[i];
+        char item[192];
+        snprintf(item, sizeof(item), ",\"%s\":{\"n\":%llu,\"p50\":%.1f,\"p95\":%.1f,\"p99\":%.1f,\"max\":%.1f}", kProbeNames[i],
+            (unsigned long long)h.count(), h.percentile(0.50)/1e3, h.percentile(0.95)/1e3, h.percentile(0.99)/1e3, h.max()/1e3);
+        out += item;
+    }
+    out += reset ? ",\"reset\":true}\n" : "}\n";
+    sendOut(out);
+    if(reset) for(auto &h : gProbes) h.reset();
+}
+
+// {"event":"workers","count":N,"workers":[{"jobs","steals","busyMs","frameP50Us","frameP99Us"},...]}: the update pool,
+// worker 0 being UpdateThread itself
+static void SendWorkers(bool reset) {
+    swarm_jobs::JobPool &pool = gManager.jobs;
+    int n = pool.workers();
+    std::string out = "{\"event\":\"workers\",\"count\":" + std::to_string(n) + ",\"workers\":[";
+    for(int w=0;w<n;w++) {
+        swarm_jobs::WorkerStats &st = pool.stats(w);
+        char item[192];
+        snprintf(item, sizeof(item), "%s{\"jobs\":%llu,\"steals\":%llu,\"busyMs\":%.1f,\"frameP50Us\":%.1f,\"frameP99Us\":%.1f}", w ? "," : "",
+            st.jobs.load(), st.steals.load(), st.busyNs.load()/1e6, st.frameNs.percentile(0.50)/1e3, st.frameNs.percentile(0.99)/1e3);
+        out += item;
+        if(reset) st.reset();
+    }
+    out += "]}\n";
+    sendOut(out);
+}
+
+static size_t ScriptVmCount() { ManagerLock lock(gManager.mtx); return gManager.vms.size(); }
+
+static void CmdPerf(const Command &k) {
+    char buf[1280];
+    FramePacer::Stats ft = gPacer.stats();
+    unsigned long long ringApplied, ringRejected, ringDropped; RingStats(ringApplied, ringRejected, ringDropped);
+    snprintf(buf,sizeof(buf),"{\"event\":\"perf\",\"fps\":%.1f,\"avgFrameMs\":%.3f,\"cursorCount\":%zu,\"apiCount\":%d,\"render\":\"%s\",\"avgRenderMs\":%.3f,\"gdiCacheHitRate\":%.4f,\"gdiCacheSize\":%zu,\"simd\":\"%s\",\"snapshotSkips\":%llu,\"ringApplied\":%llu,\"ringRejected\":%llu,\"ringDropped\":%llu,\"outSubscribers\":%d,\"outQueued\":%llu,\"outDropped\":%llu,\"outCoalesced\":%llu,\"outFiltered\":%llu,\"outRateLimited\":%llu,\"outWrites\":%llu,\"targetFps\":%.1f,\"frameP50Ms\":%.2f,\"frameP95Ms\":%.2f,\"frameP99Ms\":%.2f,\"frameMaxMs\":%.2f,\"lateFrames\":%llu,\"dtClamped\":%llu,\"idle\":%s,\"idleTransitions\":%llu,\"idleMs\":%.0f,\"scriptVms\":%zu,\"scriptCalls\":%llu,\"scriptOverBudget\":%llu}\n",
+        gLastFPS.load(), gAvgFrameMs.load(), gManager.cursorCount.load(), gApiCommandCount.load(), RenderModeName(gRenderMode), gAvgRenderMs.load(),
+        gManager.gdiCache.hitRate(), gManager.gdiCache.size.load(), swarm_simd::IsaName(swarm_simd::ActiveIsa()),
+        gManager.snapshot.skipped.load(), ringApplied, ringRejected, ringDropped,
+        gEvents.subscriberCount(), gEvents.queued.load(), gEvents.dropped.load(), gEvents.coalesced.load(), gEvents.filtered.load(),
+        gEvents.rateLimited.load(), gEvents.writes.load(),
+        gPacer.effectiveFps(), ft.p50, ft.p95, ft.p99, ft.max, gPacer.late.load(), gPacer.clamped.load(),
+        gIdle.idle.load() ? "true" : "false", gIdle.transitions.load(), gIdle.idleMs.load(),
+        ScriptVmCount(), gManager.vmCalls.load(), gManager.vmOverBudget.load());
+    sendOut(buf);
+    SendProfile(k.reset);
+    SendWorkers(k.reset);
+}
+
+// config/frame {"fps":N (0 = display refresh), "maxDtMs":N, "workers":N (0 = auto)}
+static void CmdFrame(const Command &k) {
+    if(k.has(swarm_cmd::kFps)) gPacer.targetFps = std::max(0.0, k.fps);
+    if(k.has(swarm_cmd::kMaxDtMs)) gPacer.maxDtMs = std::max(0.0, k.maxDtMs);
+    if(k.has(swarm_cmd::kWorkers)) gManager.jobs.setWorkers(k.workers); // UpdateThread resizes the pool next frame
+    int workers = gManager.jobs.requestedWorkers();
+    char buf[192]; snprintf(buf, sizeof(buf), "{\"event\":\"framePacing\",\"fps\":%.1f,\"effectiveFps\":%.1f,\"maxDtMs\":%.1f,\"workers\":%d}\n",
+        gPacer.targetFps.load(), gPacer.effectiveFps(), gPacer.maxDtMs.load(), workers ? workers : swarm_jobs::JobPool::AutoWorkers());
+    sendOut(buf);
+}
+
+// plugin/list: one "plugin" event per registered behavior with its param schema, then pluginsDone
+static void CmdPluginList(const Command&) {
+    for(size_t p=0;p<gManager.plugins.size();p++) {
+        const PluginBehavior &b = gManager.plugins[p];
+        size_t n; { ManagerLock lock(gManager.mtx); n = gManager.pluginLanes[p].count(); }
+        std::string e = "{\"event\":\"plugin\",\"name\":\"" + b.name + "\",\"cursors\":" + std::to_string(n) + ",\"params\":[";
+        for(size_t i=0;i<b.params.size();i++) {
+            const PluginBehavior::Param &d = b.params[i];
+            char buf[192]; snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"default\":%g,\"min\":%g,\"max\":%g,\"state\":%s}",
+                i ? "," : "", d.name.c_str(), d.def, d.lo, d.hi, (d.flags & SWARM_PARAM_STATE) ? "true" : "false");
+            e += buf;
+        }
+        sendOut(e + "]}\n");
+    }
+    char buf[64]; snprintf(buf, sizeof(buf), "{\"event\":\"pluginsDone\",\"count\":%zu}\n", gManager.plugins.size());
+    sendOut(buf);
+}
+
+static void CmdSubscribeMisplaced(const Command&) {
+    sendOut("{\"event\":\"error\",\"msg\":\"events/subscribe goes on SwarmPipeOut (the subscriber's own connection)\"}\n");
+}
+
+// stream/subscribe {"hz":N} (default 30) / stream/unsubscribe: per-frame position deltas as "frame" events.
+// Sent on SwarmPipeOut, the rate belongs to that subscriber until it unsubscribes or disconnects; on
+// SwarmPipe (and in the config file) it sets the one shared local rate (subscriber 0). The stream runs
+// at the highest rate. Returns the "streaming" reply.
+static std::string StreamSubscription(int subscriber, const Command &k) {
+    double hz = k.op==swarm_cmd::Op::StreamSubscribe ? (k.has(swarm_cmd::kHz) ? k.hz : 30.0) : 0.0;
+    double sent = SetStreamRate(subscriber, hz);
+    char buf[112]; snprintf(buf, sizeof(buf), "{\"event\":\"streaming\",\"hz\":%.1f,\"sentHz\":%.1f}\n", hz > 0 ? std::min(hz, 240.0) : 0.0, sent);
+    return buf;
+}
+static void CmdStream(const Command &k) { sendOut(StreamSubscription(0, k)); }
+
+static void CmdSave(const Command &k) { SaveState(k.mode=="jsonl"); }
+static void CmdLoad(const Command &k) { LoadState(k.mode=="jsonl"); }
+static void CmdReload(const Command&) { ReloadConfigIfChanged(true); }
+
+static void CmdTweak(const Command &k) {
+    if(!k.has(swarm_cmd::kId)) return;
+    int id = k.id;
+    ManagerLock lock(gManager.mtx);
+    gManager.modifyLocked(id, [&](SwarmCursor &c) {
+        ApplyTweakFields(c, k);
+        char buf2[200]; snprintf(buf2,sizeof(buf2),"{\"event\":\"tweaked\",\"id\":%d}\n", id); sendOut(buf2);
+    }, k.gen);
+}
+
+static void CmdBatch(const Command &k);
+static void CmdRecord(const Command &k);
+static void CmdPlay(const Command &k);
+static void CmdAutosave(const Command &k);
+static void CmdNet(const Command &k);
+static const std::array<CommandHandler, (size_t)swarm_cmd::Op::Count> kCommandHandlers = []{
+    using swarm_cmd::Op;
+    std::array<CommandHandler, (size_t)Op::Count> t {}; // None/Unknown stay null
+    t[(size_t)Op::Help] = CmdHelp;
+    t[(size_t)Op::Add] = CmdAdd;       t[(size_t)Op::Set] = CmdSet;       t[(size_t)Op::Remove] = CmdRemove;
+    t[(size_t)Op::Clear] = CmdClear;   t[(size_t)Op::List] = CmdList;     t[(size_t)Op::Tweak] = CmdTweak;
+    t[(size_t)Op::Click] = CmdMouse;   t[(size_t)Op::ClickId] = CmdMouse; t[(size_t)Op::DownId] = CmdMouse;
+    t[(size_t)Op::UpId] = CmdMouse;    t[(size_t)Op::DragId] = CmdMouse;
+    t[(size_t)Op::Save] = CmdSave;     t[(size_t)Op::Load] = CmdLoad;     t[(size_t)Op::Reload] = CmdReload;
+    t[(size_t)Op::Exit] = CmdExit;     t[(size_t)Op::Perf] = CmdPerf;     t[(size_t)Op::SetAhk] = CmdSetAhk;
+    t[(size_t)Op::Debug] = CmdDebug;  t[(size_t)Op::Batch] = CmdBatch;  t[(size_t)Op::Subscribe] = CmdSubscribeMisplaced;
+    t[(size_t)Op::StreamSubscribe] = CmdStream; t[(size_t)Op::StreamUnsubscribe] = CmdStream; t[(size_t)Op::Frame] = CmdFrame;
+    t[(size_t)Op::PluginList] = CmdPluginList;
+    t[(size_t)Op::RecordStart] = CmdRecord; t[(size_t)Op::RecordStop] = CmdRecord;
+    t[(size_t)Op::PlayStart] = CmdPlay;     t[(size_t)Op::PlayStop] = CmdPlay;
+    t[(size_t)Op::Autosave] = CmdAutosave;
+    t[(size_t)Op::NetBroadcast] = CmdNet;   t[(size_t)Op::NetSubscribe] = CmdNet; t[(size_t)Op::NetStop] = CmdNet;
+    return t;
+}();
+
+// cursor/add|update|tweak|remove inside a batch: applied without per-command events. Caller holds gManager.mtx.
+static bool ApplyBatchedLocked(const Command &k, std::string &added) {
+    using swarm_cmd::Op;
+    switch(k.op) {
+        case Op::Add: {
+            if(RejectUnknownPlugin(k, true)) return false;
+            SwarmCursor c = CursorFromCommand(k);
+            uint32_t gen = 0;
+            int id = gManager.addCursorLocked(c, &gen);
+            if(!id) return false;
+            if(c.behavior==BehaviorType::Script) if(CursorCold *cc = gManager.coldLocked(id)) LaunchScriptProcess(id, *cc);
+            char buf[48]; snprintf(buf, sizeof(buf), "%s{\"id\":%d,\"gen\":%u}", added.empty() ? "" : ",", id, gen);
+            added += buf;
+            return true;
+        }
+        case Op::Set: return k.has(swarm_cmd::kId) && !RejectUnknownPlugin(k, true) && gManager.modifyLocked(k.id, [&](SwarmCursor &c){ ApplyCursorFields(c, k); }, k.gen);
+        case Op::Tweak: return k.has(swarm_cmd::kId) && gManager.modifyLocked(k.id, [&](SwarmCursor &c){ ApplyTweakFields(c, k); }, k.gen);
+        case Op::Remove: {
+            BehaviorType b; size_t i;
+            if(!k.has(swarm_cmd::kId) || !gManager.findLocked(k.id, b, i, k.gen)) return false;
+            if(CursorCold *cc = gManager.coldLocked(k.id)) { CleanupScriptProcess(*cc); StopScriptPipe(k.id); }
+            return gManager.removeCursorLocked(k.id, k.gen);
+        }
+        default: return false;
+    }
+}
+
+// Echoed verbatim inside a JSON string, so only short ids of safe characters are accepted
+static bool ValidRequestId(std::string_view r) {
+    if(r.empty() || r.size() > 64) return false;
+    for(char ch : r) if(!(isalnum((unsigned char)ch) || ch=='-' || ch=='_' || ch=='.' || ch==':')) return false;
+    return true;
+}
+
+// Restores the outer request id, so a nested line (batch entry, deferred remove) only overrides it with its own
+struct RequestIdScope {
+    std::string_view prev;
+    explicit RequestIdScope(std::string_view rid) : prev(tRequestId) { if(ValidRequestId(rid)) tRequestId = rid; }
+    ~RequestIdScope() { tRequestId = prev; }
+};
+
+// {"op":"batch","cmds":[{...},{...}]}: consecutive cursor ops share one gManager.mtx acquisition; any other
+// op runs through its normal handler in order. One batchDone summary replaces the per-command events:
+// applied/failed count the cursor ops, dispatched the others (their handlers report their own outcome).
+static void CmdBatch(const Command &k) {
+    using swarm_cmd::Op;
+    std::string_view rest = k.cmds, obj;
+    std::string added; added.reserve(64);
+    int applied = 0, failed = 0, dispatched = 0;
+    Command sub;
+    {
+        std::optional<ManagerLock> lock; // held across a run of cursor ops; emplace/reset keeps the lockWait probe
+        while(swarm_cmd::NextObject(rest, obj)) {
+            if(!swarm_cmd::Parse(obj, sub) || sub.op==Op::Unknown || sub.op==Op::Batch || sub.op==Op::Help) { failed++; continue; }
+            if(sub.op==Op::Add || sub.op==Op::Set || sub.op==Op::Tweak || sub.op==Op::Remove) {
+                if(!lock) lock.emplace(gManager.mtx);
+                ApplyBatchedLocked(sub, added) ? applied++ : failed++;
+            } else {
+                lock.reset();
+                RequestIdScope rid(sub.rid); // the entry's own "rid", else the envelope's
+                kCommandHandlers[(size_t)sub.op](sub);
+                dispatched++;
+            }
+        }
+    }
+    LoadPendingScripts();
+    gApiCommandCount += applied + failed + dispatched;
+    printf("IPC batch: applied=%d failed=%d dispatched=%d\n", applied, failed, dispatched);
+    char head[128]; snprintf(head, sizeof(head), "{\"event\":\"batchDone\",\"applied\":%d,\"failed\":%d,\"dispatched\":%d,\"added\":[", applied, failed, dispatched);
+    sendOut(std::string(head) + added + "]}\n");
+}
+
+void handleCommand(std::string_view line) {
+    SWARM_TRACE_ZONE("handleCommand"); // script readers re-enter here too (remove, deferred ring removes)
+    gIdle.wake();
+    swarm_prof::ScopedTimer timer(Prof(Probe::Command)); // nested (batch, deferred removes) lines count again
+    Command k;
+    if(!swarm_cmd::Parse(line, k)) return; // no op/cmd
+    RequestIdScope rid(k.rid);
+    // Structured 'op' takes precedence over legacy 'cmd'
+    if(k.viaOp) {
+        gApiCommandCount++;
+        if(k.op==swarm_cmd::Op::Help) { CmdHelp(k); return; }
+        if(k.op==swarm_cmd::Op::Unknown) {
+            sendOut(std::string("{\"event\":\"error\",\"msg\":\"unknown op ")+std::string(k.opName)+"\"}\n");
+            return;
+        }
+    }
+    printf("IPC command: %.*s (line=%.*s)\n", (int)k.opName.size(), k.opName.data(), (int)std::min<size_t>(line.size(), 200), line.data());
+    gApiCommandCount++;
+    if(CommandHandler h = kCommandHandlers[(size_t)k.op]) h(k); // legacy cmd names have no "help"
+}
+
+static const wchar_t *kHelpLines[] = {
+    L"Swarm Alt Hotkeys:",
+    L"Alt+D solid bg toggle (debug)",
+    L"Alt+O add orbit cursor",
+    L"Alt+F add follow cursor",
+    L"Alt+C clear cursors",
+    L"Alt+S add script cursor (Shift=New)",
+    L"Alt+X exit",
+    L"H (focus) toggle help",
+    L"Always full-screen transparent overlay"
+};
+static const int kHelpLineCount = (int)(sizeof(kHelpLines)/sizeof(kHelpLines[0]));
+// Area covered by the help text block (18px lines starting at 10,10)
+static const RECT kHelpRect { 0, 0, 360, 10 + kHelpLineCount*18 + 4 };
+
+static void DrawHelpText(HDC hdc) {
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, RGB(230,230,230));
+    int y=10; for(auto *ln: kHelpLines){ TextOutW(hdc, 10, y, ln, (int)wcslen(ln)); y+=18; }
+}
+
+// ---------------- Per-pixel alpha renderer (UpdateLayeredWindow) ----------------
+// Anti-aliased arrow coverage + blurred halo for one cursor size, relative to the cursor center
+struct ArrowMask {
+    int w {0}, h {0};
+    int dx {0}, dy {0};      // mask top-left offset from (cx,cy)
+    std::vector<BYTE> cover; // shape coverage 0..255
+    std::vector<BYTE> glow;  // halo alpha 0..255 (already attenuated)
+};
+
+static bool PointInPolygon(const double *xs, const double *ys, int n, double px, double py) {
+    bool in=false;
+    for(int i=0,j=n-1;i<n;j=i++) {
+        if(((ys[i]>py) != (ys[j]>py)) && (px < (xs[j]-xs[i])*(py-ys[i])/(ys[j]-ys[i]) + xs[i])) in=!in;
+    }
+    return in;
+}
+
+static ArrowMask BuildArrowMask(int size) {
+    const int kSub = 4;                // 4x4 supersampling per pixel
+    const int kGlowStrength = 110;     // peak halo alpha
+    ArrowMask m;
+    double scale = size / (double)kArrowBoxH;
+    int w = (int)(kArrowBoxW * scale), h = (int)(kArrowBoxH * scale);
+    // Same placement as DrawCursorShape: box top-left at (cx - w/2, cy - h/2)
+    m.dx = -w/2 - kGlowPad; m.dy = -h/2 - kGlowPad;
+    m.w = w + 2 + 2*kGlowPad; m.h = h + 2 + 2*kGlowPad;
+    double xs[kArrowPoints], ys[kArrowPoints];
+    for(int i=0;i<kArrowPoints;i++) { xs[i] = kGlowPad + kArrowBase[i].x*scale; ys[i] = kGlowPad + kArrowBase[i].y*scale; }
+    m.cover.assign((size_t)m.w*m.h, 0);
+    for(int y=0;y<m.h;y++) for(int x=0;x<m.w;x++) {
+        int hits=0;
+        for(int sy=0;sy<kSub;sy++) for(int sx=0;sx<kSub;sx++)
+            if(PointInPolygon(xs, ys, kArrowPoints, x + (sx+0.5)/kSub, y + (sy+0.5)/kSub)) hits++;
+        m.cover[(size_t)y*m.w + x] = (BYTE)(hits*255/(kSub*kSub));
+    }
+    // Halo: separable box blur of the coverage, radius kGlowPad
+    std::vector<int> tmp((size_t)m.w*m.h, 0);
+    for(int y=0;y<m.h;y++) for(int x=0;x<m.w;x++) {
+        int acc=0; for(int k=-kGlowPad;k<=kGlowPad;k++) { int xx=x+k; if(xx>=0 && xx<m.w) acc += m.cover[(size_t)y*m.w+xx]; }
+        tmp[(size_t)y*m.w+x] = acc;
+    }
+    const int taps = (2*kGlowPad+1)*(2*kGlowPad+1);
+    m.glow.assign((size_t)m.w*m.h, 0);
+    for(int y=0;y<m.h;y++) for(int x=0;x<m.w;x++) {
+        int acc=0; for(int k=-kGlowPad;k<=kGlowPad;k++) { int yy=y+k; if(yy>=0 && yy<m.h) acc += tmp[(size_t)yy*m.w+x]; }
+        m.glow[(size_t)y*m.w+x] = (BYTE)(acc / taps * kGlowStrength / 255);
+    }
+    return m;
+}
+
+static inline unsigned Mul255(unsigned a, unsigned b) { unsigned t = a*b + 128; return (t + (t>>8)) >> 8; }
+
+// Premultiplied src-over of (rgb, alpha a) onto dst
+static inline uint32_t BlendOver(uint32_t dst, unsigned r, unsigned g, unsigned b, unsigned a) {
+    unsigned inv = 255 - a;
+    unsigned db = dst & 0xFF, dg = (dst>>8) & 0xFF, dr = (dst>>16) & 0xFF, da = dst>>24;
+    return ((Mul255(r,a) + Mul255(dr,inv)) << 16) | ((Mul255(g,a) + Mul255(dg,inv)) << 8)
+         | (Mul255(b,a) + Mul255(db,inv)) | ((a + Mul255(da,inv)) << 24);
+}
+
+// 32bpp premultiplied BGRA surface presented with UpdateLayeredWindowIndirect (update thread only)
+struct UlwSurface {
+    HDC dc {nullptr};
+    HBITMAP bmp {nullptr};
+    HGDIOBJ oldBmp {nullptr};
+    uint32_t *bits {nullptr};
+    int w {0}, h {0};
+    int epoch {-1};
+    bool fresh {false};                       // created since the last frame: nothing presented yet
+    POINT org {0, 0};                         // screen position of pixel (0,0)
+    std::unordered_map<int, ArrowMask> masks; // by cursor size
+    std::vector<uint32_t> help;               // premultiplied help text sprite (kHelpRect)
+
+    bool ensure(int width, int height, int displayEpoch) {
+        if(dc && w==width && h==height && epoch==displayEpoch) return true;
+        release();
+        BITMAPINFO bi{}; bi.bmiHeader.biSize = sizeof(bi.bmiHeader);
+        bi.bmiHeader.biWidth = width; bi.bmiHeader.biHeight = -height;
+        bi.bmiHeader.biPlanes = 1; bi.bmiHeader.biBitCount = 32; bi.bmiHeader.biCompression = BI_RGB;
+        void *p = nullptr;
+        bmp = CreateDIBSection(nullptr, &bi, DIB_RGB_COLORS, &p, nullptr, 0);
+        if(!bmp) { printf("ULW: CreateDIBSection %dx%d failed gle=%lu\n", width, height, GetLastError()); return false; }
+        dc = CreateCompatibleDC(nullptr);
+        oldBmp = SelectObject(dc, bmp);
+        bits = (uint32_t*)p; w = width; h = height; epoch = displayEpoch;
+        buildHelpSprite();
+        fresh = true;
+        return true;
+    }
+    void release() {
+        if(dc) { SelectObject(dc, oldBmp); DeleteDC(dc); dc = nullptr; }
+        if(bmp) { DeleteObject(bmp); bmp = nullptr; }
+        bits = nullptr; w = h = 0;
+    }
+    // GDI text has no alpha: render once on black, derive alpha from intensity
+    void buildHelpSprite() {
+        int hw = kHelpRect.right - kHelpRect.left, hh = kHelpRect.bottom - kHelpRect.top;
+        help.assign((size_t)hw*hh, 0);
+        RECT r { 0, 0, hw, hh };
+        FillRect(dc, &r, (HBRUSH)GetStockObject(BLACK_BRUSH));
+        DrawHelpText(dc);
+        GdiFlush();
+        for(int y=0;y<hh && y<h;y++) for(int x=0;x<hw && x<w;x++) {
+            uint32_t px = bits[(size_t)y*w + x] & 0xFFFFFF;
+            unsigned mx = std::max({ px & 0xFF, (px>>8) & 0xFF, (px>>16) & 0xFF });
+            if(!mx) continue;
+            unsigned a = std::min(255u, mx*255/230);
+            help[(size_t)y*hw + x] = (a<<24) | px;
+        }
+    }
+    const ArrowMask &mask(int size) {
+        auto it = masks.find(size);
+        if(it != masks.end()) return it->second;
+        return masks.emplace(size, BuildArrowMask(size)).first->second;
+    }
+    void fill(const RECT &r, uint32_t value) {
+        for(LONG y=r.top;y<r.bottom;y++) std::fill(bits + (size_t)y*w + r.left, bits + (size_t)y*w + r.right, value);
+    }
+    void drawHelp(const RECT &clip) {
+        RECT hr = kHelpRect; OffsetRect(&hr, -org.x, -org.y); // help sits at the screen origin: primary monitor only
+        RECT isect; if(!IntersectRect(&isect, &clip, &hr)) return;
+        int hw = hr.right - hr.left;
+        for(LONG y=isect.top;y<isect.bottom;y++) for(LONG x=isect.left;x<isect.right;x++) {
+            uint32_t s = help[(size_t)(y-hr.top)*hw + (x-hr.left)];
+            unsigned a = s>>24; if(!a) continue;
+            uint32_t &d = bits[(size_t)y*w + x];
+            unsigned inv = 255 - a;
+            d = s + ((Mul255((d>>16)&0xFF,inv)<<16) | (Mul255((d>>8)&0xFF,inv)<<8) | Mul255(d&0xFF,inv) | (Mul255(d>>24,inv)<<24));
+        }
+    }
+    void drawCursor(const CursorRenderRecord &c, const RECT &clip) {
+        const ArrowMask &m = mask(c.size);
+        LONG cx = c.pos.x - org.x, cy = c.pos.y - org.y;
+        RECT box { cx + m.dx, cy + m.dy, cx + m.dx + m.w, cy + m.dy + m.h }, isect;
+        if(!IntersectRect(&isect, &box, &clip)) return;
+        unsigned r = GetRValue(c.color), g = GetGValue(c.color), b = GetBValue(c.color);
+        for(LONG y=isect.top;y<isect.bottom;y++) {
+            const BYTE *cov = &m.cover[(size_t)(y-box.top)*m.w];
+            const BYTE *glo = &m.glow[(size_t)(y-box.top)*m.w];
+            uint32_t *row = bits + (size_t)y*w;
+            for(LONG x=isect.left;x<isect.right;x++) {
+                int mx = x - box.left;
+                if(glo[mx]) row[x] = BlendOver(row[x], r, g, b, glo[mx]);
+                if(cov[mx]) row[x] = BlendOver(row[x], r, g, b, cov[mx]);
+            }
+        }
+    }
+};
+
+// ---------------- GDI color-key renderer (WM_PAINT into the back buffer) ----------------
+class GdiRenderer : public OverlayRenderer {
+    BackBuffer back; // WM_PAINT target (UI thread only)
+public:
+    RenderMode mode() const override { return RenderMode::Gdi; }
+    bool attach(HWND hWnd) override { applyBackground(hWnd); return true; }
+    void detach() override { back.release(); }
+    void applyBackground(HWND hWnd) override {
+        if(gSolidMode) SetLayeredWindowAttributes(hWnd, 0, (BYTE)200, LWA_ALPHA); // remove color key, semi opaque
+        else SetLayeredWindowAttributes(hWnd, RGB(0,0,0), 0, LWA_COLORKEY);
+    }
+    // Invalidate only what moved on this monitor; no damage => no WM_PAINT this frame
+    void frame(HWND hWnd, const std::vector<RECT> &dirty) override {
+        needsFull = false; // InvalidateOverlay already queued the full WM_PAINT; only the idle check reads it here
+        for(auto &r : dirty) {
+            RECT c; if(!IntersectRect(&c, &r, &bounds)) continue;
+            OffsetRect(&c, -bounds.left, -bounds.top);
+            InvalidateRect(hWnd, &c, FALSE);
+        }
+    }
+    void paint(HWND hWnd) override {
+        PAINTSTRUCT ps; HDC wndDc = BeginPaint(hWnd, &ps);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        // Only the damaged area is cleared/redrawn; BeginPaint clips to the update region.
+        // The window origin is the monitor's screen position, so drawing below uses screen coordinates.
+        RECT rc = ps.rcPaint; OffsetRect(&rc, bounds.left, bounds.top);
+        RECT client; GetClientRect(hWnd, &client);
+        // Compose into the persistent back buffer, then blit rcPaint once (falls back to direct draw)
+        bool buffered = back.ensure(wndDc, client.right - client.left, client.bottom - client.top);
+        HDC hdc = buffered ? back.dc : wndDc;
+        SetWindowOrgEx(hdc, bounds.left, bounds.top, nullptr);
+        GdiColorCache &cache = gManager.gdiCache;
+        cache.trim();
+        {
+            swarm_prof::ScopedTimer clear(Prof(Probe::PaintClear));
+            if(gSolidMode) {
+                // Solid dark background so user can see overlay area in debug
+                FillRect(hdc, &rc, cache.get(RGB(20,20,20)).brush);
+            } else {
+                // Transparent via color key (black)
+                FillRect(hdc, &rc, (HBRUSH)GetStockObject(BLACK_BRUSH));
+            }
+        }
+        auto tDraw = swarm_prof::Clock::now();
+        {
+            RenderSnapshot::View view(gManager.snapshot);
+            PaintCursorsGdi(hdc, rc, view.records(), cache);
+        }
+        Prof(Probe::PaintDraw).record(swarm_prof::ElapsedNs(tDraw));
+        RECT isectHelp;
+        if(gShowHelp && IntersectRect(&isectHelp, &kHelpRect, &rc)) { swarm_prof::ScopedTimer help(Prof(Probe::PaintHelp)); DrawHelpText(hdc); }
+        if(buffered) BitBlt(wndDc, ps.rcPaint.left, ps.rcPaint.top, rc.right - rc.left, rc.bottom - rc.top, hdc, rc.left, rc.top, SRCCOPY);
+        EndPaint(hWnd, &ps);
+        RecordRenderMs(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now()-t0).count());
+    }
+};
+
+// ---------------- Per-pixel alpha renderer (presented from UpdateThread) ----------------
+class UlwRenderer : public OverlayRenderer {
+    UlwSurface surf;
+    std::vector<RECT> local; // this frame's damage in surface coordinates
+public:
+    RenderMode mode() const override { return RenderMode::Ulw; }
+    bool attach(HWND) override { return true; } // alpha comes from the surface; solid bg is painted into it
+    void detach() override { surf.release(); }
+    // Redraw this monitor's share of the damage into the premultiplied surface and present only its union
+    void frame(HWND hWnd, const std::vector<RECT> &dirty) override {
+        RECT client; GetClientRect(hWnd, &client);
+        if(!surf.ensure(client.right, client.bottom, gDisplayEpoch.load())) return;
+        surf.org = POINT{ bounds.left, bounds.top };
+        bool full = needsFull.exchange(false) || surf.fresh;
+        surf.fresh = false;
+        local.clear();
+        for(auto &r : dirty) { RECT c; if(IntersectRect(&c, &r, &bounds)) { OffsetRect(&c, -bounds.left, -bounds.top); local.push_back(c); } }
+        if(!full && local.empty()) return;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        RenderSnapshot::View view(gManager.snapshot);
+        const std::vector<CursorRenderRecord> &copy = view.records();
+        // Solid debug bg: RGB(20,20,20) at alpha 200, premultiplied
+        const uint32_t bg = gSolidMode ? ((200u<<24) | (15u<<16) | (15u<<8) | 15u) : 0u;
+        RECT all { 0, 0, surf.w, surf.h };
+        auto paintRect = [&](const RECT &r0) {
+            RECT r; if(!IntersectRect(&r, &r0, &all)) return;
+            surf.fill(r, bg);
+            if(gShowHelp) surf.drawHelp(r);
+            for(const auto &c : copy) surf.drawCursor(c, r);
+        };
+        RECT u {0,0,0,0};
+        if(full) { paintRect(all); u = all; }
+        else for(auto &r : local) { paintRect(r); UnionRect(&u, &u, &r); }
+        IntersectRect(&u, &u, &all);
+        POINT src{0,0};
+        BLENDFUNCTION bf{ AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+        UPDATELAYEREDWINDOWINFO info{}; info.cbSize = sizeof(info);
+        // No pptDst/psize: the window keeps the position and size the UI thread gave it (moving or resizing
+        // it here would send WM_WINDOWPOSCHANGING to the UI thread while UpdateThread holds gRenderMtx)
+        info.hdcSrc = surf.dc; info.pptSrc = &src;
+        info.pblend = &bf; info.dwFlags = ULW_ALPHA; info.prcDirty = full ? nullptr : &u;
+        if(!UpdateLayeredWindowIndirect(hWnd, &info)) needsFull = true; // e.g. mid mode switch; retry whole surface
+        RecordRenderMs(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now()-t0).count());
+    }
+};
+
+// ---------------- GPU renderer (Direct2D into a DirectComposition swap chain) ----------------
+// One path geometry holds the arrow (kArrowBase); each cursor size gets a cached filled realization
+// (tessellated once), drawn per instance with a translation transform and the brush colour.
+class D2dRenderer : public OverlayRenderer {
+    ComPtr<ID3D11Device> d3d;
+    ComPtr<IDXGISwapChain1> swapChain;
+    ComPtr<ID2D1Factory2> factory;
+    ComPtr<ID2D1Device1> device;
+    ComPtr<ID2D1DeviceContext1> dc;
+    ComPtr<ID2D1Bitmap1> target;
+    ComPtr<ID2D1SolidColorBrush> brush;
+    ComPtr<ID2D1PathGeometry> arrow;
+    std::unordered_map<int, ComPtr<ID2D1GeometryRealization>> realizations; // by cursor size
+    ComPtr<IDWriteFactory> dwrite;
+    ComPtr<IDWriteTextFormat> textFormat;
+    ComPtr<IDCompositionDevice> dcomp;
+    ComPtr<IDCompositionTarget> compTarget;
+    ComPtr<IDCompositionVisual> visual;
+    int epoch {-1};
+    bool lost {false};
+
+    static bool check(HRESULT hr, const char *what) {
+        if(FAILED(hr)) { printf("D2D: %s failed hr=0x%08lX\n", what, (unsigned long)hr); return false; }
+        return true;
+    }
+    bool createTarget() {
+        ComPtr<IDXGISurface> surface;
+        if(!check(swapChain->GetBuffer(0, IID_PPV_ARGS(surface.GetAddressOf())), "GetBuffer")) return false;
+        D2D1_BITMAP_PROPERTIES1 props = D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+        if(!check(dc->CreateBitmapFromDxgiSurface(surface.Get(), props, target.GetAddressOf()), "CreateBitmapFromDxgiSurface")) return false;
+        dc->SetTarget(target.Get());
+        return true;
+    }
+    bool resize(HWND hWnd) {
+        RECT rc; GetClientRect(hWnd, &rc);
+        dc->SetTarget(nullptr); target.Reset();
+        if(!check(swapChain->ResizeBuffers(0, (UINT)std::max(1L, (long)rc.right), (UINT)std::max(1L, (long)rc.bottom), DXGI_FORMAT_UNKNOWN, 0), "ResizeBuffers")) return false;
+        epoch = gDisplayEpoch.load();
+        return createTarget();
+    }
+    bool buildArrow() {
+        ComPtr<ID2D1GeometrySink> sink;
+        if(!check(factory->CreatePathGeometry(arrow.GetAddressOf()), "CreatePathGeometry")) return false;
+        if(!check(arrow->Open(sink.GetAddressOf()), "PathGeometry Open")) return false;
+        D2D1_POINT_2F pts[kArrowPoints];
+        for(int i=0;i<kArrowPoints;i++) pts[i] = D2D1::Point2F((FLOAT)kArrowBase[i].x, (FLOAT)kArrowBase[i].y);
+        sink->BeginFigure(pts[0], D2D1_FIGURE_BEGIN_FILLED);
+        sink->AddLines(pts + 1, kArrowPoints - 1);
+        sink->EndFigure(D2D1_FIGURE_END_CLOSED);
+        return check(sink->Close(), "GeometrySink Close");
+    }
+    ID2D1GeometryRealization *realization(int size) {
+        auto it = realizations.find(size);
+        if(it != realizations.end()) return it->second.Get();
+        FLOAT scale = size / (FLOAT)kArrowBoxH;
+        ComPtr<ID2D1TransformedGeometry> scaled;
+        ComPtr<ID2D1GeometryRealization> r;
+        if(FAILED(factory->CreateTransformedGeometry(arrow.Get(), D2D1::Matrix3x2F::Scale(scale, scale), scaled.GetAddressOf()))) return nullptr;
+        if(FAILED(dc->CreateFilledGeometryRealization(scaled.Get(), D2D1_DEFAULT_FLATTENING_TOLERANCE, r.GetAddressOf()))) return nullptr;
+        return (realizations[size] = r).Get();
+    }
+    void deviceLost(HWND hWnd) {
+        lost = true;
+        printf("D2D: device lost, falling back to gdi\n");
+        PostMessage(hWnd, WM_APP_SET_RENDER, (WPARAM)RenderMode::Gdi, 0);
+    }
+public:
+    // Hardware only: a WARP device would just move the polygon work back onto the CPU
+    static HRESULT CreateDevice(ComPtr<ID3D11Device> &out) {
+        return D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+                                 nullptr, 0, D3D11_SDK_VERSION, out.GetAddressOf(), nullptr, nullptr);
+    }
+    static bool DeviceAvailable() { ComPtr<ID3D11Device> probe; return SUCCEEDED(CreateDevice(probe)); }
+
+    RenderMode mode() const override { return RenderMode::D2d; }
+    bool needsRedirection() const override { return false; }
+    bool attach(HWND hWnd) override {
+        if(!check(CreateDevice(d3d), "D3D11CreateDevice")) return false;
+        ComPtr<IDXGIDevice> dxgiDevice;
+        ComPtr<IDXGIFactory2> dxgiFactory;
+        if(!check(d3d->QueryInterface(IID_PPV_ARGS(dxgiDevice.GetAddressOf())), "IDXGIDevice")) return false;
+        if(!check(CreateDXGIFactory2(0, IID_PPV_ARGS(dxgiFactory.GetAddressOf())), "CreateDXGIFactory2")) return false;
+        RECT rc; GetClientRect(hWnd, &rc);
+        DXGI_SWAP_CHAIN_DESC1 desc{};
+        desc.Width = (UINT)std::max(1L, (long)rc.right); desc.Height = (UINT)std::max(1L, (long)rc.bottom);
+        desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM; desc.SampleDesc.Count = 1;
+        desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT; desc.BufferCount = 2;
+        desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL; desc.AlphaMode = DXGI_ALPHA_MODE_PREMULTIPLIED;
+        if(!check(dxgiFactory->CreateSwapChainForComposition(d3d.Get(), &desc, nullptr, swapChain.GetAddressOf()), "CreateSwapChainForComposition")) return false;
+        if(!check(D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, factory.GetAddressOf()), "D2D1CreateFactory")) return false;
+        if(!check(factory->CreateDevice(dxgiDevice.Get(), device.GetAddressOf()), "CreateDevice")) return false;
+        if(!check(device->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, dc.GetAddressOf()), "CreateDeviceContext")) return false;
+        if(!createTarget()) return false;
+        if(!check(dc->CreateSolidColorBrush(D2D1::ColorF(1,1,1), brush.GetAddressOf()), "CreateSolidColorBrush")) return false;
+        if(!buildArrow()) return false;
+        // Help text is optional; missing DirectWrite just hides it
+        if(SUCCEEDED(DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory), reinterpret_cast<IUnknown**>(dwrite.GetAddressOf()))))
+            dwrite->CreateTextFormat(L"Segoe UI", nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL, 14.0f, L"", textFormat.GetAddressOf());
+        if(!check(DCompositionCreateDevice(dxgiDevice.Get(), IID_PPV_ARGS(dcomp.GetAddressOf())), "DCompositionCreateDevice")) return false;
+        if(!check(dcomp->CreateTargetForHwnd(hWnd, TRUE, compTarget.GetAddressOf()), "CreateTargetForHwnd")) return false;
+        if(!check(dcomp->CreateVisual(visual.GetAddressOf()), "CreateVisual")) return false;
+        if(!check(visual->SetContent(swapChain.Get()), "SetContent")) return false;
+        if(!check(compTarget->SetRoot(visual.Get()), "SetRoot")) return false;
+        if(!check(dcomp->Commit(), "Commit")) return false;
+        SetLayeredWindowAttributes(hWnd, 0, 255, LWA_ALPHA); // layered (click-through) but fully composed by DComp
+        epoch = gDisplayEpoch.load();
+        lost = false;
+        return true;
+    }
+    void detach() override {
+        if(dc) dc->SetTarget(nullptr);
+        visual.Reset(); compTarget.Reset(); dcomp.Reset();
+        realizations.clear(); arrow.Reset(); brush.Reset(); textFormat.Reset(); dwrite.Reset();
+        target.Reset(); dc.Reset(); device.Reset(); factory.Reset(); swapChain.Reset(); d3d.Reset();
+    }
+    // Damage on this monitor only gates whether a frame is drawn; the GPU redraws the whole (cheap) swap chain buffer
+    void frame(HWND hWnd, const std::vector<RECT> &dirty) override {
+        if(lost || !dc) return;
+        bool full = needsFull.exchange(false);
+        if(epoch != gDisplayEpoch.load()) { if(!resize(hWnd)) { deviceLost(hWnd); return; } full = true; }
+        bool touched = full;
+        for(size_t i=0;i<dirty.size() && !touched;i++) { RECT c; touched = IntersectRect(&c, &dirty[i], &bounds) != 0; }
+        if(!touched) return; // nothing moved here: DComp keeps showing the last frame
+        auto t0 = std::chrono::high_resolution_clock::now();
+        RenderSnapshot::View view(gManager.snapshot);
+        const std::vector<CursorRenderRecord> &copy = view.records();
+        dc->BeginDraw();
+        dc->SetTransform(D2D1::Matrix3x2F::Identity());
+        if(gSolidMode) dc->Clear(D2D1::ColorF(20/255.f, 20/255.f, 20/255.f, 200/255.f));
+        else dc->Clear(D2D1::ColorF(0, 0, 0, 0));
+        const FLOAT ox = (FLOAT)bounds.left, oy = (FLOAT)bounds.top;
+        RECT isect;
+        if(gShowHelp && textFormat && IntersectRect(&isect, &kHelpRect, &bounds)) {
+            brush->SetColor(D2D1::ColorF(230/255.f, 230/255.f, 230/255.f));
+            FLOAT y = 10;
+            for(auto *ln : kHelpLines) { dc->DrawText(ln, (UINT32)wcslen(ln), textFormat.Get(), D2D1::RectF(10 - ox, y - oy, 400 - ox, y + 18 - oy), brush.Get()); y += 18; }
+        }
+        for(const auto &c : copy) {
+            RECT cb = CursorBounds(c.pos.x, c.pos.y, c.size);
+            if(!IntersectRect(&isect, &cb, &bounds)) continue; // on another monitor
+            ID2D1GeometryRealization *r = realization(c.size);
+            if(!r) continue;
+            // Same placement as DrawCursorShape: box top-left at (cx - w/2, cy - h/2)
+            double scale = c.size / (double)kArrowBoxH;
+            int w = (int)(kArrowBoxW * scale), h = (int)(kArrowBoxH * scale);
+            dc->SetTransform(D2D1::Matrix3x2F::Translation((FLOAT)(c.pos.x - w/2) - ox, (FLOAT)(c.pos.y - h/2) - oy));
+            brush->SetColor(D2D1::ColorF(GetRValue(c.color)/255.f, GetGValue(c.color)/255.f, GetBValue(c.color)/255.f));
+            dc->DrawGeometryRealization(r, brush.Get());
+        }
+        HRESULT hr = dc->EndDraw();
+        if(SUCCEEDED(hr)) hr = swapChain->Present(0, 0);
+        if(FAILED(hr)) { check(hr, "EndDraw/Present"); deviceLost(hWnd); return; }
+        RecordRenderMs(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now()-t0).count());
+    }
+};
+
+static std::unique_ptr<OverlayRenderer> MakeRenderer(RenderMode m) {
+    switch(m) {
+        case RenderMode::Ulw: return std::make_unique<UlwRenderer>();
+        case RenderMode::D2d: return std::make_unique<D2dRenderer>();
+        default: return std::make_unique<GdiRenderer>();
+    }
+}
+
+static HINSTANCE gInstance = nullptr;
+static bool gHotkeysOnWindow = false; // RegisterHotKey fell back to the overlay HWND (redo on recreate)
+static bool gRebuildPosted = false;   // UI thread: a display rebuild is already queued
+static void InstallRenderer(RenderMode m);
+
+// Display layout / scale changed: recreate the per-monitor surfaces once, however many windows were told
+static void PostDisplayRebuild() {
+    if(gRebuildPosted || !gManager.overlayWnd) return;
+    gRebuildPosted = true;
+    PostMessage(gManager.overlayWnd, WM_APP_SET_RENDER, (WPARAM)gRenderMode.load(), 0);
+}
+
+LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch(msg) {
+    case WM_NCHITTEST: return HTTRANSPARENT;
+    case WM_PAINT: {
+            SWARM_TRACE_ZONE("WM_PAINT");
+            // No gRenderMtx: only this thread replaces gSurfaces, so a frame holding it never blocks painting
+            OverlayRenderer *r = nullptr;
+            for(auto &sf : gSurfaces) if(sf.hwnd == hWnd) r = sf.renderer.get();
+            if(r) r->paint(hWnd);
+            else ValidateRect(hWnd, nullptr); // mid backend switch / display rebuild
         } return 0;
-        case WM_DESTROY:
-            PostQuitMessage(0);
+        case WM_APP_SET_RENDER:
+            InstallRenderer((RenderMode)wParam);
             return 0;
+        case WM_APP_APPLY_BACKGROUND:
+            ApplyLayeredModeUi();
+            return 0;
+        case WM_INPUT: // mouse raw input (RIDEV_INPUTSINK): only used to leave idle mode
+            gIdle.wake();
+            break; // DefWindowProc releases the input
+        case WM_DISPLAYCHANGE: // monitors added/removed/moved or a resolution change (every overlay window hears it)
+            if(hWnd == gManager.overlayWnd) { gDisplayEpoch++; PostDisplayRebuild(); }
+            return 0;
+        case WM_DPICHANGED: // scale changed on this window's monitor; surfaces stay in physical pixels, just rebuild
+            PostDisplayRebuild();
+            return 0;
+        case WM_DESTROY: {
+            if(hWnd != gManager.overlayWnd) return 0; // replaced by a backend switch, or a monitor went away
+            std::vector<OverlaySurface> surfaces;
+            {
+                std::lock_guard<std::mutex> lk(gRenderMtx);
+                surfaces.swap(gSurfaces);
+            }
+            for(auto &sf : surfaces) {
+                if(sf.renderer) { sf.renderer->detach(); sf.renderer.reset(); }
+                if(sf.hwnd != hWnd) DestroyWindow(sf.hwnd);
+            }
+            gManager.gdiCache.clear();
+            PostQuitMessage(0);
+        } return 0;
         case WM_HOTKEY: {
             UINT id = (UINT)wParam; char ch=0;
             if(id==1) ch='D'; else if(id==3) ch='O'; else if(id==4) ch='F'; else if(id==5) ch='C'; else if(id==6) ch='X'; else if(id==7) ch='S';
             if(ch) ExecuteHotChar(ch);
         } return 0;
-    case WM_KEYDOWN: { int vk=(int)wParam; if(vk=='H'){ gShowHelp=!gShowHelp; InvalidateRect(hWnd,nullptr,FALSE); printf("Help %s\n", gShowHelp?"shown":"hidden"); } return 0; }
+    case WM_KEYDOWN: { int vk=(int)wParam; if(vk=='H'){ gShowHelp=!gShowHelp; InvalidateOverlay(); printf("Help %s\n", gShowHelp?"shown":"hidden"); } return 0; }
     }
     return DefWindowProc(hWnd, msg, wParam, lParam);
 }
 
-HWND CreateOverlayWindow(HINSTANCE hInst) {
+// Permanent transparent overlay covering one monitor (mouse pass-through). redirected=false creates the
+// WS_EX_NOREDIRECTIONBITMAP variant required by the DirectComposition backend.
+HWND CreateOverlayWindow(HINSTANCE hInst, bool redirected, const RECT &rc) {
     const wchar_t CLASS_NAME[] = L"SwarmOverlayClass";
-    WNDCLASSW wc = {};
-    wc.lpfnWndProc = WndProc;
-    wc.hInstance = hInst;
-    wc.lpszClassName = CLASS_NAME;
-    wc.hCursor = LoadCursorW(nullptr, IDC_ARROW);
-    wc.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
-    RegisterClassW(&wc);
+    static bool registered = false;
+    if(!registered) {
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc = WndProc;
+        wc.hInstance = hInst;
+        wc.lpszClassName = CLASS_NAME;
+        wc.hCursor = LoadCursorW(nullptr, IDC_ARROW);
+        wc.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
+        RegisterClassW(&wc);
+        registered = true;
+    }
 
+    DWORD exStyle = WS_EX_LAYERED | WS_EX_TOPMOST | WS_EX_TOOLWINDOW; // don't start transparent to clicks until after mode decisions
+    if(!redirected) exStyle |= WS_EX_NOREDIRECTIONBITMAP;
     HWND hWnd = CreateWindowExW(
-    WS_EX_LAYERED | WS_EX_TOPMOST | WS_EX_TOOLWINDOW, // don't start transparent to clicks until after mode decisions
+        exStyle,
         CLASS_NAME, L"SwarmOverlay", WS_POPUP,
-        0,0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN),
+        rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top,
         nullptr, nullptr, hInst, nullptr);
 
     if(!hWnd) return nullptr;
@@ -842,71 +2124,1074 @@ HWND CreateOverlayWindow(HINSTANCE hInst) {
     if(!SetLayeredWindowAttributes(hWnd, RGB(0,0,0), 0, LWA_COLORKEY)) {
         printf("SetLayeredWindowAttributes failed: %lu\n", GetLastError());
     }
+    LONG_PTR st = GetWindowLongPtr(hWnd, GWL_STYLE);
+    SetWindowLongPtr(hWnd, GWL_STYLE, (st & ~WS_OVERLAPPEDWINDOW) | WS_POPUP);
+    LONG_PTR ex = GetWindowLongPtr(hWnd, GWL_EXSTYLE);
+    ex = (ex | WS_EX_LAYERED | WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_TRANSPARENT) & ~WS_EX_APPWINDOW;
+    SetWindowLongPtr(hWnd, GWL_EXSTYLE, ex);
+    SetWindowPos(hWnd, HWND_TOPMOST, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top, SWP_FRAMECHANGED | SWP_SHOWWINDOW | SWP_NOACTIVATE);
     ShowWindow(hWnd, SW_SHOW);
     UpdateWindow(hWnd);
     return hWnd;
 }
 
+// Mouse movement/buttons anywhere reach the overlay as WM_INPUT, so an idle UpdateThread can wake
+static void RegisterIdleWakeInput(HWND hWnd) {
+    RAWINPUTDEVICE rid { 0x01, 0x02, RIDEV_INPUTSINK, hWnd }; // generic desktop / mouse
+    if(!RegisterRawInputDevices(&rid, 1, sizeof(rid))) printf("RegisterRawInputDevices failed gle=%lu (idle wakes on poll only)\n", GetLastError());
+}
+
+static int RegisterOverlayHotkeys(HWND hWnd) {
+    int ok=0;
+    auto tryAltWnd=[&](int id,char ch){ if(RegisterHotKey(hWnd,id,MOD_ALT,ch)) ok++; };
+    tryAltWnd(1,'D'); tryAltWnd(3,'O'); tryAltWnd(4,'F'); tryAltWnd(5,'C'); tryAltWnd(6,'X');
+    return ok;
+}
+
+// Monitor rects in virtual-screen pixels, primary first
+static BOOL CALLBACK CollectMonitor(HMONITOR mon, HDC, LPRECT, LPARAM out) {
+    MONITORINFO mi{}; mi.cbSize = sizeof(mi);
+    if(!GetMonitorInfoW(mon, &mi)) return TRUE;
+    auto &v = *(std::vector<RECT>*)out;
+    if(mi.dwFlags & MONITORINFOF_PRIMARY) v.insert(v.begin(), mi.rcMonitor);
+    else v.push_back(mi.rcMonitor);
+    return TRUE;
+}
+
+static std::vector<RECT> MonitorRects() {
+    std::vector<RECT> v;
+    EnumDisplayMonitors(nullptr, nullptr, CollectMonitor, (LPARAM)&v);
+    if(v.empty()) v.push_back(RECT{ 0, 0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN) });
+    return v;
+}
+
+// Make one surface's window cover its monitor and match the backend's surface model, recreating it when
+// the redirection-bitmap requirement differs. UI thread only, while the surface has no renderer.
+static bool PrepareOverlayWindow(OverlaySurface &sf, bool primary, bool redirected) {
+    HWND cur = sf.hwnd;
+    const RECT &rc = sf.bounds;
+    bool curRedirected = cur && !(GetWindowLongPtr(cur, GWL_EXSTYLE) & WS_EX_NOREDIRECTIONBITMAP);
+    if(!cur || curRedirected != redirected) {
+        HWND next = CreateOverlayWindow(gInstance, redirected, rc);
+        if(!next) { printf("Overlay window recreate failed gle=%lu\n", GetLastError()); return false; }
+        sf.hwnd = next;
+        if(primary) {
+            gManager.overlayWnd = next;
+            if(gHotkeysOnWindow) RegisterOverlayHotkeys(next);
+            RegisterIdleWakeInput(next);
+        }
+        if(cur) DestroyWindow(cur); // WM_DESTROY ignores windows that are no longer the overlay
+        printf("Overlay window created HWND=%p at %ld,%ld %ldx%ld (%s)\n", (void*)next, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top,
+            redirected ? "redirected" : "no redirection bitmap");
+        cur = next;
+    } else {
+        SetWindowPos(cur, HWND_TOPMOST, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top, SWP_NOACTIVATE);
+    }
+    // Re-toggling WS_EX_LAYERED resets the window so it can switch between SLWA and UpdateLayeredWindow
+    LONG_PTR ex = GetWindowLongPtr(cur, GWL_EXSTYLE);
+    SetWindowLongPtr(cur, GWL_EXSTYLE, ex & ~WS_EX_LAYERED);
+    SetWindowLongPtr(cur, GWL_EXSTYLE, ex | WS_EX_LAYERED);
+    return true;
+}
+
+// One window per current monitor (reusing existing ones; [0] stays the primary), each with a fresh backend.
+// UI thread only, with the surfaces taken out of gSurfaces. On failure every backend is detached again.
+static bool AttachSurfaces(std::vector<OverlaySurface> &surfaces, RenderMode m) {
+    std::vector<RECT> mons = MonitorRects();
+    while(surfaces.size() > mons.size()) { DestroyWindow(surfaces.back().hwnd); surfaces.pop_back(); }
+    surfaces.resize(mons.size());
+    bool ok = true;
+    for(size_t i=0;i<surfaces.size() && ok;i++) {
+        OverlaySurface &sf = surfaces[i];
+        sf.bounds = mons[i];
+        sf.renderer = MakeRenderer(m);
+        sf.renderer->bounds = sf.bounds;
+        ok = PrepareOverlayWindow(sf, i==0, sf.renderer->needsRedirection()) && sf.renderer->attach(sf.hwnd);
+        if(ok) { UINT d = GetDpiForWindow(sf.hwnd); sf.dpi = d ? d : 96; }
+    }
+    if(!ok) for(auto &sf : surfaces) if(sf.renderer) { sf.renderer->detach(); sf.renderer.reset(); }
+    return ok;
+}
+
+// {"event":"displays","monitors":[{"x":..,"y":..,"w":..,"h":..,"dpi":..}, ...]}, primary first
+static void SendDisplays(const std::vector<OverlaySurface> &surfaces) {
+    std::string out = "{\"event\":\"displays\",\"monitors\":[";
+    for(size_t i=0;i<surfaces.size();i++) {
+        const RECT &r = surfaces[i].bounds;
+        char b[128]; snprintf(b, sizeof(b), "%s{\"x\":%ld,\"y\":%ld,\"w\":%ld,\"h\":%ld,\"dpi\":%u}", i ? "," : "",
+            r.left, r.top, r.right - r.left, r.bottom - r.top, surfaces[i].dpi);
+        out += b;
+        printf("Display %zu: %ld,%ld %ldx%ld dpi %u%s\n", i, r.left, r.top, r.right - r.left, r.bottom - r.top, surfaces[i].dpi, i ? "" : " (primary)");
+    }
+    sendOut(out + "]}\n");
+}
+
+// UI thread only: also the display rebuild. Falls back to GDI when the requested backend cannot attach
+// (e.g. no D3D device) on every monitor.
+static void InstallRenderer(RenderMode m) {
+    gRebuildPosted = false;
+    std::vector<OverlaySurface> surfaces;
+    {
+        std::lock_guard<std::mutex> lk(gRenderMtx);
+        surfaces.swap(gSurfaces);
+    }
+    for(auto &sf : surfaces) if(sf.renderer) { sf.renderer->detach(); sf.renderer.reset(); }
+    bool ok = AttachSurfaces(surfaces, m);
+    if(!ok && m!=RenderMode::Gdi) {
+        printf("Render: %s unavailable, falling back to gdi\n", RenderModeName(m));
+        ok = AttachSurfaces(surfaces, RenderMode::Gdi);
+    }
+    if(ok) gRenderMode = surfaces[0].renderer->mode();
+    else printf("Render: no usable backend\n");
+    {
+        std::lock_guard<std::mutex> lk(gRenderMtx);
+        gSurfaces.swap(surfaces); // windows stay tracked even without a backend
+    }
+    if(!ok) return;
+    InvalidateOverlay();
+    // Reading gSurfaces needs no lock on the UI thread, and the output below must not hold it
+    printf("Render mode: %s on %zu monitor(s)\n", RenderModeName(gRenderMode), gSurfaces.size());
+    sendOut(std::string("{\"event\":\"renderMode\",\"render\":\"")+RenderModeName(gRenderMode)+"\"}\n");
+    SendDisplays(gSurfaces);
+}
+
+// ---------------- Shared-memory command rings (layout + producer client in swarm_ring.h) ----------------
+class RingServer {
+    HANDLE mapping {nullptr};
+    swarm_ring::Shared *shm {nullptr};
+    std::vector<swarm_ring::Record> batch;  // reused across frames
+    unsigned frames {0};
+
+    static bool ProducerAlive(uint32_t pid) {
+        HANDLE h = OpenProcess(SYNCHRONIZE, FALSE, pid);
+        if(!h) return GetLastError()==ERROR_ACCESS_DENIED; // exists, just not ours to open
+        bool alive = WaitForSingleObject(h, 0)==WAIT_TIMEOUT;
+        CloseHandle(h);
+        return alive;
+    }
+    // Free rings whose producer exited without close(); queued records are still drained
+    void reapDeadProducers() {
+        for(uint32_t i=0;i<swarm_ring::kProducers;i++) {
+            uint32_t pid = shm->rings[i].owner.v.load();
+            if(pid && !ProducerAlive(pid) && shm->rings[i].owner.v.compare_exchange_strong(pid, 0))
+                printf("Ring: producer pid=%u gone, ring %u freed\n", pid, i);
+        }
+    }
+    // deferred: script cursors, removed afterwards through the full remove command
+    void applyLocked(const swarm_ring::Record &r, std::vector<int> &deferred) {
+        using namespace swarm_ring;
+        switch(r.type) {
+            case kPos: gManager.setPosLocked(r.id, r.x, r.y); break;
+            case kColor:
+                gManager.modifyLocked(r.id, [&](SwarmCursor &c){ c.color = RGB((r.color>>16)&255, (r.color>>8)&255, r.color&255); });
+                break;
+            case kAdd: {
+                // Script cursors need a path + process: add those through the pipe
+                if(r.behavior >= kBehaviorCount || r.behavior==(uint16_t)BehaviorType::Script) break;
+                SwarmCursor c; c.id = r.id; c.behavior = (BehaviorType)r.behavior;
+                c.color = RGB((r.color>>16)&255, (r.color>>8)&255, r.color&255);
+                if(r.size>2 && r.size<400) c.size = r.size;
+                if(c.behavior==BehaviorType::Mirror) { c.offsetX = r.x; c.offsetY = r.y; }
+                else { c.target.x = r.x; c.target.y = r.y; c.pos = c.target; }
+                gManager.addCursorLocked(c);
+            } break;
+            case kRemove:
+                if(gManager.coldLocked(r.id)) deferred.push_back(r.id);
+                else gManager.removeCursorLocked(r.id);
+                break;
+            default: rejected++; return;
+        }
+        applied++;
+    }
+public:
+    std::atomic<unsigned long long> applied {0}, rejected {0};
+
+    bool open() {
+        mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)sizeof(swarm_ring::Shared), swarm_ring::kMappingName);
+        if(!mapping) { printf("Ring: CreateFileMapping failed gle=%lu\n", GetLastError()); return false; }
+        bool existed = GetLastError()==ERROR_ALREADY_EXISTS;
+        shm = static_cast<swarm_ring::Shared*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(swarm_ring::Shared)));
+        if(!shm) { printf("Ring: MapViewOfFile failed gle=%lu\n", GetLastError()); close(); return false; }
+        if(!existed) swarm_ring::InitHeader(shm->hdr); // fresh pages are zeroed: every ring free and empty
+        else if(!swarm_ring::HeaderValid(shm->hdr)) { printf("Ring: existing mapping has a different layout\n"); close(); return false; }
+        batch.reserve(swarm_ring::kCapacity);
+        printf("Ring: %ls ready (%u producers x %u records)\n", swarm_ring::kMappingName, swarm_ring::kProducers, swarm_ring::kCapacity);
+        return true;
+    }
+    void close() {
+        if(shm) { UnmapViewOfFile(shm); shm = nullptr; }
+        if(mapping) { CloseHandle(mapping); mapping = nullptr; }
+    }
+    unsigned long long dropped() const {
+        unsigned long long n = 0;
+        if(shm) for(auto &r : shm->rings) n += r.dropped.v.load(std::memory_order_relaxed);
+        return n;
+    }
+    // Idle poll: any producer published records the update thread has not drained yet
+    bool pending() const {
+        if(shm) for(auto &r : shm->rings) if(r.head.v.load(std::memory_order_acquire) != r.tail.v.load(std::memory_order_relaxed)) return true;
+        return false;
+    }
+    // UpdateThread, once per frame: copy out every ring, then apply the batch under one mtx acquisition
+    void drain() {
+        if(!shm) return;
+        batch.clear();
+        for(auto &r : shm->rings) {
+            uint32_t tail = r.tail.v.load(std::memory_order_relaxed);
+            uint32_t head = r.head.v.load(std::memory_order_acquire);
+            if(head - tail > swarm_ring::kCapacity) { r.tail.v.store(head, std::memory_order_release); continue; } // producer wrote garbage: resync
+            for(; tail != head; ++tail) batch.push_back(r.records[tail & (swarm_ring::kCapacity - 1)]);
+            r.tail.v.store(tail, std::memory_order_release);
+        }
+        if(++frames % 60 == 0) reapDeadProducers();
+        if(!batch.empty()) apply(batch.data(), batch.size());
+    }
+    // Ring drain and SwarmPipe record frames: validate + apply n records under one mtx acquisition
+    void apply(const swarm_ring::Record *recs, size_t n) {
+        std::vector<int> deferred;
+        {
+            ManagerLock lock(gManager.mtx);
+            for(size_t i=0;i<n;i++) applyLocked(recs[i], deferred);
+        }
+        for(int id : deferred) handleCommand(std::string("{\"cmd\":\"remove\",\"id\":")+std::to_string(id)+"}");
+    }
+    ~RingServer() { close(); }
+};
+static RingServer gRing;
+
+static void ApplyRecordBatch(const swarm_ring::Record *recs, size_t n) { gIdle.wake(); gRing.apply(recs, n); }
+
+static void RingStats(unsigned long long &applied, unsigned long long &rejected, unsigned long long &dropped) {
+    applied = gRing.applied.load(); rejected = gRing.rejected.load(); dropped = gRing.dropped();
+}
+
+// ---------------- Position stream (stream/subscribe) ----------------
+// UpdateThread, at the requested rate: diff the just-published render snapshot against what the
+// stream last sent and emit one "frame" event with only the moved/new cursors and the removed ids.
+// Every hz-th frame (about once a second) is a keyframe carrying every cursor, so a subscriber that
+// joins late or was rate-limited converges. Each SwarmPipeOut subscriber has its own rate (removed when it
+// disconnects), SwarmPipe commands share rate 0, and the stream runs at the highest one.
+class PositionStream {
+    struct Sent { LONG x, y; uint32_t tick; };
+    std::unordered_map<int, Sent> last; // UpdateThread only
+    std::mutex ratesMtx;
+    std::unordered_map<int, double> rates; // subscriber -> hz (guarded by ratesMtx)
+    std::atomic<double> hz {0};                 // max of rates
+    std::atomic<bool> wantKey {false};
+    uint32_t tick {0};
+    std::chrono::steady_clock::time_point next {};
+    std::string out;
+    std::vector<int> gone;
+public:
+    // Returns the resulting stream rate
+    double setRate(int subscriber, double h) {
+        std::lock_guard<std::mutex> lk(ratesMtx);
+        if(h > 0) { rates[subscriber] = std::min(h, 240.0); wantKey = true; } // (re)subscribe starts with a keyframe
+        else rates.erase(subscriber);
+        return publishLocked();
+    }
+    void drop(int subscriber) {
+        std::lock_guard<std::mutex> lk(ratesMtx);
+        if(rates.erase(subscriber)) publishLocked();
+    }
+    double rate() const { return hz.load(); }
+private:
+    double publishLocked() {
+        double m = 0;
+        for(auto &kv : rates) m = std::max(m, kv.second);
+        hz = m;
+        return m;
+    }
+public:
+    void frame(unsigned long long frameNo, std::chrono::steady_clock::time_point now, double tMs) {
+        double h = hz.load();
+        if(h <= 0 || gEvents.subscriberCount()==0) { if(!last.empty()) last.clear(); tick = 0; return; } // next frame after resume is a keyframe
+        if(now < next) return;
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / h));
+        next = (next==std::chrono::steady_clock::time_point{} || now - next > period) ? now + period : next + period;
+        ++tick;
+        bool key = wantKey.exchange(false) || last.empty() || tick % (uint32_t)std::max(1.0, h) == 0;
+        char head[160];
+        snprintf(head, sizeof(head), "{\"event\":\"frame\",\"frame\":%llu,\"t\":%.3f,\"key\":%s,\"c\":[", frameNo, tMs, key ? "true" : "false");
+        out.assign(head);
+        size_t changed = 0;
+        {
+            RenderSnapshot::View view(gManager.snapshot);
+            for(const auto &r : view.records()) {
+                auto ins = last.try_emplace(r.id, Sent{ r.pos.x, r.pos.y, tick });
+                Sent &s = ins.first->second;
+                bool moved = ins.second || s.x != r.pos.x || s.y != r.pos.y;
+                s.x = r.pos.x; s.y = r.pos.y; s.tick = tick;
+                if(!moved && !key) continue;
+                char item[48]; int n = snprintf(item, sizeof(item), "%s[%d,%ld,%ld]", changed ? "," : "", r.id, r.pos.x, r.pos.y);
+                out.append(item, (size_t)n); changed++;
+            }
+        }
+        gone.clear();
+        for(auto it = last.begin(); it != last.end();) {
+            if(it->second.tick != tick) { gone.push_back(it->first); it = last.erase(it); }
+            else ++it;
+        }
+        if(!changed && gone.empty() && !key) return; // nothing moved: no event
+        out += "],\"gone\":[";
+        for(size_t i=0;i<gone.size();i++) { out += (i ? "," : ""); out += std::to_string(gone[i]); }
+        out += "]}\n";
+        sendOut(out);
+    }
+};
+static PositionStream gStream;
+
+static double SetStreamRate(int subscriber, double hz) { return gStream.setRate(subscriber, hz); }
+static void StreamSubscriberClosed(int subscriber) { gStream.drop(subscriber); }
+
+// ---------------- Recording (record/start, record/stop) ----------------
+// UpdateThread encodes every published snapshot with swarm_rec::Writer (only the cursors that changed,
+// a keyframe every kKeyInterval frames) and appends it through a 1 MB stream buffer; record/stop writes
+// the keyframe index. mtx serializes the command threads against UpdateThread.
+class Recorder {
+    std::mutex mtx;
+    std::ofstream file;
+    std::vector<char> buf;
+    std::string path, out;
+    swarm_rec::Writer writer;
+    std::chrono::steady_clock::time_point t0;
+    std::atomic<bool> active {false};
+public:
+    bool start(const std::string &p, std::string &err) {
+        std::lock_guard<std::mutex> g(mtx);
+        if(active) { err = "already recording " + path; return false; }
+        buf.resize(1 << 20);
+        file.rdbuf()->pubsetbuf(buf.data(), (std::streamsize)buf.size());
+        file.open(p, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!file) { file.clear(); err = "cannot create " + p; return false; }
+        path = p; out.clear();
+        writer.begin(out);
+        file.write(out.data(), (std::streamsize)out.size());
+        t0 = std::chrono::steady_clock::now();
+        active = true;
+        return true;
+    }
+    void frame(unsigned long long frameNo, std::chrono::steady_clock::time_point now) {
+        if(!active.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> g(mtx);
+        if(!active) return;
+        uint64_t ticks = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - t0).count() / swarm_rec::kTickUs;
+        out.clear();
+        { RenderSnapshot::View view(gManager.snapshot); writer.frame(frameNo, ticks, view.records(), out); }
+        file.write(out.data(), (std::streamsize)out.size());
+    }
+    // {"event":"recordStopped",...}, or "" when not recording
+    std::string stop() {
+        std::lock_guard<std::mutex> g(mtx);
+        if(!active) return "";
+        active = false;
+        out.clear(); writer.finish(out);
+        file.write(out.data(), (std::streamsize)out.size());
+        bool ok = (bool)file;
+        file.close(); file.clear();
+        char b[160]; snprintf(b, sizeof(b), "\",\"frames\":%llu,\"keyframes\":%zu,\"bytes\":%llu,\"ok\":%s}\n",
+            (unsigned long long)writer.frameCount(), writer.keys.size(), (unsigned long long)writer.offset, ok ? "true" : "false");
+        return "{\"event\":\"recordStopped\",\"path\":\"" + path + b;
+    }
+};
+static Recorder gRecorder;
+
+// ---------------- Playback (play/start, play/stop) ----------------
+// The recording is memory-mapped read-only and decoded in place: no text, no copy of the file. The
+// trailer's keyframe index makes opening and seeking O(1) in the file length. Each frame UpdateThread
+// advances the playback clock by real elapsed time x speed, decodes every block due, and applies them
+// to static cursors it owns under one mtx acquisition: only the ids those blocks touched, or a full
+// reconcile after a keyframe or seek. Playback cursors come and go without cursor events.
+class Player {
+    struct Live { int id; uint32_t gen; uint32_t tick; };
+    std::mutex mtx;
+    HANDLE fileH {INVALID_HANDLE_VALUE}, mapH {nullptr};
+    const uint8_t *view {nullptr};
+    swarm_rec::Reader reader;
+    std::unordered_map<int32_t, Live> live; // recorded id -> overlay cursor
+    std::vector<int32_t> touched;
+    std::string path;
+    double clock {0}, speed {1};            // clock in ticks
+    std::chrono::steady_clock::time_point last;
+    bool full {false};
+    uint32_t tick {0};
+    unsigned long long frames {0};
+    std::atomic<bool> active {false};
+
+    void unmap() {
+        if(view) { UnmapViewOfFile(view); view = nullptr; }
+        if(mapH) { CloseHandle(mapH); mapH = nullptr; }
+        if(fileH != INVALID_HANDLE_VALUE) { CloseHandle(fileH); fileH = INVALID_HANDLE_VALUE; }
+    }
+    void removeAllLocked() {
+        for(auto &kv : live) gManager.removeCursorLocked(kv.second.id, kv.second.gen);
+        live.clear();
+    }
+    void removeLocked(std::unordered_map<int32_t, Live>::iterator it) {
+        gManager.removeCursorLocked(it->second.id, it->second.gen);
+        live.erase(it);
+    }
+    // By id and generation: after a cursor/clear or remove the id may belong to someone else's cursor
+    void applyLocked(const swarm_rec::Cursor &c) {
+        COLORREF color = (COLORREF)(c.color & 0xFFFFFF);
+        int size = std::clamp(c.size, 3, 399); // as cursor/add: a damaged file must not reach the renderer
+        auto it = live.find(c.id);
+        if(it != live.end()) {
+            it->second.tick = tick;
+            if(gManager.modifyLocked(it->second.id, [&](SwarmCursor &s) {
+                s.pos = s.target = POINT{ c.x, c.y }; s.color = color; s.size = size;
+            }, it->second.gen)) return;
+            live.erase(it); // removed locally: added again below
+        }
+        SwarmCursor sc; sc.behavior = BehaviorType::Static;
+        sc.pos = sc.target = POINT{ c.x, c.y }; sc.color = color; sc.size = size;
+        uint32_t gen = 0;
+        if(int id = gManager.addCursorLocked(sc, &gen)) live.emplace(c.id, Live{ id, gen, tick });
+    }
+    std::string doneEvent(const char *reason) {
+        char b[128]; snprintf(b, sizeof(b), "\",\"frames\":%llu,\"reason\":\"%s\"}\n", frames, reason);
+        return "{\"event\":\"playStopped\",\"path\":\"" + path + b;
+    }
+public:
+    bool playing() const { return active.load(); }
+    // Overlay ids of the cursors playback drives, sorted (state/save leaves them out)
+    void ownedIds(std::vector<int> &out) {
+        out.clear();
+        std::lock_guard<std::mutex> g(mtx);
+        for(auto &kv : live) out.push_back(kv.second.id);
+        std::sort(out.begin(), out.end());
+    }
+    bool start(const std::string &p, double rate, double atMs, std::string &err, std::string &started) {
+        std::lock_guard<std::mutex> g(mtx);
+        if(active) { err = "already playing " + path; return false; }
+        fileH = CreateFileW(std::filesystem::path(p).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size {};
+        if(fileH == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileH, &size) || size.QuadPart == 0) { err = "cannot open " + p; unmap(); return false; }
+        mapH = CreateFileMappingW(fileH, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        view = mapH ? static_cast<const uint8_t*>(MapViewOfFile(mapH, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        if(!view) { err = "cannot map " + p + " gle=" + std::to_string(GetLastError()); unmap(); return false; }
+        if(!reader.open(view, (size_t)size.QuadPart, err)) { unmap(); return false; }
+        uint64_t at = (uint64_t)(std::max(0.0, atMs) * 1000.0 / swarm_rec::kTickUs);
+        reader.seek(at);
+        uint64_t t; bool key;
+        while(reader.peekTime(t) && t <= at && reader.next(key)) {} // decode forward from the keyframe to atMs
+        path = p; speed = std::clamp(rate, 0.05, 100.0); clock = (double)at; frames = 0;
+        full = true; last = std::chrono::steady_clock::now();
+        active = true;
+        char b[256]; snprintf(b, sizeof(b), "\",\"durationMs\":%.0f,\"keyframes\":%zu,\"indexed\":%s,\"speed\":%.2f,\"atMs\":%.0f}\n",
+            reader.duration * swarm_rec::kTickUs / 1000.0, reader.keys.size(), reader.indexed ? "true" : "false", speed, at * swarm_rec::kTickUs / 1000.0);
+        started = "{\"event\":\"playing\",\"path\":\"" + p + b;
+        return true;
+    }
+    // UpdateThread, before updateAll
+    void frame(std::chrono::steady_clock::time_point now) {
+        if(!active.load(std::memory_order_relaxed)) return;
+        std::string done;
+        {
+            std::lock_guard<std::mutex> g(mtx);
+            if(!active) return;
+            clock += std::chrono::duration<double, std::micro>(now - last).count() / swarm_rec::kTickUs * speed;
+            last = now;
+            touched.clear();
+            uint64_t t; bool key, more = true;
+            for(;;) {
+                if(!reader.peekTime(t)) { more = false; break; } // end, or a block cut off mid-write
+                if(t > clock) break;
+                if(!reader.next(key)) { more = false; break; }
+                frames++;
+                if(key) full = true;
+                else for(const auto &ch : reader.changes) touched.push_back(ch.c.id);
+            }
+            ManagerLock lock(gManager.mtx);
+            ++tick;
+            if(full) { // keyframe or seek: the reader's state is the whole truth
+                for(const auto &kv : reader.state) applyLocked(kv.second);
+                for(auto it = live.begin(); it != live.end();) {
+                    if(it->second.tick != tick) { gManager.removeCursorLocked(it->second.id, it->second.gen); it = live.erase(it); }
+                    else ++it;
+                }
+                full = false;
+            } else {
+                for(int32_t id : touched) {
+                    auto st = reader.state.find(id);
+                    if(st != reader.state.end()) applyLocked(st->second);
+                    else if(auto it = live.find(id); it != live.end()) removeLocked(it);
+                }
+            }
+            if(!more) { removeAllLocked(); unmap(); active = false; done = doneEvent("end"); }
+        }
+        if(!done.empty()) sendOut(done);
+    }
+    // {"event":"playStopped",...}, or "" when not playing
+    std::string stop() {
+        std::lock_guard<std::mutex> g(mtx);
+        if(!active) return "";
+        active = false;
+        { ManagerLock lock(gManager.mtx); removeAllLocked(); }
+        unmap();
+        return doneEvent("stop");
+    }
+};
+static Player gPlayer;
+
+// record/start {"path":"x.swrec"} (default swarm_recording.swrec) / record/stop
+static void CmdRecord(const Command &k) {
+    if(k.op == swarm_cmd::Op::RecordStop) {
+        std::string e = gRecorder.stop();
+        sendOut(e.empty() ? std::string("{\"event\":\"error\",\"msg\":\"record: not recording\"}\n") : e);
+        return;
+    }
+    std::string path = k.path.empty() ? std::string(kRecordingFile) : std::string(k.path), err;
+    if(!gRecorder.start(path, err)) { sendOut("{\"event\":\"error\",\"msg\":\"record: " + err + "\"}\n"); return; }
+    char b[96]; snprintf(b, sizeof(b), "\",\"keyInterval\":%u}\n", swarm_rec::kKeyInterval);
+    sendOut("{\"event\":\"recording\",\"path\":\"" + path + b);
+}
+
+// play/start {"path":"x.swrec", "speed":1, "atMs":0} / play/stop
+static void CmdPlay(const Command &k) {
+    if(k.op == swarm_cmd::Op::PlayStop) {
+        std::string e = gPlayer.stop();
+        sendOut(e.empty() ? std::string("{\"event\":\"error\",\"msg\":\"play: not playing\"}\n") : e);
+        return;
+    }
+    std::string path = k.path.empty() ? std::string(kRecordingFile) : std::string(k.path), err, started;
+    if(!gPlayer.start(path, k.has(swarm_cmd::kSpeed) ? k.speed : 1.0, k.atMs, err, started)) { sendOut("{\"event\":\"error\",\"msg\":\"play: " + err + "\"}\n"); return; }
+    gIdle.wake();
+    sendOut(started);
+}
+
+// ---------------- LAN broadcast (net/broadcast, net/subscribe, net/stop) ----------------
+// Publisher: right after updateAll, UpdateThread encodes the frame's snapshot with swarm_net::Encoder
+// and sends the datagrams to a UDP multicast group, so a frame leaves within the frame that produced it.
+// A keyframe goes out every kKeyIntervalMs, also while the overlay idles. Subscriber: a receive thread
+// decodes each datagram and applies it straight to static cursors it owns under one mtx acquisition
+// (no command parsing), then wakes UpdateThread, so a received frame is drawn by the next local frame.
+// An overlay is publisher or subscriber, not both.
+static bool NetStartup(std::string &err) {
+    static std::once_flag once; static int rc = 0;
+    std::call_once(once, []{ WSADATA wsa; rc = WSAStartup(MAKEWORD(2, 2), &wsa); });
+    if(rc) { err = "WSAStartup failed " + std::to_string(rc); return false; }
+    return true;
+}
+static bool NetAddress(const std::string &group, int port, sockaddr_in &a, std::string &err) {
+    a = sockaddr_in{}; a.sin_family = AF_INET; a.sin_port = htons((u_short)port);
+    if(port <= 0 || port > 65535 || inet_pton(AF_INET, group.c_str(), &a.sin_addr) != 1) { err = "bad address " + group + ":" + std::to_string(port); return false; }
+    return true;
+}
+static bool IsMulticast(const sockaddr_in &a) { return (ntohl(a.sin_addr.s_addr) >> 28) == 0xE; } // 224.0.0.0/4
+
+class NetBroadcaster {
+    std::mutex mtx;
+    SOCKET sock {INVALID_SOCKET};
+    sockaddr_in dst {};
+    std::unique_ptr<swarm_net::Encoder> enc;
+    std::vector<std::string> out;
+    std::string group;
+    int port {0};
+    std::chrono::steady_clock::time_point t0, lastKey;
+    unsigned long long datagrams {0}, bytes {0}, keyframes {0}, sendErrors {0};
+    std::atomic<bool> active {false};
+
+    void sendLocked(std::chrono::steady_clock::time_point now, bool key) {
+        out.clear();
+        { RenderSnapshot::View view(gManager.snapshot); enc->frame(view.records(), key, out); }
+        for(const std::string &d : out) {
+            if(sendto(sock, d.data(), (int)d.size(), 0, (const sockaddr*)&dst, (int)sizeof(dst)) == SOCKET_ERROR) sendErrors++;
+            else { datagrams++; bytes += d.size(); }
+        }
+        if(key) { lastKey = now; keyframes++; }
+    }
+public:
+    bool broadcasting() const { return active.load(); }
+    bool start(const std::string &g, int p, int ttl, std::string &err, std::string &started) {
+        std::lock_guard<std::mutex> lk(mtx);
+        if(active) { err = "already broadcasting to " + group + ":" + std::to_string(port); return false; }
+        if(!NetStartup(err) || !NetAddress(g, p, dst, err)) return false;
+        sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if(sock == INVALID_SOCKET) { err = "socket failed " + std::to_string(WSAGetLastError()); return false; }
+        DWORD hops = (DWORD)std::clamp(ttl, 1, 255), on = 1;
+        int sndBuf = 1 << 20; // a keyframe of every cursor goes out in one burst
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&hops, sizeof(hops));
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&on, sizeof(on)); // a subscriber on this machine sees it too
+        setsockopt(sock, SOL_SOCKET, SO_BROADCAST, (const char*)&on, sizeof(on));      // "group" may be a subnet broadcast address
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char*)&sndBuf, sizeof(sndBuf));
+        uint32_t session = (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count() ^ (GetCurrentProcessId() << 16);
+        enc = std::make_unique<swarm_net::Encoder>(session);
+        group = g; port = p; datagrams = bytes = keyframes = sendErrors = 0;
+        t0 = std::chrono::steady_clock::now();
+        sendLocked(t0, true); // subscribers already listening get the full set at once
+        active = true;
+        char b[192]; snprintf(b, sizeof(b), "\",\"port\":%d,\"ttl\":%lu,\"session\":%u,\"keyIntervalMs\":%u,\"maxDatagram\":%zu}\n",
+            port, (unsigned long)hops, session, swarm_net::kKeyIntervalMs, swarm_net::kMaxDatagram);
+        started = "{\"event\":\"netBroadcasting\",\"group\":\"" + group + b;
+        return true;
+    }
+    // UpdateThread, after the frame's snapshot is published
+    void frame(std::chrono::steady_clock::time_point now) {
+        if(!active.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lk(mtx);
+        if(!active) return;
+        sendLocked(now, now - lastKey >= std::chrono::milliseconds(swarm_net::kKeyIntervalMs));
+    }
+    // UpdateThread while idle: nothing changes, but late joiners and lost datagrams still need keyframes
+    void idle(std::chrono::steady_clock::time_point now) {
+        if(!active.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lk(mtx);
+        if(active && now - lastKey >= std::chrono::milliseconds(swarm_net::kKeyIntervalMs)) sendLocked(now, true);
+    }
+    // {"event":"netStopped",...}, or "" when not broadcasting
+    std::string stop() {
+        std::lock_guard<std::mutex> lk(mtx);
+        if(!active) return "";
+        active = false;
+        closesocket(sock); sock = INVALID_SOCKET;
+        double s = std::max(1e-3, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        char b[256]; snprintf(b, sizeof(b), "\",\"port\":%d,\"frames\":%u,\"keyframes\":%llu,\"datagrams\":%llu,\"bytes\":%llu,\"sendErrors\":%llu,\"kbps\":%.1f}\n",
+            port, enc->frames(), keyframes, datagrams, bytes, sendErrors, bytes * 8 / 1000.0 / s);
+        return "{\"event\":\"netStopped\",\"role\":\"broadcast\",\"group\":\"" + group + b;
+    }
+};
+static NetBroadcaster gNetOut;
+
+class NetSubscriber {
+    struct Live { int id; uint32_t gen; uint32_t tick; };
+    std::mutex mtx;                          // start/stop
+    std::mutex liveMtx;                      // live + stream state: receive thread vs ownedIds/stop
+    SOCKET sock {INVALID_SOCKET};
+    std::thread rx;
+    std::unordered_map<int32_t, Live> live;  // publisher id -> overlay cursor
+    std::string group;
+    int port {0};
+    bool haveSession {false};
+    uint32_t session {0}, nextSeq {0}, newest {0}, tick {0};
+    std::atomic<unsigned long long> datagrams {0}, lost {0}, late {0}, malformed {0}, capped {0};
+    std::atomic<bool> active {false};
+
+    void removeAllLocked() {
+        for(auto &kv : live) gManager.removeCursorLocked(kv.second.id, kv.second.gen);
+        live.clear();
+    }
+    // f says which of c's values are present; a cursor we do not have yet needs all of them.
+    // Values are range-checked by Datagram::parse; the colour is masked again as every other input path does.
+    void applyLocked(const swarm_rec::Cursor &c, uint8_t f) {
+        const uint8_t all = swarm_rec::kPos | swarm_rec::kColor | swarm_rec::kSize;
+        auto it = live.find(c.id);
+        if(it != live.end()) {
+            it->second.tick = tick;
+            if(gManager.modifyLocked(it->second.id, [&](SwarmCursor &s) {
+                if(f & swarm_rec::kPos) s.pos = s.target = POINT{ c.x, c.y };
+                if(f & swarm_rec::kColor) s.color = (COLORREF)(c.color & 0xFFFFFF);
+                if(f & swarm_rec::kSize) s.size = c.size;
+            }, it->second.gen)) return;
+            live.erase(it); // removed locally (cursor/clear, state/load): re-added below if the values allow
+        }
+        if((f & all) != all) return; // the next keyframe brings it back
+        if(live.size() >= swarm_net::kMaxCursors) { capped++; return; }
+        SwarmCursor sc; sc.behavior = BehaviorType::Static;
+        sc.pos = sc.target = POINT{ c.x, c.y }; sc.color = (COLORREF)(c.color & 0xFFFFFF); sc.size = c.size;
+        uint32_t gen = 0;
+        if(int id = gManager.addCursorLocked(sc, &gen)) live.emplace(c.id, Live{ id, gen, tick });
+    }
+    void apply(const swarm_net::Datagram &g) {
+        std::lock_guard<std::mutex> lk(liveMtx);
+        if(!haveSession || g.h.session != session) { // first datagram, or the publisher restarted
+            if(haveSession) { ManagerLock lock(gManager.mtx); removeAllLocked(); }
+            haveSession = true; session = g.h.session; newest = g.h.frame; nextSeq = g.h.seq;
+        }
+        if((int32_t)(g.h.frame - newest) < 0) { late++; return; } // reordered behind a newer frame: stale
+        newest = g.h.frame;
+        if((int32_t)(g.h.seq - nextSeq) > 0) lost += g.h.seq - nextSeq;
+        if((int32_t)(g.h.seq - nextSeq) >= 0) nextSeq = g.h.seq + 1;
+        ManagerLock lock(gManager.mtx);
+        ++tick;
+        for(const swarm_net::Change &ch : g.changes) {
+            if(ch.flags & swarm_rec::kGone) {
+                if(auto it = live.find(ch.c.id); it != live.end()) { gManager.removeCursorLocked(it->second.id, it->second.gen); live.erase(it); }
+            } else {
+                applyLocked(ch.c, ch.flags);
+            }
+        }
+        if(g.h.kind == 'K') { // this part is the whole truth for [idLo, idHi]
+            for(auto it = live.begin(); it != live.end();) {
+                if(it->first >= g.idLo && it->first <= g.idHi && it->second.tick != tick) { gManager.removeCursorLocked(it->second.id, it->second.gen); it = live.erase(it); }
+                else ++it;
+            }
+        }
+    }
+    void receive() {
+        SWARM_TRACE_THREAD("NetReceive");
+        std::vector<uint8_t> buf(64 * 1024);
+        swarm_net::Datagram g;
+        while(active) {
+            int n = recv(sock, (char*)buf.data(), (int)buf.size(), 0);
+            if(n == SOCKET_ERROR) {
+                if(!active || WSAGetLastError() == WSAENOTSOCK) break; // stop() closed the socket
+                continue;
+            }
+            if(!g.parse(buf.data(), (size_t)n)) { malformed++; continue; }
+            datagrams++;
+            apply(g);
+            gIdle.wake();
+        }
+    }
+public:
+    bool subscribed() const { return active.load(); }
+    // Overlay ids of the cursors the subscription drives, sorted (state/save leaves them out)
+    void ownedIds(std::vector<int> &out) {
+        out.clear();
+        std::lock_guard<std::mutex> lk(liveMtx);
+        for(auto &kv : live) out.push_back(kv.second.id);
+        std::sort(out.begin(), out.end());
+    }
+    bool start(const std::string &g, int p, std::string &err, std::string &started) {
+        std::lock_guard<std::mutex> lk(mtx);
+        if(active) { err = "already subscribed to " + group + ":" + std::to_string(port); return false; }
+        sockaddr_in a {};
+        if(!NetStartup(err) || !NetAddress(g, p, a, err)) return false;
+        sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if(sock == INVALID_SOCKET) { err = "socket failed " + std::to_string(WSAGetLastError()); return false; }
+        DWORD on = 1;
+        int rcvBuf = 4 << 20; // rides out a burst of keyframes while the mtx is busy
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on)); // several subscribers on one machine
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvBuf, sizeof(rcvBuf));
+        sockaddr_in any {}; any.sin_family = AF_INET; any.sin_port = a.sin_port; any.sin_addr.s_addr = htonl(INADDR_ANY);
+        if(bind(sock, (const sockaddr*)&any, (int)sizeof(any)) == SOCKET_ERROR) {
+            err = "bind port " + std::to_string(p) + " failed " + std::to_string(WSAGetLastError());
+            closesocket(sock); sock = INVALID_SOCKET; return false;
+        }
+        if(IsMulticast(a)) {
+            ip_mreq m {}; m.imr_multiaddr = a.sin_addr; m.imr_interface.s_addr = htonl(INADDR_ANY);
+            if(setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&m, sizeof(m)) == SOCKET_ERROR) {
+                err = "join " + g + " failed " + std::to_string(WSAGetLastError());
+                closesocket(sock); sock = INVALID_SOCKET; return false;
+            }
+        }
+        group = g; port = p; haveSession = false;
+        datagrams = lost = late = malformed = capped = 0;
+        active = true;
+        rx = std::thread(&NetSubscriber::receive, this);
+        char b[96]; snprintf(b, sizeof(b), "\",\"port\":%d,\"multicast\":%s}\n", port, IsMulticast(a) ? "true" : "false");
+        started = "{\"event\":\"netSubscribed\",\"group\":\"" + group + b;
+        return true;
+    }
+    // {"event":"netStopped",...}, or "" when not subscribed
+    std::string stop() {
+        std::lock_guard<std::mutex> lk(mtx);
+        if(!active) return "";
+        active = false;
+        closesocket(sock); sock = INVALID_SOCKET; // unblocks recv
+        if(rx.joinable()) rx.join();
+        size_t cursors;
+        {
+            std::lock_guard<std::mutex> g(liveMtx);
+            cursors = live.size();
+            ManagerLock lock(gManager.mtx);
+            removeAllLocked();
+        }
+        char b[256]; snprintf(b, sizeof(b), "\",\"port\":%d,\"datagrams\":%llu,\"lost\":%llu,\"late\":%llu,\"malformed\":%llu,\"capped\":%llu,\"cursors\":%zu}\n",
+            port, datagrams.load(), lost.load(), late.load(), malformed.load(), capped.load(), cursors);
+        return "{\"event\":\"netStopped\",\"role\":\"subscribe\",\"group\":\"" + group + b;
+    }
+};
+static NetSubscriber gNetIn;
+
+// net/broadcast {"group":"239.255.77.1", "port":47800, "ttl":1} / net/subscribe {"group", "port"} / net/stop
+static void CmdNet(const Command &k) {
+    using swarm_cmd::Op;
+    if(k.op == Op::NetStop) {
+        std::string e = gNetOut.stop();
+        if(e.empty()) e = gNetIn.stop();
+        sendOut(e.empty() ? std::string("{\"event\":\"error\",\"msg\":\"net: not broadcasting or subscribed\"}\n") : e);
+        return;
+    }
+    std::string group = k.group.empty() ? std::string(swarm_net::kDefaultGroup) : std::string(k.group), err, started;
+    int port = k.has(swarm_cmd::kPort) ? k.port : swarm_net::kDefaultPort;
+    bool ok;
+    if(k.op == Op::NetBroadcast) {
+        if(gNetIn.subscribed()) { sendOut("{\"event\":\"error\",\"msg\":\"net: subscribed; net/stop first\"}\n"); return; }
+        ok = gNetOut.start(group, port, k.has(swarm_cmd::kTtl) ? k.ttl : 1, err, started);
+    } else {
+        if(gNetOut.broadcasting()) { sendOut("{\"event\":\"error\",\"msg\":\"net: broadcasting; net/stop first\"}\n"); return; }
+        ok = gNetIn.start(group, port, err, started);
+    }
+    if(!ok) { sendOut("{\"event\":\"error\",\"msg\":\"net: " + err + "\"}\n"); return; }
+    sendOut(started);
+}
+
 void UpdateThread() {
+    SWARM_TRACE_THREAD("UpdateThread");
+    gPacer.open();
     auto last = std::chrono::high_resolution_clock::now();
+    const auto start = std::chrono::steady_clock::now();
     double emaMs = 16.0;
+    std::vector<RECT> dirty; dirty.reserve(SwarmManager::kMaxDirtyRects);
+    POINT lastPos {}; GetCursorPos(&lastPos);
+    int quietFrames = 0;
     while(gManager.running) {
+        uint64_t activity = gIdle.mark();
+        auto frameStart = swarm_prof::Clock::now();
         auto now = std::chrono::high_resolution_clock::now();
-        double dt = std::chrono::duration<double>(now-last).count();
+        double frameMs = std::chrono::duration<double, std::milli>(now-last).count();
+        double dt = gPacer.clampDt(frameMs / 1000.0); // a stall must not fling Orbit/FollowLag
         last = now;
         POINT p; GetCursorPos(&p);
     // (windowed mode removed; system cursor coords used directly)
-        gManager.updateAll(dt, p);
-        if(gManager.overlayWnd) InvalidateRect(gManager.overlayWnd, nullptr, FALSE);
-        double frameMs = dt*1000.0;
+        unsigned long long frameNo = ++gFrameCount;
+        SWARM_TRACE_FRAME(frameNo);
+        { SWARM_TRACE_ZONE("ringDrain"); gRing.drain(); } // shared-memory producers: applied before this frame's simulation step
+        gPlayer.frame(std::chrono::steady_clock::now());
+        { SWARM_TRACE_ZONE("updateAll"); swarm_prof::ScopedTimer t(Prof(Probe::Update)); gManager.updateAll(dt, p); }
+        {
+            auto t = std::chrono::steady_clock::now();
+            gStream.frame(frameNo, t, std::chrono::duration<double, std::milli>(t - start).count());
+            gRecorder.frame(frameNo, t);
+            gNetOut.frame(t);
+        }
+        gManager.takeDirty(dirty);
+        bool pendingFull = false;
+        {
+            SWARM_TRACE_ZONE("renderFrame");
+            std::lock_guard<std::mutex> lk(gRenderMtx);
+            for(auto &sf : gSurfaces) if(sf.renderer) { pendingFull |= sf.renderer->needsFull.load(); sf.renderer->frame(sf.hwnd, dirty); }
+        }
+        bool quiet = dirty.empty() && !pendingFull && p.x==lastPos.x && p.y==lastPos.y && !gPlayer.playing(); // playback runs on the wall clock
+        lastPos = p;
+        gPacer.record(frameMs);
+        Prof(Probe::FrameWork).record(swarm_prof::ElapsedNs(frameStart));
         emaMs = emaMs*0.9 + frameMs*0.1;
         gAvgFrameMs = emaMs;
         if(emaMs>0.01) gLastFPS = 1000.0/emaMs;
-        std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60fps
+        quietFrames = quiet ? quietFrames + 1 : 0;
+        if(quietFrames >= IdleGate::kQuietFrames && gIdle.enter(activity)) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            while(gManager.running && !gIdle.waitOnce()) {
+                ++gIdlePolls;
+                gNetOut.idle(std::chrono::steady_clock::now());
+                POINT q; GetCursorPos(&q);
+                if(q.x != p.x || q.y != p.y || gRing.pending()) break;
+            }
+            last = std::chrono::high_resolution_clock::now(); // first active frame gets a normal dt, not the idle gap
+            gIdle.leave(std::chrono::duration<double, std::milli>(last - t0).count());
+            gPacer.resync();
+            quietFrames = 0;
+            continue;
+        }
+        gPacer.wait();
     }
 }
 
 static std::atomic<std::filesystem::file_time_type> gLastConfigTime;
 
+// swarm_config.jsonl is declarative for cursors: each cursor/add line describes one cursor the config owns,
+// and a reload applies only the difference from what the previous load created, under one lock:
+//   unchanged line     -> its cursor is left alone (and keeps whatever was changed over the pipe)
+//   new line           -> cursor added
+//   deleted line       -> its cursor removed
+//   edited line + "id" -> that cursor updated in place, as cursor/update would; a changed "script"
+//                         stops the old script and launches the new one (failed if the launch fails)
+//   edited line, no id -> a different cursor: the old one removed, a new one added
+// Every other line (config/frame, state/autosave, debug/mode, ...) is a setting and runs through
+// handleCommand on each reload. One configReloaded event summarizes the diff.
+struct ConfigCursor { int id; uint32_t gen; std::string line; };
+static std::mutex gConfigMtx;
+static std::unordered_map<std::string, ConfigCursor> gConfigCursors; // line key -> cursor (guarded by gConfigMtx)
+
+static void ApplyConfig(const std::vector<std::string> &lines) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> g(gConfigMtx);
+    struct Want { std::string key; const std::string *line; Command k; };
+    std::vector<Want> want;
+    std::vector<const std::string*> settings;
+    std::unordered_map<std::string, int> repeats; // identical id-less lines are separate cursors
+    for(const std::string &line : lines) {
+        Command k;
+        if(!swarm_cmd::Parse(line, k)) continue;
+        if(k.op != swarm_cmd::Op::Add) { settings.push_back(&line); continue; }
+        std::string key = k.has(swarm_cmd::kId) ? "id:" + std::to_string(k.id) : line + "#" + std::to_string(++repeats[line]);
+        want.push_back(Want{ std::move(key), &line, k });
+    }
+    std::unordered_map<std::string, ConfigCursor> next;
+    std::vector<int> stopPipes;
+    auto keepPipe = [&](int id) { stopPipes.erase(std::remove(stopPipes.begin(), stopPipes.end(), id), stopPipes.end()); }; // relaunched: addScript replaced it
+    size_t added = 0, updated = 0, removed = 0, kept = 0, failed = 0;
+    {
+        ManagerLock lock(gManager.mtx);
+        auto alive = [](const ConfigCursor &c) { BehaviorType b; size_t i; return gManager.findLocked(c.id, b, i, c.gen); };
+        // Removals first, so an id freed by a deleted line can be taken by a new one
+        std::unordered_map<std::string, size_t> wanted;
+        for(size_t w=0;w<want.size();w++) wanted.emplace(want[w].key, w);
+        for(auto it = gConfigCursors.begin(); it != gConfigCursors.end();) {
+            if(wanted.count(it->first)) { ++it; continue; }
+            if(alive(it->second)) {
+                if(CursorCold *cc = gManager.coldLocked(it->second.id)) { CleanupScriptProcess(*cc); stopPipes.push_back(it->second.id); }
+                gManager.removeCursorLocked(it->second.id, it->second.gen);
+                removed++;
+            }
+            it = gConfigCursors.erase(it);
+        }
+        for(Want &w : want) {
+            const Command &k = w.k;
+            auto prev = gConfigCursors.find(w.key);
+            bool live = prev != gConfigCursors.end() && alive(prev->second);
+            if(live && prev->second.line == *w.line) { next.emplace(w.key, prev->second); kept++; continue; }
+            if(RejectUnknownPlugin(k, true)) { failed++; continue; }
+            if(live) { // same explicit id, edited line
+                const ConfigCursor &c = prev->second;
+                BehaviorType behavior = BehaviorType::Static;
+                if(!gManager.modifyLocked(c.id, [&](SwarmCursor &sc) { ApplyCursorFields(sc, k); behavior = sc.behavior; }, c.gen)) { failed++; continue; }
+                std::string script = k.has(swarm_cmd::kScript) ? std::string(k.script) : std::string();
+                CursorCold *cc = gManager.coldLocked(c.id);
+                bool ok = true;
+                if(script != (cc ? cc->scriptPath : std::string())) {
+                    if(cc) CleanupScriptProcess(*cc);
+                    gManager.vms.erase(c.id);
+                    CursorCold &nc = gManager.cold[c.id];
+                    nc.scriptPath = script;
+                    if(behavior==BehaviorType::Script && !script.empty()) { ok = LaunchScriptProcess(c.id, nc); keepPipe(c.id); }
+                    else stopPipes.push_back(c.id);
+                }
+                next.emplace(w.key, ConfigCursor{ c.id, c.gen, *w.line }); // failed launches retry only once the line changes again
+                if(ok) updated++; else failed++;
+                continue;
+            }
+            SwarmCursor c = CursorFromCommand(k);
+            uint32_t gen = 0;
+            int id = gManager.addCursorLocked(c, &gen);
+            if(!id) { failed++; continue; }
+            if(c.behavior==BehaviorType::Script) if(CursorCold *cc = gManager.coldLocked(id)) { LaunchScriptProcess(id, *cc); keepPipe(id); } // id freed above: keep the new pipe
+            next.emplace(w.key, ConfigCursor{ id, gen, *w.line });
+            added++;
+        }
+    }
+    for(int id : stopPipes) StopScriptPipe(id);
+    LoadPendingScripts();
+    gConfigCursors.swap(next);
+    for(const std::string *line : settings) handleCommand(*line);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    printf("Hot-reload: %zu added, %zu updated, %zu removed, %zu unchanged, %zu failed, %zu settings (%.1f ms)\n", added, updated, removed, kept, failed, settings.size(), ms);
+    char b[224]; snprintf(b, sizeof(b), "{\"event\":\"configReloaded\",\"added\":%zu,\"updated\":%zu,\"removed\":%zu,\"unchanged\":%zu,\"failed\":%zu,\"settings\":%zu,\"ms\":%.1f}\n",
+        added, updated, removed, kept, failed, settings.size(), ms);
+    sendOut(b);
+}
+
 void ReloadConfigIfChanged(bool force) {
     try {
         if(std::filesystem::exists(kConfigFile)) {
             auto mod = std::filesystem::last_write_time(kConfigFile);
             if(force || gLastConfigTime.load() != mod) {
+                SWARM_TRACE_ZONE("configReload");
                 gLastConfigTime = mod;
                 printf("Hot-reload: reloading %s\n", kConfigFile);
                 std::ifstream in(kConfigFile, std::ios::in);
                 if(in) {
-                    std::string line; while(std::getline(in,line)) { if(line.empty()|| line[0]=='#') continue; handleCommand(line); }
+                    std::vector<std::string> lines;
+                    std::string line; while(std::getline(in,line)) { if(line.empty()|| line[0]=='#') continue; lines.push_back(line); }
+                    ApplyConfig(lines);
                 }
             }
         }
     } catch(...) { /* ignore */ }
 }
 
+// ReadDirectoryChangesW on the config file's directory (overlapped, so the wait can time out for autosave
+// and shutdown). Reports only changes to the config file itself; a notify-buffer overflow counts as one.
+class ConfigWatch {
+    HANDLE dir {INVALID_HANDLE_VALUE}, ev {nullptr};
+    OVERLAPPED ov {};
+    alignas(DWORD) char buf[4096];
+    std::wstring name;
+    bool arm() {
+        ov = OVERLAPPED{}; ov.hEvent = ev;
+        return ReadDirectoryChangesW(dir, buf, sizeof(buf), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE, nullptr, &ov, nullptr) != 0;
+    }
+    bool isConfig(const WCHAR *fn, size_t len) const {
+        if(len != name.size()) return false;
+        for(size_t i=0;i<len;i++) if(towlower(fn[i]) != towlower(name[i])) return false;
+        return true;
+    }
+public:
+    bool open(const char *file) {
+        std::error_code ec;
+        std::filesystem::path p = std::filesystem::absolute(file, ec);
+        if(ec) return false;
+        name = p.filename().wstring();
+        dir = CreateFileW(p.parent_path().wstring().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if(dir == INVALID_HANDLE_VALUE) return false;
+        ev = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        return ev && arm();
+    }
+    // True if the config file changed within ms
+    bool wait(DWORD ms) {
+        if(WaitForSingleObject(ev, ms) != WAIT_OBJECT_0) return false;
+        DWORD n = 0; bool hit = false;
+        if(GetOverlappedResult(dir, &ov, &n, FALSE)) {
+            if(n == 0) hit = true; // overflow: the changes were dropped, so check anyway
+            for(DWORD off = 0; off < n;) {
+                const FILE_NOTIFY_INFORMATION *fni = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buf + off);
+                if(isConfig(fni->FileName, fni->FileNameLength / sizeof(WCHAR))) hit = true;
+                if(!fni->NextEntryOffset) break;
+                off += fni->NextEntryOffset;
+            }
+        }
+        ResetEvent(ev);
+        if(!arm()) hit = true;
+        return hit;
+    }
+    ~ConfigWatch() {
+        if(dir != INVALID_HANDLE_VALUE) {
+            DWORD n; CancelIoEx(dir, &ov); GetOverlappedResult(dir, &ov, &n, TRUE); // buf must outlive the read
+            CloseHandle(dir);
+        }
+        if(ev) CloseHandle(ev);
+    }
+};
+
 void HotReloadThread() {
+    SWARM_TRACE_THREAD("HotReloadThread");
+    ConfigWatch watch;
+    bool watching = watch.open(kConfigFile);
+    printf("Hot-reload: %s\n", watching ? "directory change notifications" : "polling every 750 ms (change notifications unavailable)");
     while(gManager.running) {
-        ReloadConfigIfChanged(false);
-        std::this_thread::sleep_for(std::chrono::milliseconds(750));
+        if(watching) {
+            if(watch.wait(250)) {
+                while(gManager.running && watch.wait(30)) {} // debounce: editors save in several writes / a rename
+                ReloadConfigIfChanged(false);
+            }
+        } else {
+            ReloadConfigIfChanged(false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(750));
+        }
+        AutosaveIfDue();
     }
 }
 
+// Publishes the shared-memory heartbeat (swarm_heartbeat.h) the watchdog supervises; only atomics are read,
+// so it never takes the cursor lock. The last-command time is stamped here when the command count moves.
 void HeartbeatThread() {
+    SWARM_TRACE_THREAD("HeartbeatThread");
+    swarm_hb::Block hb;
+    if(!hb.open()) { printf("Heartbeat: CreateFileMapping failed gle=%lu\n", GetLastError()); return; }
+    swarm_hb::Sample s {};
+    s.pid = GetCurrentProcessId();
     while(gManager.running && gHeartbeatRunning) {
-        std::ofstream hb(kHeartbeatFile, std::ios::out|std::ios::trunc);
-        if(hb) {
-            auto now = std::chrono::system_clock::now().time_since_epoch();
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
-            hb << ms << "\n" << gLastFPS.load() << "\n" << gManager.cursors.size() << std::endl;
-        }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        SWARM_TRACE_ZONE("heartbeatWrite");
+        s.epochMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        uint64_t commands = (uint64_t)gApiCommandCount.load();
+        if(commands != s.commands) { s.commands = commands; s.lastCommandMs = s.epochMs; }
+        s.frame = gFrameCount.load();
+        s.idlePolls = gIdlePolls.load();
+        s.idle = gIdle.idle.load() ? 1 : 0;
+        s.fps = gLastFPS.load();
+        s.cursors = (uint32_t)gManager.cursorCount.load();
+        hb.publish(s);
+        std::this_thread::sleep_for(std::chrono::milliseconds(swarm_hb::kPublishMs));
     }
 }
 
 POINT GetCursorPosForId(int id, bool *ok) {
     *ok=false; POINT p{0,0};
-    std::lock_guard<std::mutex> lock(gManager.mtx);
-    for(auto &c: gManager.cursors) if(c.id==id) { p=c.pos; *ok=true; break; }
+    if(auto c = gManager.getCursorCopy(id)) { p=c->pos; *ok=true; }
     return p;
 }
 
@@ -920,12 +3205,53 @@ void PerformMouseAction(POINT p, const std::string &action, int button) {
     SendInput(1,&inp,sizeof(INPUT));
 }
 
-void SaveState() {
-    std::lock_guard<std::mutex> lock(gManager.mtx);
-    std::ofstream out(kStateFile, std::ios::out|std::ios::trunc);
-    if(!out) { printf("SaveState: failed open %s\n", kStateFile); return; }
-    for(auto &c: gManager.cursors) {
-        std::string beh = (c.behavior==BehaviorType::Mirror?"mirror":(c.behavior==BehaviorType::Static?"static":(c.behavior==BehaviorType::Orbit?"orbit":(c.behavior==BehaviorType::FollowLag?"follow":"script"))));
+// Binary snapshot (swarm_state.bin), little endian; str = u16 length + bytes:
+//   "SWST" u32 version, u32 cursorCount, u32 pluginCount,
+//   pluginCount x [str name, u16 paramCount, paramCount x str paramName]   (behaviors in use, by name)
+//   cursorCount x [i32 id, u8 behavior, u16 plugin (table index + 1, 0 = none), u32 color, i32 size, i32 x, i32 y,
+//                  f64 offsetX offsetY radius speed lagMs separation alignment cohesion seek maxSpeed,
+//                  str scriptPath, that plugin's paramCount x f32]
+//   u64 FNV-1a of every byte before it
+// Plugins and their params are matched by name on load, so a rebuilt plugin with a reordered schema still
+// loads (missing params take the default; state params are not saved).
+static const uint32_t kStateMagic = 0x54535753; // "SWST"
+static const uint32_t kStateVersion = 1;
+static std::mutex gSaveMtx;                        // one writer of the temp file at a time
+static std::atomic<uint64_t> gSavedVersion {~0ull}; // gManager.stateVersion captured by the last save or load
+static std::atomic<double> gAutosaveMs {0};
+
+template<class T> static void PutPod(std::string &o, const T &v) { o.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+static void PutStr(std::string &o, const std::string &v) { uint16_t n = (uint16_t)std::min(v.size(), (size_t)0xFFFF); PutPod(o, n); o.append(v, 0, n); }
+static uint64_t Fnv64(const char *p, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for(size_t i=0;i<n;i++) { h ^= (uint8_t)p[i]; h *= 1099511628211ull; }
+    return h;
+}
+// Bounds-checked reads over the loaded file; a short read sets bad
+struct PodReader {
+    const char *p, *end;
+    bool bad {false};
+    template<class T> T pod() {
+        T v {};
+        if((size_t)(end - p) < sizeof(T)) { bad = true; return v; }
+        memcpy(&v, p, sizeof(T)); p += sizeof(T);
+        return v;
+    }
+    std::string str() {
+        uint16_t n = pod<uint16_t>();
+        if((size_t)(end - p) < n) { bad = true; return {}; }
+        std::string v(p, n); p += n;
+        return v;
+    }
+};
+
+static void SaveStateText() {
+    std::vector<SwarmCursor> all; gManager.copyCursors(all, true);
+    std::ofstream out(kStateTextFile, std::ios::out|std::ios::trunc);
+    if(!out) { printf("SaveState: failed open %s\n", kStateTextFile); return; }
+    for(auto &c: all) {
+        std::string beh = (c.behavior==BehaviorType::Mirror?"mirror":(c.behavior==BehaviorType::Static?"static":(c.behavior==BehaviorType::Orbit?"orbit":(c.behavior==BehaviorType::FollowLag?"follow":(c.behavior==BehaviorType::Flock?"flock":"script")))));
+        if(c.behavior==BehaviorType::Plugin) beh = "plugin:" + gManager.plugins[c.plugin].name;
         out << "{\"op\":\"cursor/add\",\"id\":" << c.id
             << ",\"behavior\":\"" << beh << "\""
             << ",\"offsetX\":" << c.offsetX << ",\"offsetY\":" << c.offsetY
@@ -933,29 +3259,201 @@ void SaveState() {
             << ",\"lagMs\":" << c.lagMs << ",\"x\":" << c.target.x << ",\"y\":" << c.target.y
             << ",\"size\":" << c.size;
         if(c.behavior==BehaviorType::Script && !c.scriptPath.empty()) out << ",\"script\":\"" << c.scriptPath << "\"";
+        if(c.behavior==BehaviorType::Flock)
+            out << ",\"separation\":" << c.separation << ",\"alignment\":" << c.alignment << ",\"cohesion\":" << c.cohesion
+                << ",\"seek\":" << c.seek << ",\"maxSpeed\":" << c.maxSpeed;
+        if(c.behavior==BehaviorType::Plugin) {
+            const PluginBehavior &b = gManager.plugins[c.plugin];
+            out << ",\"params\":{";
+            bool first = true;
+            for(size_t i=0;i<b.params.size();i++) {
+                if(b.params[i].flags & SWARM_PARAM_STATE) continue;
+                out << (first ? "" : ",") << "\"" << b.params[i].name << "\":" << c.pluginParams[i];
+                first = false;
+            }
+            out << "}";
+        }
         out << "}\n";
     }
-    printf("State saved (%zu cursors) to %s\n", gManager.cursors.size(), kStateFile);
+    printf("State saved (%zu cursors) to %s\n", all.size(), kStateTextFile);
+}
+
+// Copies the cursors under one short lock, encodes and writes off-lock to a temp file, then renames it over
+// the snapshot so a crash mid-save leaves the previous one intact
+void SaveState(bool text) {
+    SWARM_TRACE_ZONE("saveState");
+    std::lock_guard<std::mutex> g(gSaveMtx);
+    if(text) { SaveStateText(); return; }
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t version = gManager.stateVersion.load(); // before the copy: a change racing the copy saves again next time
+    std::vector<SwarmCursor> all; gManager.copyCursors(all, true);
+    std::vector<int> playback, net; gPlayer.ownedIds(playback); gNetIn.ownedIds(net);
+    playback.insert(playback.end(), net.begin(), net.end()); std::sort(playback.begin(), playback.end());
+    if(!playback.empty()) all.erase(std::remove_if(all.begin(), all.end(), [&](const SwarmCursor &c) { return std::binary_search(playback.begin(), playback.end(), c.id); }), all.end());
+    std::vector<int> table(gManager.plugins.size(), 0); // plugin index -> table index + 1
+    std::vector<int> used;
+    for(const SwarmCursor &c : all) if(c.behavior==BehaviorType::Plugin && !table[c.plugin]) { used.push_back(c.plugin); table[c.plugin] = (int)used.size(); }
+    std::string out;
+    out.reserve(64 + all.size() * 120);
+    PutPod(out, kStateMagic); PutPod(out, kStateVersion); PutPod(out, (uint32_t)all.size()); PutPod(out, (uint32_t)used.size());
+    for(int p : used) {
+        const PluginBehavior &b = gManager.plugins[p];
+        PutStr(out, b.name);
+        uint16_t n = 0; for(auto &d : b.params) if(!(d.flags & SWARM_PARAM_STATE)) n++;
+        PutPod(out, n);
+        for(auto &d : b.params) if(!(d.flags & SWARM_PARAM_STATE)) PutStr(out, d.name);
+    }
+    for(const SwarmCursor &c : all) {
+        PutPod(out, (int32_t)c.id); PutPod(out, (uint8_t)c.behavior);
+        PutPod(out, (uint16_t)(c.behavior==BehaviorType::Plugin ? table[c.plugin] : 0));
+        PutPod(out, (uint32_t)c.color); PutPod(out, (int32_t)c.size); PutPod(out, (int32_t)c.target.x); PutPod(out, (int32_t)c.target.y);
+        for(double v : { c.offsetX, c.offsetY, c.radius, c.speed, c.lagMs, c.separation, c.alignment, c.cohesion, c.seek, c.maxSpeed }) PutPod(out, v);
+        PutStr(out, c.behavior==BehaviorType::Script ? c.scriptPath : std::string());
+        if(c.behavior==BehaviorType::Plugin) {
+            const PluginBehavior &b = gManager.plugins[c.plugin];
+            for(size_t i=0;i<b.params.size();i++) if(!(b.params[i].flags & SWARM_PARAM_STATE)) PutPod(out, i < c.pluginParams.size() ? c.pluginParams[i] : b.params[i].def);
+        }
+    }
+    PutPod(out, Fnv64(out.data(), out.size()));
+    std::string tmp = std::string(kStateFile) + ".tmp";
+    bool ok;
+    {
+        std::ofstream f(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+        ok = f && f.write(out.data(), (std::streamsize)out.size()) && f.flush();
+    }
+    std::error_code ec;
+    if(ok) std::filesystem::rename(tmp, kStateFile, ec); // MoveFileEx(REPLACE_EXISTING): readers see old or new, never half
+    if(!ok || ec) { printf("SaveState: write %s failed\n", tmp.c_str()); sendOut("{\"event\":\"error\",\"msg\":\"state/save: write failed\"}\n"); return; }
+    gSavedVersion = version;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    printf("State saved (%zu cursors, %zu bytes, %.1f ms) to %s\n", all.size(), out.size(), ms, kStateFile);
+    char b[192]; snprintf(b, sizeof(b), "{\"event\":\"stateSaved\",\"cursors\":%zu,\"bytes\":%zu,\"ms\":%.1f}\n", all.size(), out.size(), ms);
+    sendOut(b);
 }
 
-void LoadState() {
-    if(!std::filesystem::exists(kStateFile)) { printf("LoadState: file not found %s\n", kStateFile); return; }
-    std::ifstream in(kStateFile, std::ios::in);
+// Decodes the whole snapshot first, then inserts every cursor under one lock: no command parsing or
+// per-cursor events. Cursors whose id is taken or whose plugin is not loaded are skipped.
+static bool LoadStateBinary() {
+    auto t0 = std::chrono::steady_clock::now();
+    std::string data;
+    {
+        std::ifstream in(kStateFile, std::ios::in | std::ios::binary);
+        if(!in) return false;
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto fail = [&](const char *why) {
+        printf("LoadState: %s: %s\n", kStateFile, why);
+        sendOut(std::string("{\"event\":\"error\",\"msg\":\"state/load: ") + why + "\"}\n");
+        return true;
+    };
+    if(data.size() < 24) return fail("truncated");
+    uint64_t sum; memcpy(&sum, data.data() + data.size() - 8, 8);
+    if(sum != Fnv64(data.data(), data.size() - 8)) return fail("checksum mismatch");
+    PodReader r { data.data(), data.data() + data.size() - 8 };
+    if(r.pod<uint32_t>() != kStateMagic) return fail("not a state snapshot");
+    if(r.pod<uint32_t>() != kStateVersion) return fail("unsupported snapshot version");
+    uint32_t count = r.pod<uint32_t>(), pluginCount = r.pod<uint32_t>();
+    struct FilePlugin { int index; std::vector<int> params; }; // current behavior index (-1 = not loaded) and param slots
+    std::vector<FilePlugin> fp(pluginCount);
+    for(auto &p : fp) {
+        p.index = gManager.findPlugin(r.str());
+        uint16_t n = r.pod<uint16_t>();
+        for(uint16_t i=0;i<n;i++) { std::string name = r.str(); p.params.push_back(p.index >= 0 ? gManager.plugins[p.index].param(name) : -1); }
+    }
+    std::vector<SwarmCursor> all;
+    all.reserve(std::min<uint32_t>(count, (uint32_t)(data.size() / 80)));
+    size_t skipped = 0;
+    for(uint32_t i=0;i<count && !r.bad;i++) {
+        SwarmCursor c;
+        c.id = r.pod<int32_t>();
+        uint8_t beh = r.pod<uint8_t>(); uint16_t plug = r.pod<uint16_t>();
+        c.behavior = beh <= (uint8_t)BehaviorType::Plugin ? (BehaviorType)beh : BehaviorType::Static;
+        c.color = (COLORREF)r.pod<uint32_t>(); c.size = r.pod<int32_t>();
+        c.target.x = r.pod<int32_t>(); c.target.y = r.pod<int32_t>();
+        for(double *v : { &c.offsetX, &c.offsetY, &c.radius, &c.speed, &c.lagMs, &c.separation, &c.alignment, &c.cohesion, &c.seek, &c.maxSpeed }) *v = r.pod<double>();
+        c.scriptPath = r.str();
+        bool ok = c.behavior != BehaviorType::Plugin;
+        if(c.behavior==BehaviorType::Plugin && plug >= 1 && plug <= fp.size()) {
+            const FilePlugin &p = fp[plug - 1];
+            if(p.index >= 0) {
+                const PluginBehavior &b = gManager.plugins[p.index];
+                c.plugin = p.index;
+                for(auto &d : b.params) c.pluginParams.push_back(d.def);
+                for(int slot : p.params) { float v = r.pod<float>(); if(slot >= 0) c.pluginParams[slot] = std::clamp(v, b.params[slot].lo, b.params[slot].hi); }
+                ok = true;
+            } else for(size_t k=0;k<p.params.size();k++) r.pod<float>();
+        }
+        if(c.behavior==BehaviorType::Static || c.behavior==BehaviorType::Flock || c.behavior==BehaviorType::Plugin) c.pos = c.target;
+        if(ok) all.push_back(std::move(c)); else skipped++;
+    }
+    if(r.bad) return fail("truncated");
+    size_t loaded = 0;
+    {
+        ManagerLock lock(gManager.mtx);
+        for(const SwarmCursor &c : all) {
+            int id = gManager.addCursorLocked(c);
+            if(!id) { skipped++; continue; }
+            loaded++;
+            if(c.behavior==BehaviorType::Script) if(CursorCold *cc = gManager.coldLocked(id)) LaunchScriptProcess(id, *cc);
+        }
+        gSavedVersion = gManager.stateVersion.load();
+    }
+    LoadPendingScripts();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    printf("State loaded (%zu cursors, %zu skipped, %.1f ms) from %s\n", loaded, skipped, ms, kStateFile);
+    char b[160]; snprintf(b, sizeof(b), "{\"event\":\"stateLoaded\",\"cursors\":%zu,\"skipped\":%zu,\"ms\":%.1f}\n", loaded, skipped, ms);
+    sendOut(b);
+    return true;
+}
+
+// Replays swarm_state.jsonl through handleCommand (the format before swarm_state.bin, and state/save {"mode":"jsonl"})
+static void LoadStateText() {
+    if(!std::filesystem::exists(kStateTextFile)) { printf("LoadState: file not found %s\n", kStateTextFile); return; }
+    std::ifstream in(kStateTextFile, std::ios::in);
     if(!in) return;
-    printf("Loading state from %s\n", kStateFile);
+    printf("Loading state from %s\n", kStateTextFile);
     std::string line; while(std::getline(in,line)) { if(line.empty()|| line[0]=='#') continue; handleCommand(line); }
     // Relaunch scripts (handleCommand already launches; this is defensive if future changes skip)
     {
-        std::lock_guard<std::mutex> lock(gManager.mtx);
-        for(auto &c : gManager.cursors) if(c.behavior==BehaviorType::Script && !c.scriptProcessRunning) LaunchScriptProcess(c);
+        ManagerLock lock(gManager.mtx);
+        for(auto &kc : gManager.cold) {
+            BehaviorType b; size_t i;
+            if(!kc.second.scriptProcessRunning && gManager.findLocked(kc.first, b, i) && b==BehaviorType::Script) LaunchScriptProcess(kc.first, kc.second);
+        }
     }
+    LoadPendingScripts();
+}
+
+void LoadState(bool text) {
+    if(!text && LoadStateBinary()) return;
+    LoadStateText();
+}
+
+// HotReloadThread: save when the interval has passed and something changed since the last save or load
+static void AutosaveIfDue() {
+    static std::chrono::steady_clock::time_point next {};
+    double ms = gAutosaveMs.load();
+    auto now = std::chrono::steady_clock::now();
+    if(ms <= 0 || now < next) return;
+    next = now + std::chrono::milliseconds((long long)ms);
+    if(gManager.stateVersion.load() != gSavedVersion.load()) SaveState();
+}
+
+// state/autosave {"intervalMs":N} (0 = off; at least 500)
+static void CmdAutosave(const Command &k) {
+    double ms = k.has(swarm_cmd::kIntervalMs) ? k.intervalMs : 0;
+    gAutosaveMs = ms > 0 ? std::max(ms, 500.0) : 0.0;
+    char b[96]; snprintf(b, sizeof(b), "{\"event\":\"autosave\",\"intervalMs\":%.0f}\n", gAutosaveMs.load());
+    sendOut(b);
 }
 
 int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, PWSTR, int) {
+    SWARM_TRACE_REGISTER();
     AllocConsole();
     freopen("CONOUT$", "w", stdout);
     printf("Swarm starting...\n");
-    SetProcessDPIAware();
+    // Per-monitor v2: monitor rects, GetCursorPos and every overlay surface are physical pixels on each monitor
+    if(!SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2)) SetProcessDPIAware(); // pre-1703: system aware
     // seed with a couple of cursors
     for(int i=0;i<3;i++) {
         SwarmCursor c; c.behavior=BehaviorType::Mirror; c.offsetX=i*18; c.offsetY=(i%2)*18; c.color = RGB(40+i*60, 200 - i*40, 120 + i*40); c.size=10 + i*2; gManager.addCursor(c);
@@ -963,18 +3461,13 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, PWSTR, int) {
     SwarmCursor orbit; orbit.behavior=BehaviorType::Orbit; orbit.radius=90; orbit.speed=1; orbit.color=RGB(255,120,30); orbit.size=14; gManager.addCursor(orbit);
     SwarmCursor lag; lag.behavior=BehaviorType::FollowLag; lag.lagMs=300; lag.color=RGB(150,150,255); gManager.addCursor(lag);
 
-    gManager.overlayWnd = CreateOverlayWindow(hInst);
+    gInstance = hInst;
+    // Prefer the GPU backend; GDI stays the fallback when no D3D device is available
+    RenderMode initialRender = D2dRenderer::DeviceAvailable() ? RenderMode::D2d : RenderMode::Gdi;
+    gIdle.open();
+    InstallRenderer(initialRender); // creates the per-monitor overlay windows
     if(!gManager.overlayWnd) { printf("Failed to create overlay window.\n"); return 1; }
     printf("Overlay created HWND=%p\n", (void*)gManager.overlayWnd);
-
-    // Configure permanent transparent full-screen overlay (mouse pass-through)
-    LONG_PTR st = GetWindowLongPtr(gManager.overlayWnd, GWL_STYLE);
-    SetWindowLongPtr(gManager.overlayWnd, GWL_STYLE, (st & ~WS_OVERLAPPEDWINDOW) | WS_POPUP);
-    LONG_PTR ex = GetWindowLongPtr(gManager.overlayWnd, GWL_EXSTYLE);
-    ex = (ex | WS_EX_LAYERED | WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_TRANSPARENT) & ~WS_EX_APPWINDOW;
-    SetWindowLongPtr(gManager.overlayWnd, GWL_EXSTYLE, ex);
-    SetLayeredWindowAttributes(gManager.overlayWnd, RGB(0,0,0), 0, LWA_COLORKEY);
-    SetWindowPos(gManager.overlayWnd, HWND_TOPMOST, 0,0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN), SWP_FRAMECHANGED | SWP_SHOWWINDOW | SWP_NOACTIVATE);
     printf("Startup: permanent transparent overlay active (Alt+D/O/F/C/X).\n");
 
     // Register global hotkeys and also set a low-level hook so Alt combos keep working after focus changes
@@ -982,8 +3475,8 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, PWSTR, int) {
     auto tryAlt=[&](int id,char ch){ if(RegisterHotKey(nullptr,id,MOD_ALT,ch)) { hkOk++; return true;} anyFail=true; return false; };
     tryAlt(1,'D'); tryAlt(3,'O'); tryAlt(4,'F'); tryAlt(5,'C'); tryAlt(6,'X'); tryAlt(7,'S');
     if(anyFail && gManager.overlayWnd) {
-        auto tryAltWnd=[&](int id,char ch){ if(RegisterHotKey(gManager.overlayWnd,id,MOD_ALT,ch)) hkOk++; };
-        tryAltWnd(1,'D'); tryAltWnd(3,'O'); tryAltWnd(4,'F'); tryAltWnd(5,'C'); tryAltWnd(6,'X');
+        hkOk += RegisterOverlayHotkeys(gManager.overlayWnd);
+        gHotkeysOnWindow = true;
     }
     if(hkOk>0) printf("Hotkeys registered (%d). Alt+D/O/F/C/S/X (Shift+S new script). H toggles help. AHK=%s\n", hkOk, gAhkExePath.c_str());
     else printf("RegisterHotKey failed for all Alt combos, falling back to hook only.\n");
@@ -993,13 +3486,17 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, PWSTR, int) {
     else printf("Failed to install low-level keyboard hook (gle=%lu).\n", GetLastError());
     // Do NOT force focus; user can Alt+Tab freely. (Focus only needed for fallback keys in windowed mode.)
 
+    // Pipes before config and state: their .ahk cursors listen on SwarmScript_<id> as they are added
+    gRing.open();
+    gEvents.start();
+    gPipes.start();
+    // Plugin behaviors first: config and saved state may add plugin cursors
+    LoadPlugins();
     // Load config file (line-delimited JSON commands) if present
     ReloadConfigIfChanged(true);
     LoadState();
 
     std::thread updater(UpdateThread);
-    std::thread pipeServer(InboundListenerPool);
-    std::thread outPipe(OutPipeThread);
     std::thread hotReload(HotReloadThread);
     std::thread heartbeat(HeartbeatThread);
 
@@ -1011,11 +3508,19 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, PWSTR, int) {
 
     gManager.running = false;
     updater.join();
-    pipeServer.join();
-    outPipe.join();
+    gRecorder.stop(); // writes the keyframe index
+    gPlayer.stop();
+    gNetOut.stop();
+    gNetIn.stop();
+    if(gAutosaveMs.load() > 0 && gManager.stateVersion.load() != gSavedVersion.load()) SaveState(); // a clean exit loses nothing
+    gManager.jobs.shutdown();
+    gEvents.stop(); // flush "exiting" etc. while the event pipes are still up
+    gPipes.stop();
     hotReload.join();
     gHeartbeatRunning=false; heartbeat.join();
     if(gLLHook) { UnhookWindowsHookEx(gLLHook); gLLHook=nullptr; }
+    UnloadPlugins();
+    SWARM_TRACE_UNREGISTER();
     return 0;
 }
 
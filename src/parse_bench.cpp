@@ -0,0 +1,115 @@
+// SwarmParseBench: inbound command parsing throughput, old vs new
+// "legacy" is the former parseSimpleJson (std::map of substr copies) plus the op -> cmd rewrite and
+// kv.count/atof lookups handleCommand did per line; "typed" is swarm_cmd::Parse into a Command.
+// Both decode the same fields, and the results are cross-checked before timing.
+//   SwarmParseBench [iterations]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <map>
+#include <string>
+#include <vector>
+#include "swarm_command.h"
+
+static std::map<std::string,std::string> parseSimpleJson(const std::string &line) {
+    std::map<std::string,std::string> out;
+    size_t i=0; while(i<line.size() && isspace((unsigned char)line[i])) i++;
+    if(i>=line.size() || line[i] != '{') return out;
+    i++;
+    while(i<line.size()) {
+        while(i<line.size() && isspace((unsigned char)line[i])) i++;
+        if(i<line.size() && line[i]=='}') break;
+        if(line[i] != '"') break;
+        i++;
+        size_t start=i; while(i<line.size() && line[i] != '"') i++; if(i>=line.size()) break;
+        std::string key = line.substr(start, i-start); i++;
+        while(i<line.size() && (isspace((unsigned char)line[i])|| line[i]==':')) { if(line[i]==':'){ i++; break;} i++; }
+        while(i<line.size() && isspace((unsigned char)line[i])) i++;
+        std::string value;
+        if(i<line.size() && line[i]=='"') {
+            i++; size_t vstart=i; while(i<line.size() && line[i] != '"') i++; value = line.substr(vstart, i-vstart); if(i<line.size()) i++;
+        } else {
+            size_t vstart=i; while(i<line.size() && line[i] != ',' && line[i] != '}') i++; value = line.substr(vstart, i-vstart);
+            size_t a=0; while(a<value.size() && isspace((unsigned char)value[a])) a++; size_t b=value.size(); while(b> a && isspace((unsigned char)value[b-1])) b--; value = value.substr(a,b-a);
+        }
+        out[key]=value;
+        while(i<line.size() && isspace((unsigned char)line[i])) i++;
+        if(i<line.size() && line[i]==',') { i++; continue; }
+        if(i<line.size() && line[i]=='}') break;
+    }
+    return out;
+}
+
+// Decoded result both paths produce, so the comparison covers the whole line -> values step
+struct Decoded {
+    std::string cmd; int id=0; double x=0, y=0, radius=0, speed=0, lagMs=0; int size=0; size_t colorLen=0;
+    bool operator==(const Decoded &o) const { return cmd==o.cmd && id==o.id && x==o.x && y==o.y && radius==o.radius && speed==o.speed && lagMs==o.lagMs && size==o.size && colorLen==o.colorLen; }
+};
+
+static const std::map<std::string,std::string> kOpToCmd = {
+    {"cursor/add","add"},{"cursor/update","set"},{"cursor/remove","remove"},{"cursor/tweak","tweak"},{"sys/perf","perf"},{"cursor/list","list"}
+};
+
+static Decoded DecodeLegacy(const std::string &line) {
+    auto kv = parseSimpleJson(line);
+    Decoded d;
+    auto opIt = kv.find("op");
+    if(opIt!=kv.end()) { std::string op = opIt->second; auto m = kOpToCmd.find(op); if(m==kOpToCmd.end()) return d; kv["cmd"] = m->second; }
+    auto cmdIt = kv.find("cmd"); if(cmdIt==kv.end()) return d;
+    d.cmd = cmdIt->second;
+    if(kv.count("id")) d.id = atoi(kv["id"].c_str());
+    if(kv.count("x")) d.x = atof(kv["x"].c_str());
+    if(kv.count("y")) d.y = atof(kv["y"].c_str());
+    if(kv.count("radius")) d.radius = atof(kv["radius"].c_str());
+    if(kv.count("speed")) d.speed = atof(kv["speed"].c_str());
+    if(kv.count("lagMs")) d.lagMs = atof(kv["lagMs"].c_str());
+    if(kv.count("size")) d.size = atoi(kv["size"].c_str());
+    if(kv.count("color")) d.colorLen = kv["color"].size();
+    return d;
+}
+
+static const char *LegacyName(swarm_cmd::Op op) {
+    using swarm_cmd::Op;
+    switch(op) { case Op::Add: return "add"; case Op::Set: return "set"; case Op::Remove: return "remove"; case Op::Tweak: return "tweak";
+                 case Op::Perf: return "perf"; case Op::List: return "list"; default: return ""; }
+}
+
+static Decoded DecodeTyped(const std::string &line) {
+    swarm_cmd::Command k; Decoded d;
+    if(!swarm_cmd::Parse(line, k) || k.op==swarm_cmd::Op::Unknown) return d;
+    d.cmd = LegacyName(k.op); d.id = k.id; d.x = k.x; d.y = k.y; d.radius = k.radius; d.speed = k.speed; d.lagMs = k.lagMs; d.size = k.size;
+    d.colorLen = k.color.size();
+    return d;
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    if(iterations < 1) iterations = 1;
+    const std::vector<std::string> corpus = {
+        "{\"op\":\"cursor/add\",\"behavior\":\"orbit\",\"radius\":80,\"speed\":1.2,\"color\":\"#FF8833\",\"size\":14}",
+        "{\"op\":\"cursor/update\",\"id\":12,\"x\":640.5,\"y\":360,\"gen\":3}",
+        "{\"cmd\":\"set\",\"id\":7,\"x\":100,\"y\":200}",
+        "{\"op\":\"cursor/tweak\",\"id\":4,\"radiusDelta\":5,\"speedDelta\":-0.1,\"lagMs\":120}",
+        "{\"cmd\":\"add\",\"behavior\":\"follow\",\"lagMs\":250,\"color\":\"#22DDFF\"}",
+        "{\"op\":\"cursor/remove\",\"id\":99,\"gen\":1}",
+        "{\"op\":\"sys/perf\"}",
+        "  { \"cmd\" : \"add\" , \"behavior\" : \"static\" , \"x\" : 300 , \"y\" : 400 }  ",
+    };
+    for(auto &l : corpus) {
+        if(!(DecodeLegacy(l)==DecodeTyped(l))) { printf("MISMATCH: %s\n", l.c_str()); return 1; }
+    }
+    auto run = [&](const char *name, Decoded (*fn)(const std::string&)) {
+        volatile int sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for(int it=0; it<iterations; it++) for(auto &l : corpus) sink = sink + fn(l).id;
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        double lines = (double)iterations * corpus.size();
+        printf("%-7s %10.0f lines/sec  (%.1f ns/line)\n", name, lines / sec, sec * 1e9 / lines);
+        return lines / sec;
+    };
+    double legacy = run("legacy", DecodeLegacy);
+    double typed = run("typed", DecodeTyped);
+    printf("speedup %.1fx\n", typed / legacy);
+    return 0;
+}
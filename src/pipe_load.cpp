@@ -0,0 +1,211 @@
+// SwarmPipeLoad: SwarmPipe throughput / latency load generator
+// K concurrent SwarmPipe connections stream a weighted mix of cursor/add, cursor/update, cursor/tweak and
+// mouse/* commands at a target total rate while one SwarmPipeOut subscriber consumes events. Every
+// add/update/tweak carries a "rid" that handleCommand echoes into its reply (added / updated / tweaked /
+// error), which gives send -> event latency per command. Mouse ops move the real pointer and have no
+// reply event, so their weight defaults to 0 and they only count toward throughput.
+//   SwarmPipeLoad [--conns K] [--rate cmds/sec] [--seconds S] [--mix add:1,update:6,tweak:2,mouse:0] [--cursors per-conn]
+#include <windows.h>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "swarm_profile.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int conns = 8;
+    double rate = 2000;   // commands/sec over all connections
+    double seconds = 10;
+    int cursors = 20;     // static cursors each connection adds up front (targets for update/tweak)
+    int weight[4] = { 1, 6, 2, 0 }; // add, update, tweak, mouse
+};
+enum OpKind { kAdd, kUpdate, kTweak, kMouse, kOpKinds };
+static const char *const kOpNames[kOpKinds] = { "add", "update", "tweak", "mouse" };
+
+static bool ParseMix(const char *s, int weight[kOpKinds]) {
+    for(int i=0;i<kOpKinds;i++) weight[i] = 0;
+    std::string v(s);
+    size_t i = 0;
+    while(i < v.size()) {
+        size_t e = v.find(',', i); if(e == std::string::npos) e = v.size();
+        std::string item = v.substr(i, e - i);
+        size_t c = item.find(':');
+        if(c == std::string::npos) return false;
+        int k = 0; while(k < kOpKinds && item.compare(0, c, kOpNames[k]) != 0) k++;
+        if(k == kOpKinds) return false;
+        weight[k] = atoi(item.c_str() + c + 1);
+        i = e + 1;
+    }
+    return weight[0] + weight[1] + weight[2] + weight[3] > 0;
+}
+
+// Shared between senders and the event reader. sentNs[rid] = send time; reserved up front so no locking is needed.
+struct Run {
+    Clock::time_point t0;
+    std::vector<std::atomic<int64_t>> sentNs;
+    std::atomic<uint64_t> nextRid {1};
+    std::atomic<unsigned long long> sent[kOpKinds] {}, sendFailed {0}, pipeBusy {0}, connectFailed {0};
+    std::atomic<unsigned long long> replies {0}, errors {0}, unknownRid {0}, events {0};
+    swarm_prof::Histogram latency; // ns
+    explicit Run(size_t maxRids) : t0(Clock::now()), sentNs(maxRids) {}
+    int64_t now() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count(); }
+};
+
+// ERROR_PIPE_BUSY means every pending accept was taken: count it, wait for an instance and retry
+static HANDLE ConnectPipe(const wchar_t *name, DWORD access, Run &run) {
+    for(int attempt = 0; attempt < 20; attempt++) {
+        HANDLE h = CreateFileW(name, access, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if(h != INVALID_HANDLE_VALUE) return h;
+        DWORD err = GetLastError();
+        if(err != ERROR_PIPE_BUSY) break;
+        run.pipeBusy++;
+        WaitNamedPipeW(name, 1000);
+    }
+    run.connectFailed++;
+    return INVALID_HANDLE_VALUE;
+}
+
+static bool WriteLine(HANDLE h, const std::string &line) {
+    DWORD written = 0;
+    return WriteFile(h, line.data(), (DWORD)line.size(), &written, nullptr) && written == line.size();
+}
+
+static void Sender(int conn, const Options &opt, Run &run, std::atomic<bool> &ready) {
+    HANDLE h = ConnectPipe(L"\\\\.\\pipe\\SwarmPipe", GENERIC_WRITE, run);
+    if(h == INVALID_HANDLE_VALUE) return;
+    const int idBase = 100000 + conn * 10000; // own id range: [idBase, idBase+cursors) pre-added, adds after that
+    std::string setup = "{\"op\":\"batch\",\"cmds\":[";
+    for(int i=0;i<opt.cursors;i++)
+        setup += (i ? "," : "") + std::string("{\"op\":\"cursor/add\",\"behavior\":\"static\",\"id\":") + std::to_string(idBase + i)
+               + ",\"x\":" + std::to_string(100 + (conn * 97 + i * 31) % 1600) + ",\"y\":" + std::to_string(100 + (conn * 53 + i * 17) % 800) + ",\"size\":10}";
+    setup += "]}\n";
+    if(!WriteLine(h, setup)) { run.sendFailed++; CloseHandle(h); return; }
+    while(!ready.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    const double perConn = opt.rate / opt.conns;
+    const int total = opt.weight[0] + opt.weight[1] + opt.weight[2] + opt.weight[3];
+    const auto start = Clock::now(), end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.seconds));
+    uint64_t n = 0, seed = 0x9E3779B97F4A7C15ull * (conn + 1);
+    int added = 0;
+    char line[256];
+    for(;;) {
+        auto due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(n / perConn));
+        if(due >= end) break;
+        auto now = Clock::now();
+        if(due > now) { std::this_thread::sleep_until(due); continue; } // catch up in a burst after a coarse sleep
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        int pick = (int)(seed % (uint64_t)total), kind = 0;
+        while(pick >= opt.weight[kind]) pick -= opt.weight[kind++];
+        if(kind == kAdd && added >= 10000 - opt.cursors) kind = kUpdate; // id range exhausted
+        int target = idBase + (int)((seed >> 20) % (uint64_t)(opt.cursors + added));
+        uint64_t rid = kind == kMouse ? 0 : run.nextRid++;
+        int len = 0;
+        switch(kind) {
+            case kAdd: len = snprintf(line, sizeof(line), "{\"op\":\"cursor/add\",\"behavior\":\"orbit\",\"id\":%d,\"radius\":%d,\"speed\":1.5,\"size\":9,\"rid\":\"%llu\"}\n",
+                idBase + opt.cursors + added, 20 + (int)(seed % 80), (unsigned long long)rid); added++; break;
+            case kUpdate: len = snprintf(line, sizeof(line), "{\"op\":\"cursor/update\",\"id\":%d,\"x\":%d,\"y\":%d,\"rid\":\"%llu\"}\n",
+                target, 100 + (int)(seed % 1600), 100 + (int)((seed >> 11) % 800), (unsigned long long)rid); break;
+            case kTweak: len = snprintf(line, sizeof(line), "{\"op\":\"cursor/tweak\",\"id\":%d,\"radiusDelta\":1,\"speedDelta\":0.01,\"rid\":\"%llu\"}\n",
+                target, (unsigned long long)rid); break;
+            default: len = snprintf(line, sizeof(line), "{\"op\":\"mouse/click\",\"id\":%d,\"button\":0}\n", target); break;
+        }
+        if(rid && rid < run.sentNs.size()) run.sentNs[rid].store(run.now(), std::memory_order_relaxed);
+        DWORD written = 0;
+        if(WriteFile(h, line, (DWORD)len, &written, nullptr)) run.sent[kind]++;
+        else { run.sendFailed++; break; }
+        n++;
+    }
+    // Cleanup: drop everything this connection created
+    std::string rm = "{\"op\":\"batch\",\"cmds\":[";
+    for(int i=0;i<opt.cursors + added;i++) rm += (i ? "," : "") + std::string("{\"op\":\"cursor/remove\",\"id\":") + std::to_string(idBase + i) + "}";
+    rm += "]}\n";
+    WriteLine(h, rm);
+    CloseHandle(h);
+}
+
+// Event reader: match "rid" in replies to the send time
+static void Reader(HANDLE h, Run &run, std::atomic<bool> &stop) {
+    std::string buf;
+    char tmp[64 * 1024];
+    auto handle = [&](const std::string &ev) {
+        run.events++;
+        size_t p = ev.find("\"rid\":\"");
+        if(p == std::string::npos) return;
+        uint64_t rid = 0;
+        std::from_chars(ev.data() + p + 7, ev.data() + ev.size(), rid);
+        if(rid == 0 || rid >= run.sentNs.size()) { run.unknownRid++; return; }
+        int64_t t = run.sentNs[rid].exchange(-1, std::memory_order_relaxed);
+        if(t < 0) { run.unknownRid++; return; } // duplicate, or reply overtook the timestamp store
+        run.latency.record((uint64_t)(run.now() - t));
+        run.replies++;
+        if(ev.find("\"event\":\"error\"") != std::string::npos) run.errors++;
+    };
+    while(!stop.load()) {
+        DWORD got = 0;
+        if(!ReadFile(h, tmp, sizeof(tmp), &got, nullptr) || got == 0) break; // CancelIoEx from main, or overlay gone
+        for(DWORD i=0;i<got;i++) {
+            if(tmp[i] == '\n') { handle(buf); buf.clear(); }
+            else buf.push_back(tmp[i]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    for(int i=1;i<argc;i++) {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(a == "--conns" && v) { opt.conns = atoi(v); i++; }
+        else if(a == "--rate" && v) { opt.rate = atof(v); i++; }
+        else if(a == "--seconds" && v) { opt.seconds = atof(v); i++; }
+        else if(a == "--cursors" && v) { opt.cursors = atoi(v); i++; }
+        else if(a == "--mix" && v) { if(!ParseMix(v, opt.weight)) { fprintf(stderr, "bad --mix %s (e.g. add:1,update:6,tweak:2,mouse:0)\n", v); return 2; } i++; }
+        else { fprintf(stderr, "usage: SwarmPipeLoad [--conns K] [--rate cmds/sec] [--seconds S] [--mix add:1,update:6,tweak:2,mouse:0] [--cursors N]\n"); return 2; }
+    }
+    if(opt.conns < 1 || opt.conns > 512 || opt.rate <= 0 || opt.seconds <= 0 || opt.cursors < 1 || opt.cursors > 5000) { fprintf(stderr, "out of range option\n"); return 2; }
+    if(opt.weight[kMouse]) printf("Warning: mouse ops click the real pointer at cursor positions.\n");
+
+    auto run = std::make_unique<Run>((size_t)(opt.rate * opt.seconds * 1.1) + 1024);
+    HANDLE out = ConnectPipe(L"\\\\.\\pipe\\SwarmPipeOut", GENERIC_READ | GENERIC_WRITE, *run);
+    if(out == INVALID_HANDLE_VALUE) { fprintf(stderr, "SwarmPipeOut not available (overlay running?) GLE=%lu\n", GetLastError()); return 1; }
+    std::string filter = "{\"op\":\"events/subscribe\",\"events\":[\"added\",\"updated\",\"tweaked\",\"error\"]}\n";
+    WriteLine(out, filter);
+    std::atomic<bool> stop {false}, ready {false};
+    std::thread reader(Reader, out, std::ref(*run), std::ref(stop));
+
+    printf("SwarmPipeLoad: %d connections, %.0f cmds/sec for %.1f s, mix add:%d update:%d tweak:%d mouse:%d\n",
+        opt.conns, opt.rate, opt.seconds, opt.weight[0], opt.weight[1], opt.weight[2], opt.weight[3]);
+    std::vector<std::thread> senders;
+    for(int c=0;c<opt.conns;c++) senders.emplace_back(Sender, c, std::cref(opt), std::ref(*run), std::ref(ready));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300)); // setup batches applied before timing starts
+    auto t0 = Clock::now();
+    ready = true;
+    for(auto &t : senders) t.join();
+    double sendSec = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::this_thread::sleep_for(std::chrono::seconds(1)); // late replies
+    stop = true;
+    CancelIoEx(out, nullptr);
+    reader.join();
+    CloseHandle(out);
+
+    unsigned long long sentTotal = 0, tagged = 0;
+    for(int k=0;k<kOpKinds;k++) { sentTotal += run->sent[k].load(); if(k != kMouse) tagged += run->sent[k].load(); }
+    printf("sent      %llu (add %llu, update %llu, tweak %llu, mouse %llu) = %.0f cmds/sec\n", sentTotal,
+        run->sent[kAdd].load(), run->sent[kUpdate].load(), run->sent[kTweak].load(), run->sent[kMouse].load(), sentTotal / sendSec);
+    printf("replies   %llu of %llu tagged (%llu errors, %llu missing, %llu unmatched rid), %llu events read\n",
+        run->replies.load(), tagged, run->errors.load(), tagged > run->replies ? tagged - run->replies : 0ull, run->unknownRid.load(), run->events.load());
+    const swarm_prof::Histogram &l = run->latency;
+    printf("latency   p50 %.3f ms  p95 %.3f ms  p99 %.3f ms  max %.3f ms (send -> reply event)\n",
+        l.percentile(0.50) / 1e6, l.percentile(0.95) / 1e6, l.percentile(0.99) / 1e6, l.max() / 1e6);
+    printf("pipe      %llu ERROR_PIPE_BUSY, %llu connect failures, %llu write failures\n",
+        run->pipeBusy.load(), run->connectFailed.load(), run->sendFailed.load());
+    return 0;
+}
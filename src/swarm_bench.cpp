@@ -0,0 +1,171 @@
+// SwarmBench: headless SwarmManager simulation + offscreen GDI render + concurrent command clients
+// No overlay window, pipes or desktop interaction: N cursors across the behavior mix run at a fixed
+// 60 Hz step while M client threads parse and apply command lines against the same manager (same
+// lock as the overlay's pipe workers). Each frame damages, publishes the render snapshot and paints
+// the damaged area into a DIB section. Reports ns/cursor/frame, commands/sec and heap allocations
+// on the update thread per frame, so regressions show up without a desktop session.
+//   SwarmBench [cursors] [clients] [frames] [flock%] [workers]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "swarm_command.h"
+#include "swarm_manager.h"
+
+// Allocation counter: only threads that opt in (the update loop) are counted
+static std::atomic<unsigned long long> gAllocs {0};
+static thread_local bool tCountAllocs = false;
+
+void *operator new(std::size_t n) {
+    if(tCountAllocs) gAllocs.fetch_add(1, std::memory_order_relaxed);
+    if(void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+static const int kWidth = 1920, kHeight = 1080;
+
+// Behavior mix: 20% mirror, 20% static, 30% orbit, 30% follow (script cursors need a process);
+// flockPct of every hundred become boids instead
+static SwarmCursor MakeCursor(int i, int flockPct) {
+    SwarmCursor c;
+    c.id = i + 1;
+    c.color = RGB((i * 37) & 255, (i * 91) & 255, (i * 13) & 255);
+    c.size = 10 + i % 12;
+    switch(i % 10) {
+        case 0: case 1: c.behavior = BehaviorType::Mirror; c.offsetX = (i % 41) - 20; c.offsetY = (i % 29) - 14; break;
+        case 2: case 3: c.behavior = BehaviorType::Static; c.pos = c.target = POINT{ (LONG)(i * 7 % kWidth), (LONG)(i * 13 % kHeight) }; break;
+        case 4: case 5: case 6: c.behavior = BehaviorType::Orbit; c.radius = 40 + i % 200; c.speed = 0.5 + (i % 7) * 0.3; c.angle = i * 0.1; break;
+        default: c.behavior = BehaviorType::FollowLag; c.lagMs = 80 + i % 600; break;
+    }
+    if(i % 100 < flockPct) { c.behavior = BehaviorType::Flock; c.radius = 50; c.pos = c.target = POINT{ (LONG)(i * 37 % kWidth), (LONG)(i * 91 % kHeight) }; }
+    return c;
+}
+
+// One simulated pipe client: a fixed corpus of update/tweak lines for its own slice of ids,
+// decoded with swarm_cmd::Parse and applied under mtx through modifyLocked like CmdSet/CmdTweak.
+// Each id gets a +/- pair of tweaks, so radius and speed stay bounded however long the run is.
+static void ClientLoop(SwarmManager &mgr, int client, int clients, int cursors, std::atomic<bool> &stop, std::atomic<unsigned long long> &applied) {
+    std::vector<std::string> lines;
+    for(int i = client; i < cursors && lines.size() < 384; i += clients) {
+        int id = i + 1;
+        lines.push_back("{\"op\":\"cursor/update\",\"id\":" + std::to_string(id) + ",\"x\":" + std::to_string(i * 3 % kWidth) + ",\"y\":" + std::to_string(i * 5 % kHeight) + "}");
+        lines.push_back("{\"op\":\"cursor/tweak\",\"id\":" + std::to_string(id) + ",\"radiusDelta\":0.5,\"speedDelta\":-0.01}");
+        lines.push_back("{\"op\":\"cursor/tweak\",\"id\":" + std::to_string(id) + ",\"radiusDelta\":-0.5,\"speedDelta\":0.01}");
+    }
+    if(lines.empty()) return;
+    unsigned long long n = 0;
+    for(size_t k = 0; !stop.load(std::memory_order_relaxed); k++) {
+        swarm_cmd::Command cmd;
+        if(!swarm_cmd::Parse(lines[k % lines.size()], cmd)) continue;
+        ManagerLock lock(mgr.mtx);
+        if(cmd.op == swarm_cmd::Op::Set) { // the x/y part of ApplyCursorFields
+            mgr.modifyLocked(cmd.id, [&](SwarmCursor &c) {
+                if(cmd.has(swarm_cmd::kX)) c.target.x = (LONG)cmd.x;
+                if(cmd.has(swarm_cmd::kY)) c.target.y = (LONG)cmd.y;
+            }, cmd.gen);
+        } else if(cmd.op == swarm_cmd::Op::Tweak) { // the delta part of ApplyTweakFields
+            mgr.modifyLocked(cmd.id, [&](SwarmCursor &c) {
+                if(cmd.has(swarm_cmd::kRadiusDelta)) c.radius += cmd.radiusDelta;
+                if(cmd.has(swarm_cmd::kSpeedDelta)) c.speed += cmd.speedDelta;
+            }, cmd.gen);
+        }
+        n++;
+    }
+    applied += n;
+}
+
+// Offscreen 32bpp target; CreateCompatibleDC(nullptr) needs no window or interactive desktop
+struct Offscreen {
+    HDC dc {nullptr}; HBITMAP bmp {nullptr}; HGDIOBJ old {nullptr};
+    bool open(int w, int h) {
+        BITMAPINFO bi{}; bi.bmiHeader.biSize = sizeof(bi.bmiHeader);
+        bi.bmiHeader.biWidth = w; bi.bmiHeader.biHeight = -h; bi.bmiHeader.biPlanes = 1;
+        bi.bmiHeader.biBitCount = 32; bi.bmiHeader.biCompression = BI_RGB;
+        void *bits = nullptr;
+        dc = CreateCompatibleDC(nullptr);
+        bmp = dc ? CreateDIBSection(dc, &bi, DIB_RGB_COLORS, &bits, nullptr, 0) : nullptr;
+        if(!bmp) return false;
+        old = SelectObject(dc, bmp);
+        return true;
+    }
+    ~Offscreen() {
+        if(dc && old) SelectObject(dc, old);
+        if(bmp) DeleteObject(bmp);
+        if(dc) DeleteDC(dc);
+    }
+};
+
+int main(int argc, char **argv) {
+    int cursors = argc > 1 ? atoi(argv[1]) : 10000;
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    int frames = argc > 3 ? atoi(argv[3]) : 600;
+    int flockPct = argc > 4 ? std::clamp(atoi(argv[4]), 0, 100) : 0;
+    int workers = argc > 5 ? atoi(argv[5]) : 0; // update pool size, 0 = auto
+    if(cursors < 1) cursors = 1;
+    if(clients < 0) clients = 0;
+    if(frames < 1) frames = 1;
+
+    static SwarmManager mgr; // large; keep it off the stack
+    mgr.jobs.setWorkers(workers);
+    for(int i = 0; i < cursors; i++) mgr.addCursor(MakeCursor(i, flockPct));
+    Offscreen target;
+    if(!target.open(kWidth, kHeight)) { printf("SwarmBench: offscreen DIB %dx%d failed gle=%lu\n", kWidth, kHeight, GetLastError()); return 1; }
+    printf("SwarmBench: %d cursors (20%% mirror, 20%% static, 30%% orbit, 30%% follow; %d%% of those flock), %d clients, %d frames, %d update workers, simd %s\n",
+        cursors, flockPct, clients, frames, workers ? workers : swarm_jobs::JobPool::AutoWorkers(), swarm_simd::IsaName(swarm_simd::ActiveIsa()));
+
+    const double dt = 1.0 / 60.0; // fixed step: results do not depend on wall-clock pacing
+    std::vector<RECT> dirty; dirty.reserve(SwarmManager::kMaxDirtyRects);
+    auto frame = [&](int f) {
+        // System cursor path: a slow Lissajous so mirror/follow/orbit lanes keep moving
+        POINT p { (LONG)(kWidth / 2 + 600 * std::sin(f * 0.021)), (LONG)(kHeight / 2 + 300 * std::sin(f * 0.033)) };
+        auto t0 = swarm_prof::Clock::now();
+        mgr.updateAll(dt, p);
+        uint64_t updateNs = swarm_prof::ElapsedNs(t0);
+        auto t1 = swarm_prof::Clock::now();
+        mgr.takeDirty(dirty);
+        if(!dirty.empty()) {
+            RECT rc = dirty[0];
+            for(auto &r : dirty) UnionRect(&rc, &rc, &r);
+            FillRect(target.dc, &rc, (HBRUSH)GetStockObject(BLACK_BRUSH));
+            RenderSnapshot::View view(mgr.snapshot);
+            PaintCursorsGdi(target.dc, rc, view.records(), mgr.gdiCache);
+        }
+        mgr.gdiCache.trim();
+        return std::make_pair(updateNs, swarm_prof::ElapsedNs(t1));
+    };
+    for(int f = 0; f < 30; f++) frame(f); // warm-up: lane capacity, GDI cache, snapshot buffers
+
+    std::atomic<bool> stop {false};
+    std::atomic<unsigned long long> applied {0};
+    std::vector<std::thread> pool;
+    for(int c = 0; c < clients; c++) pool.emplace_back(ClientLoop, std::ref(mgr), c, clients, cursors, std::ref(stop), std::ref(applied));
+
+    swarm_prof::Histogram update, render;
+    unsigned long long allocs0 = gAllocs.load();
+    auto wall0 = swarm_prof::Clock::now();
+    tCountAllocs = true;
+    for(int f = 0; f < frames; f++) {
+        auto r = frame(30 + f);
+        update.record(r.first); render.record(r.second);
+    }
+    tCountAllocs = false;
+    double wallSec = (double)swarm_prof::ElapsedNs(wall0) / 1e9;
+    stop = true;
+    for(auto &t : pool) t.join();
+    unsigned long long allocs = gAllocs.load() - allocs0;
+
+    auto perCursor = [&](const swarm_prof::Histogram &h, double q) { return (double)h.percentile(q) / cursors; };
+    printf("update  %8.2f ns/cursor/frame p50  %8.2f p99  (max frame %.3f ms)\n", perCursor(update, 0.5), perCursor(update, 0.99), update.max() / 1e6);
+    printf("render  %8.2f ns/cursor/frame p50  %8.2f p99  (max frame %.3f ms)\n", perCursor(render, 0.5), perCursor(render, 0.99), render.max() / 1e6);
+    if(clients) printf("clients %8.0f commands/sec (%d threads, contending with the update loop)\n", applied.load() / wallSec, clients);
+    printf("allocs  %8.2f per frame (update thread: simulate + snapshot + damage + paint)\n", (double)allocs / frames);
+    printf("lockWait p99 %.1f us over %llu acquisitions\n", Prof(Probe::LockWait).percentile(0.99) / 1e3, (unsigned long long)Prof(Probe::LockWait).count());
+    return 0;
+}
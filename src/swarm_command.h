@@ -0,0 +1,307 @@
+// Swarm command parser: one pass over a flat JSON-ish line into a typed Command
+// No allocation: string fields are views into the line, numbers go through from_chars, and field and
+// op/cmd names resolve through fixed-seed perfect hash tables (one hash + one compare per key).
+// Accepts the same loose syntax the overlay always has: a flat object, unescaped strings, quoted or
+// bare values, last duplicate key wins, unknown keys ignored. No <windows.h> so benchmarks build anywhere.
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace swarm_cmd {
+
+enum class Op : uint8_t {
+    None, Unknown, Help, Add, Set, Remove, Clear, List, Click, ClickId, DownId, UpId, DragId,
+    Save, Load, Reload, Exit, Perf, SetAhk, Debug, Tweak, Batch, Subscribe, StreamSubscribe, StreamUnsubscribe, Frame, PluginList,
+    RecordStart, RecordStop, PlayStart, PlayStop, Autosave, NetBroadcast, NetSubscribe, NetStop, Count
+};
+
+enum Field : uint8_t {
+    kId, kGen, kColor, kBehavior, kOffsetX, kOffsetY, kRadius, kRadiusDelta, kSpeed, kSpeedDelta,
+    kX, kY, kLagMs, kSize, kScript, kPath, kMode, kRender, kButton, kTx, kTy, kDx, kDy, kCmds, kEvents, kIds, kMaxHz, kHz, kFps, kMaxDtMs, kWorkers, kAtMs, kIntervalMs, kReset, kRid, kParams, kSeparation, kAlignment, kCohesion, kSeek, kMaxSpeed, kGroup, kPort, kTtl, kOp, kCmd, kFieldCount
+};
+static_assert(kFieldCount <= 64, "Command::present is a 64-bit mask");
+
+struct Command {
+    Op op {Op::None};
+    bool viaOp {false};      // structured "op" (takes precedence) vs legacy "cmd"
+    uint64_t present {0};    // bit per Field
+    std::string_view opName; // raw op/cmd value, for logs and errors
+    int id {0}, size {0}, button {0};
+    uint32_t gen {0};
+    long tx {0}, ty {0}, dx {0}, dy {0};
+    double offsetX {0}, offsetY {0}, radius {0}, radiusDelta {0}, speed {0}, speedDelta {0}, x {0}, y {0}, lagMs {0};
+    std::string_view color, behavior, script, path, mode, render;
+    std::string_view cmds;   // batch: raw "[{...},{...}]" array, walk with NextObject
+    std::string_view events, ids; // events/subscribe: "a,b" or raw ["a","b"] lists
+    double maxHz {0};
+    double hz {0};           // stream/subscribe rate
+    double fps {0}, maxDtMs {0}; // config/frame
+    int workers {0};         // config/frame: update threads (0 = auto)
+    double atMs {0};         // play/start: seek position
+    double intervalMs {0};   // state/autosave (0 = off)
+    bool reset {false};      // sys/perf: clear profiling histograms after reporting
+    std::string_view rid;    // client request id, echoed into the events this command emits
+    std::string_view params; // plugin behavior params: raw {"name":value,...}, walk with NextPair
+    double separation {0}, alignment {0}, cohesion {0}, seek {0}, maxSpeed {0}; // flock
+    std::string_view group;  // net/broadcast, net/subscribe: IPv4 multicast group (or broadcast/unicast address)
+    int port {0}, ttl {0};
+    bool has(Field f) const { return (present >> f) & 1u; }
+};
+
+// ---- perfect hash tables ----
+struct NameEntry { std::string_view name; uint8_t value; };
+
+constexpr uint32_t Hash(std::string_view s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for(char c : s) { h ^= (uint8_t)c; h *= 16777619u; }
+    h ^= h >> 15; h *= 0x2c1b3c6du; h ^= h >> 12; // FNV low bits only see low input bits: mix before masking
+    return h;
+}
+
+template<size_t Slots> struct PerfectTable {
+    uint8_t slot[Slots] {}; // entry index + 1, 0 = empty
+    bool collisionFree {true};
+};
+
+template<size_t Slots, size_t N>
+constexpr PerfectTable<Slots> BuildTable(const NameEntry (&e)[N], uint32_t seed) {
+    static_assert((Slots & (Slots - 1)) == 0 && N < Slots && N < 255, "table shape");
+    PerfectTable<Slots> t {};
+    for(size_t i=0;i<N;i++) {
+        uint32_t s = Hash(e[i].name, seed) & (Slots - 1);
+        if(t.slot[s]) t.collisionFree = false;
+        t.slot[s] = (uint8_t)(i + 1);
+    }
+    return t;
+}
+
+template<size_t Slots, size_t N>
+inline int Lookup(const NameEntry (&e)[N], const PerfectTable<Slots> &t, uint32_t seed, std::string_view s) {
+    uint8_t k = t.slot[Hash(s, seed) & (Slots - 1)];
+    return (k && e[k-1].name == s) ? e[k-1].value : -1;
+}
+
+inline constexpr NameEntry kFieldNames[] = {
+    {"id", kId}, {"gen", kGen}, {"color", kColor}, {"behavior", kBehavior}, {"offsetX", kOffsetX}, {"offsetY", kOffsetY},
+    {"radius", kRadius}, {"radiusDelta", kRadiusDelta}, {"speed", kSpeed}, {"speedDelta", kSpeedDelta}, {"x", kX}, {"y", kY},
+    {"lagMs", kLagMs}, {"size", kSize}, {"script", kScript}, {"path", kPath}, {"mode", kMode}, {"render", kRender},
+    {"button", kButton}, {"tx", kTx}, {"ty", kTy}, {"dx", kDx}, {"dy", kDy}, {"cmds", kCmds},
+    {"events", kEvents}, {"ids", kIds}, {"maxHz", kMaxHz}, {"hz", kHz}, {"fps", kFps}, {"maxDtMs", kMaxDtMs}, {"workers", kWorkers}, {"atMs", kAtMs}, {"intervalMs", kIntervalMs}, {"reset", kReset}, {"rid", kRid}, {"params", kParams},
+    {"separation", kSeparation}, {"alignment", kAlignment}, {"cohesion", kCohesion}, {"seek", kSeek}, {"maxSpeed", kMaxSpeed},
+    {"group", kGroup}, {"port", kPort}, {"ttl", kTtl}, {"op", kOp}, {"cmd", kCmd},
+};
+#define SWARM_OP(o) (uint8_t)Op::o
+// Structured "op" names
+inline constexpr NameEntry kOpNames[] = {
+    {"help", SWARM_OP(Help)}, {"cursor/add", SWARM_OP(Add)}, {"cursor/update", SWARM_OP(Set)}, {"cursor/remove", SWARM_OP(Remove)},
+    {"cursor/clear", SWARM_OP(Clear)}, {"cursor/list", SWARM_OP(List)}, {"cursor/tweak", SWARM_OP(Tweak)},
+    {"mouse/click", SWARM_OP(ClickId)}, {"mouse/down", SWARM_OP(DownId)}, {"mouse/up", SWARM_OP(UpId)}, {"mouse/drag", SWARM_OP(DragId)},
+    {"state/save", SWARM_OP(Save)}, {"state/load", SWARM_OP(Load)}, {"state/reload", SWARM_OP(Reload)}, {"state/autosave", SWARM_OP(Autosave)},
+    {"sys/exit", SWARM_OP(Exit)}, {"sys/perf", SWARM_OP(Perf)}, {"config/setAhk", SWARM_OP(SetAhk)}, {"config/frame", SWARM_OP(Frame)}, {"debug/mode", SWARM_OP(Debug)},
+    {"batch", SWARM_OP(Batch)}, {"events/subscribe", SWARM_OP(Subscribe)},
+    {"stream/subscribe", SWARM_OP(StreamSubscribe)}, {"stream/unsubscribe", SWARM_OP(StreamUnsubscribe)},
+    {"plugin/list", SWARM_OP(PluginList)},
+    {"record/start", SWARM_OP(RecordStart)}, {"record/stop", SWARM_OP(RecordStop)}, {"play/start", SWARM_OP(PlayStart)}, {"play/stop", SWARM_OP(PlayStop)},
+    {"net/broadcast", SWARM_OP(NetBroadcast)}, {"net/subscribe", SWARM_OP(NetSubscribe)}, {"net/stop", SWARM_OP(NetStop)},
+};
+// Legacy "cmd" names
+inline constexpr NameEntry kCmdNames[] = {
+    {"add", SWARM_OP(Add)}, {"set", SWARM_OP(Set)}, {"remove", SWARM_OP(Remove)}, {"clear", SWARM_OP(Clear)}, {"list", SWARM_OP(List)},
+    {"click", SWARM_OP(Click)}, {"clickId", SWARM_OP(ClickId)}, {"downId", SWARM_OP(DownId)}, {"upId", SWARM_OP(UpId)},
+    {"dragId", SWARM_OP(DragId)}, {"save", SWARM_OP(Save)}, {"load", SWARM_OP(Load)}, {"reload", SWARM_OP(Reload)},
+    {"exit", SWARM_OP(Exit)}, {"perf", SWARM_OP(Perf)}, {"setAhk", SWARM_OP(SetAhk)}, {"debug", SWARM_OP(Debug)}, {"tweak", SWARM_OP(Tweak)},
+};
+#undef SWARM_OP
+
+// Seeds picked so each name set fills its table without collisions; the static_asserts catch a
+// name added later that collides (pick a new seed then)
+static const uint32_t kFieldSeed = 6271, kOpSeed = 4375, kCmdSeed = 5;
+inline constexpr auto kFieldTable = BuildTable<128>(kFieldNames, kFieldSeed);
+inline constexpr auto kOpTable = BuildTable<64>(kOpNames, kOpSeed);
+inline constexpr auto kCmdTable = BuildTable<64>(kCmdNames, kCmdSeed);
+static_assert(kFieldTable.collisionFree, "field names collide: change kFieldSeed");
+static_assert(kOpTable.collisionFree, "op names collide: change kOpSeed");
+static_assert(kCmdTable.collisionFree, "cmd names collide: change kCmdSeed");
+
+// ---- value conversion (atoi/atof semantics on a trimmed value; invalid -> 0) ----
+template<class T> inline T ToNumber(std::string_view v) {
+    T r = 0;
+    const char *b = v.data(), *e = b + v.size();
+    if(b < e && *b == '+') b++;
+    std::from_chars(b, e, r);
+    return r;
+}
+// Short plain decimals ("80", "-1.25", "640.5") are the common case: mantissa < 2^53 divided by an exact
+// power of ten is correctly rounded (Clinger's fast path), so the result matches from_chars bit for bit
+template<> inline double ToNumber<double>(std::string_view v) {
+    static const double kPow10[] = { 1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15 };
+    const char *b = v.data(), *e = b + v.size(), *p = b;
+    bool neg = false;
+    if(p < e && (*p == '+' || *p == '-')) { neg = *p == '-'; p++; }
+    uint64_t m = 0; int digits = 0, frac = -1;
+    for(; p < e; p++) {
+        if(*p >= '0' && *p <= '9') { m = m*10 + (uint64_t)(*p - '0'); digits++; if(frac >= 0) frac++; }
+        else if(*p == '.' && frac < 0) frac = 0;
+        else break;
+    }
+    if(p == e && digits > 0 && digits <= 15) {
+        double r = (double)m / kPow10[frac > 0 ? frac : 0];
+        return neg ? -r : r;
+    }
+    double r = 0;
+    if(b < e && *b == '+') b++;
+    std::from_chars(b, e, r); // exponents, long mantissas, garbage suffixes (atof-style prefix parse)
+    return r;
+}
+
+inline void StoreField(Command &c, Field f, std::string_view v) {
+    c.present |= uint64_t(1) << f;
+    switch(f) {
+        case kId: c.id = ToNumber<int>(v); break;
+        case kGen: c.gen = ToNumber<uint32_t>(v); break;
+        case kColor: c.color = v; break;
+        case kBehavior: c.behavior = v; break;
+        case kOffsetX: c.offsetX = ToNumber<double>(v); break;
+        case kOffsetY: c.offsetY = ToNumber<double>(v); break;
+        case kRadius: c.radius = ToNumber<double>(v); break;
+        case kRadiusDelta: c.radiusDelta = ToNumber<double>(v); break;
+        case kSpeed: c.speed = ToNumber<double>(v); break;
+        case kSpeedDelta: c.speedDelta = ToNumber<double>(v); break;
+        case kX: c.x = ToNumber<double>(v); break;
+        case kY: c.y = ToNumber<double>(v); break;
+        case kLagMs: c.lagMs = ToNumber<double>(v); break;
+        case kSize: c.size = ToNumber<int>(v); break;
+        case kScript: c.script = v; break;
+        case kPath: c.path = v; break;
+        case kMode: c.mode = v; break;
+        case kRender: c.render = v; break;
+        case kButton: c.button = ToNumber<int>(v); break;
+        case kTx: c.tx = ToNumber<long>(v); break;
+        case kTy: c.ty = ToNumber<long>(v); break;
+        case kDx: c.dx = ToNumber<long>(v); break;
+        case kDy: c.dy = ToNumber<long>(v); break;
+        case kCmds: c.cmds = v; break;
+        case kEvents: c.events = v; break;
+        case kIds: c.ids = v; break;
+        case kMaxHz: c.maxHz = ToNumber<double>(v); break;
+        case kHz: c.hz = ToNumber<double>(v); break;
+        case kFps: c.fps = ToNumber<double>(v); break;
+        case kMaxDtMs: c.maxDtMs = ToNumber<double>(v); break;
+        case kWorkers: c.workers = ToNumber<int>(v); break;
+        case kAtMs: c.atMs = ToNumber<double>(v); break;
+        case kIntervalMs: c.intervalMs = ToNumber<double>(v); break;
+        case kReset: c.reset = v=="true" || ToNumber<int>(v) != 0; break;
+        case kRid: c.rid = v; break;
+        case kParams: c.params = v; break;
+        case kSeparation: c.separation = ToNumber<double>(v); break;
+        case kAlignment: c.alignment = ToNumber<double>(v); break;
+        case kCohesion: c.cohesion = ToNumber<double>(v); break;
+        case kSeek: c.seek = ToNumber<double>(v); break;
+        case kMaxSpeed: c.maxSpeed = ToNumber<double>(v); break;
+        case kGroup: c.group = v; break;
+        case kPort: c.port = ToNumber<int>(v); break;
+        case kTtl: c.ttl = ToNumber<int>(v); break;
+        default: break; // op/cmd handled by Parse
+    }
+}
+
+inline bool IsSpace(char ch) { return ch==' ' || ch=='\t' || ch=='\n' || ch=='\r' || ch=='\v' || ch=='\f'; }
+
+// Index just past the bracketed value starting at i (strings skipped, unescaped like everywhere else);
+// an unterminated value runs to the end of the line
+inline size_t SkipNested(std::string_view s, size_t i) {
+    int depth = 0;
+    for(; i<s.size(); i++) {
+        char ch = s[i];
+        if(ch=='"') { i++; while(i<s.size() && s[i] != '"') i++; if(i>=s.size()) break; }
+        else if(ch=='[' || ch=='{') depth++;
+        else if((ch==']' || ch=='}') && --depth==0) return i+1;
+    }
+    return s.size();
+}
+
+// Walk the top-level objects of a JSON array view: obj receives the next "{...}", arr advances past it
+inline bool NextObject(std::string_view &arr, std::string_view &obj) {
+    size_t i = 0;
+    if(!arr.empty() && arr[0]=='[') i = 1;
+    while(i<arr.size() && arr[i] != '{' && arr[i] != ']') i++;
+    if(i>=arr.size() || arr[i]==']') { arr = std::string_view(); return false; }
+    size_t end = SkipNested(arr, i);
+    obj = arr.substr(i, end-i);
+    arr = arr.substr(end);
+    return true;
+}
+
+// Walk a flat nested object view ("{\"a\":1,\"b\":\"2\"}"): key/value receive the next pair (quotes stripped)
+inline bool NextPair(std::string_view &obj, std::string_view &key, std::string_view &value) {
+    size_t i = 0, n = obj.size();
+    while(i<n && obj[i] != '"' && obj[i] != '}') i++;
+    if(i>=n || obj[i]=='}') { obj = std::string_view(); return false; }
+    size_t ks = ++i; while(i<n && obj[i] != '"') i++;
+    if(i>=n) { obj = std::string_view(); return false; }
+    key = obj.substr(ks, i-ks); i++;
+    while(i<n && (IsSpace(obj[i]) || obj[i]==':')) i++;
+    if(i<n && obj[i]=='"') { size_t vs = ++i; while(i<n && obj[i] != '"') i++; value = obj.substr(vs, i-vs); if(i<n) i++; }
+    else {
+        size_t vs = i; while(i<n && obj[i] != ',' && obj[i] != '}') i++;
+        size_t ve = i; while(ve>vs && IsSpace(obj[ve-1])) ve--;
+        value = obj.substr(vs, ve-vs);
+    }
+    obj = obj.substr(i);
+    return true;
+}
+
+// Fills out; returns false when the line carries neither "op" nor "cmd" (nothing to dispatch).
+// An unrecognized name yields Op::Unknown with opName set.
+inline bool Parse(std::string_view line, Command &out) {
+    out = Command{};
+    std::string_view opV, cmdV; bool haveOp = false, haveCmd = false;
+    size_t i = 0, n = line.size();
+    auto skipWs = [&]{ while(i<n && IsSpace(line[i])) i++; };
+    skipWs();
+    if(i>=n || line[i] != '{') return false;
+    i++;
+    while(i<n) {
+        skipWs();
+        if(i<n && line[i]=='}') break;
+        if(i>=n || line[i] != '"') break;
+        i++;
+        size_t ks = i; while(i<n && line[i] != '"') i++;
+        if(i>=n) break;
+        std::string_view key = line.substr(ks, i-ks); i++;
+        while(i<n && (IsSpace(line[i]) || line[i]==':')) { if(line[i]==':') { i++; break; } i++; }
+        skipWs();
+        std::string_view value;
+        if(i<n && line[i]=='"') {
+            i++; size_t vs = i; while(i<n && line[i] != '"') i++;
+            value = line.substr(vs, i-vs); if(i<n) i++;
+        } else if(i<n && (line[i]=='[' || line[i]=='{')) {
+            size_t vs = i; i = SkipNested(line, i);
+            value = line.substr(vs, i-vs);
+        } else {
+            size_t vs = i; while(i<n && line[i] != ',' && line[i] != '}') i++;
+            size_t ve = i; while(vs<ve && IsSpace(line[vs])) vs++; while(ve>vs && IsSpace(line[ve-1])) ve--;
+            value = line.substr(vs, ve-vs);
+        }
+        int f = Lookup(kFieldNames, kFieldTable, kFieldSeed, key);
+        if(f==kOp) { opV = value; haveOp = true; }
+        else if(f==kCmd) { cmdV = value; haveCmd = true; }
+        else if(f>=0) StoreField(out, (Field)f, value);
+        skipWs();
+        if(i<n && line[i]==',') { i++; continue; }
+        if(i<n && line[i]=='}') break;
+    }
+    if(haveOp) {
+        int o = Lookup(kOpNames, kOpTable, kOpSeed, opV);
+        out.op = o>=0 ? (Op)o : Op::Unknown; out.viaOp = true; out.opName = opV;
+    } else if(haveCmd) {
+        int o = Lookup(kCmdNames, kCmdTable, kCmdSeed, cmdV);
+        out.op = o>=0 ? (Op)o : Op::Unknown; out.opName = cmdV;
+    } else return false;
+    return true;
+}
+
+} // namespace swarm_cmd
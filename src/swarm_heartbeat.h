@@ -0,0 +1,126 @@
+// Swarm shared-memory heartbeat (overlay -> watchdog)
+// One small named file mapping that the overlay's HeartbeatThread rewrites every kPublishMs and the
+// watchdog reads on its timer, so liveness checks never touch the disk. Both sides create the mapping
+// (whoever is first sizes it), so the watchdog can open it before the overlay has started and keeps the
+// same block across overlay restarts: pid says which overlay wrote the current contents.
+// Writes are a seqlock: seq is odd while the overlay is writing, and a reader retries until it sees the
+// same even seq before and after copying the fields.
+#pragma once
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace swarm_hb {
+
+static const wchar_t kMappingName[] = L"Local\\SwarmHeartbeat";
+static const uint32_t kMagic = 0x42485753; // "SWHB"
+static const uint32_t kVersion = 2;
+static const int kPublishMs = 100;
+
+// What one heartbeat says
+struct Sample {
+    uint32_t pid;
+    int64_t epochMs;        // system clock at publish
+    uint64_t frame;         // UpdateThread frame counter: stops advancing if the simulation is wedged
+    uint64_t idlePolls;     // UpdateThread idle-gate polls: advance instead of frame while the overlay idles
+    uint32_t idle;          // 1 while UpdateThread is parked in the idle gate
+    double fps;
+    uint32_t cursors;
+    uint64_t commands;      // commands handled (pipe, scripts, config)
+    int64_t lastCommandMs;  // epoch ms the overlay last saw commands change; 0 = none yet
+};
+
+struct Shared {
+    uint32_t magic, version;
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> pid;
+    std::atomic<int64_t> epochMs, lastCommandMs;
+    std::atomic<uint64_t> frame, idlePolls, commands;
+    std::atomic<double> fps;
+    std::atomic<uint32_t> cursors, idle;
+};
+
+// Watchdog side: how long the overlay has shown no sign of life, from successive samples of one pid.
+// Progress is a frame or an idle poll: an idle overlay draws no frames but UpdateThread still polls the
+// idle gate, so idle is not stale while a wedged UpdateThread (neither advancing) still is.
+struct Progress {
+    bool seen {false};
+    uint64_t last {0};
+    int64_t seenAt {0};
+    void reset() { seen = false; }
+    int64_t age(const Sample &s, int64_t nowMs) {
+        uint64_t p = s.frame + s.idlePolls;
+        if(!seen || p != last) { last = p; seenAt = nowMs; seen = true; }
+        // Either the heartbeat thread stopped, or it runs while the update thread is wedged
+        return std::max(nowMs - s.epochMs, nowMs - seenAt);
+    }
+};
+
+// Maps the block (creating it if needed); both processes use this.
+class Block {
+public:
+    Block() = default;
+    Block(const Block&) = delete;
+    Block &operator=(const Block&) = delete;
+    ~Block() { close(); }
+
+    bool open() {
+        if(hb) return true;
+        map = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)sizeof(Shared), kMappingName);
+        if(!map) return false;
+        hb = (Shared*)MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Shared));
+        if(!hb) { close(); return false; }
+        return true;
+    }
+    void close() {
+        if(hb) { UnmapViewOfFile(hb); hb = nullptr; }
+        if(map) { CloseHandle(map); map = nullptr; }
+    }
+
+    // Overlay side
+    void publish(const Sample &s) {
+        uint32_t q = hb->seq.load(std::memory_order_relaxed);
+        hb->seq.store(q + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        hb->magic = kMagic; hb->version = kVersion;
+        hb->pid.store(s.pid, std::memory_order_relaxed);
+        hb->epochMs.store(s.epochMs, std::memory_order_relaxed);
+        hb->frame.store(s.frame, std::memory_order_relaxed);
+        hb->idlePolls.store(s.idlePolls, std::memory_order_relaxed);
+        hb->idle.store(s.idle, std::memory_order_relaxed);
+        hb->fps.store(s.fps, std::memory_order_relaxed);
+        hb->cursors.store(s.cursors, std::memory_order_relaxed);
+        hb->commands.store(s.commands, std::memory_order_relaxed);
+        hb->lastCommandMs.store(s.lastCommandMs, std::memory_order_relaxed);
+        hb->seq.store(q + 2, std::memory_order_release);
+    }
+
+    // Watchdog side: false if nothing has been published yet (or a writer kept it busy)
+    bool read(Sample &s) const {
+        for(int tries = 0; tries < 64; tries++) {
+            uint32_t q0 = hb->seq.load(std::memory_order_acquire);
+            if(q0 & 1) { YieldProcessor(); continue; }
+            if(hb->magic != kMagic || hb->version != kVersion) return false;
+            s.pid = hb->pid.load(std::memory_order_relaxed);
+            s.epochMs = hb->epochMs.load(std::memory_order_relaxed);
+            s.frame = hb->frame.load(std::memory_order_relaxed);
+            s.idlePolls = hb->idlePolls.load(std::memory_order_relaxed);
+            s.idle = hb->idle.load(std::memory_order_relaxed);
+            s.fps = hb->fps.load(std::memory_order_relaxed);
+            s.cursors = hb->cursors.load(std::memory_order_relaxed);
+            s.commands = hb->commands.load(std::memory_order_relaxed);
+            s.lastCommandMs = hb->lastCommandMs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(hb->seq.load(std::memory_order_relaxed) == q0) return true;
+        }
+        return false;
+    }
+
+private:
+    HANDLE map {nullptr};
+    Shared *hb {nullptr};
+};
+
+} // namespace swarm_hb
@@ -0,0 +1,158 @@
+// Swarm job system: fixed worker pool with per-worker work-stealing deques for the per-frame update
+// The frame's owner (UpdateThread, holding gManager.mtx) deals range jobs round-robin with begin(), may do
+// other work, then joins in as worker 0 from wait() until every job has finished. A worker pops its own
+// deque from the back and, once that is empty, steals from the front of the others, so a lane whose
+// chunks run slow (scripts, flock pile-ups) is spread over whoever is free. Workers sleep on a condition
+// variable between frames. Jobs are coarse (hundreds of cursors), so each deque is a plain mutex + vector.
+// A job may only touch its own index range and read state nobody writes during the phase.
+// Portable: only the standard library and swarm_profile.h (no <windows.h>), warning-clean under g++
+// -std=c++17 -Wall -Wextra -pedantic.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "swarm_profile.h"
+
+namespace swarm_jobs {
+
+static const int kMaxWorkers = 64;
+
+// fn(ctx, begin, end) over one index range
+struct Job { void (*fn)(void *ctx, size_t begin, size_t end); void *ctx; size_t begin, end; };
+
+// Appends f(begin, end) jobs of at most chunk indices covering [0, n); f must outlive the wait()
+template<class F> void Split(std::vector<Job> &jobs, size_t n, size_t chunk, F &f) {
+    for(size_t b=0;b<n;b+=chunk)
+        jobs.push_back(Job{ [](void *c, size_t b0, size_t e0) { (*(F*)c)(b0, e0); }, &f, b, std::min(n, b + chunk) });
+}
+
+struct WorkerStats {
+    std::atomic<unsigned long long> jobs {0}, steals {0}, busyNs {0};
+    swarm_prof::Histogram frameNs; // busy time in each frame this worker ran a job in
+    void reset() { jobs = 0; steals = 0; busyNs = 0; frameNs.reset(); }
+};
+
+class WorkDeque {
+public:
+    void push(const Job &j) { std::lock_guard<std::mutex> g(m); q.push_back(j); }
+    bool pop(Job &j) { // owner end
+        std::lock_guard<std::mutex> g(m);
+        if(head == q.size()) return false;
+        j = q.back(); q.pop_back();
+        if(head == q.size()) { q.clear(); head = 0; }
+        return true;
+    }
+    bool steal(Job &j) { // thief end
+        std::lock_guard<std::mutex> g(m);
+        if(head == q.size()) return false;
+        j = q[head++];
+        if(head == q.size()) { q.clear(); head = 0; }
+        return true;
+    }
+private:
+    std::mutex m;
+    std::vector<Job> q;
+    size_t head {0};
+};
+
+class JobPool {
+public:
+    JobPool() : deques(new WorkDeque[kMaxWorkers]), stat(new WorkerStats[kMaxWorkers]) {}
+    ~JobPool() { shutdown(); }
+    JobPool(const JobPool&) = delete;
+    JobPool &operator=(const JobPool&) = delete;
+
+    // Threads that run jobs, counting the owner; 0 = AutoWorkers(). Any thread; applied by the next begin().
+    void setWorkers(int n) { requested = std::clamp(n, 0, kMaxWorkers); }
+    int requestedWorkers() const { return requested.load(); }
+    int workers() const { return active.load(); }
+    static int AutoWorkers() { return std::clamp((int)std::thread::hardware_concurrency() / 2, 1, 8); }
+    WorkerStats &stats(int w) { return stat[w]; }
+
+    // Owner thread only. begin() then wait() before the jobs' captures go out of scope.
+    void begin(const std::vector<Job> &jobs) {
+        int want = requested.load(); if(!want) want = AutoWorkers();
+        if(want != count) restart(want);
+        remaining.store(jobs.size(), std::memory_order_relaxed);
+        for(size_t i=0;i<jobs.size();i++) deques[i % (size_t)count].push(jobs[i]);
+        if(count > 1 && jobs.size() > 1) {
+            { std::lock_guard<std::mutex> g(m); epoch++; }
+            cv.notify_all();
+        }
+    }
+    void wait() {
+        drain(0);
+        while(remaining.load(std::memory_order_acquire)) std::this_thread::yield(); // a worker is finishing its last job
+    }
+    void run(const std::vector<Job> &jobs) { begin(jobs); wait(); }
+    // Joins the workers; the next begin() starts them again
+    void shutdown() {
+        { std::lock_guard<std::mutex> g(m); stopping = true; }
+        cv.notify_all();
+        for(auto &t : threads) t.join();
+        threads.clear();
+        stopping = false;
+        count = 1; active = 1;
+    }
+
+private:
+    void restart(int n) {
+        shutdown();
+        count = n; active = n;
+        for(int w=1;w<n;w++) threads.emplace_back([this, w] { workerMain(w); });
+    }
+    void workerMain(int w) {
+        uint64_t seen = 0;
+        for(;;) {
+            {
+                std::unique_lock<std::mutex> g(m);
+                cv.wait(g, [&] { return stopping || epoch != seen; });
+                if(stopping) return;
+                seen = epoch;
+            }
+            drain(w);
+        }
+    }
+    // Runs jobs (own deque first, then stolen) until every deque is empty
+    void drain(int w) {
+        swarm_prof::Clock::time_point t0 = swarm_prof::Clock::now();
+        bool ran = false;
+        Job j;
+        for(;;) {
+            if(!deques[w].pop(j)) {
+                bool stolen = false;
+                for(int k=1;k<count && !stolen;k++) stolen = deques[(w + k) % count].steal(j);
+                if(!stolen) break;
+                stat[w].steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            j.fn(j.ctx, j.begin, j.end);
+            stat[w].jobs.fetch_add(1, std::memory_order_relaxed);
+            remaining.fetch_sub(1, std::memory_order_release);
+            ran = true;
+        }
+        if(!ran) return;
+        uint64_t ns = swarm_prof::ElapsedNs(t0);
+        stat[w].busyNs.fetch_add(ns, std::memory_order_relaxed);
+        stat[w].frameNs.record(ns);
+    }
+
+    std::unique_ptr<WorkDeque[]> deques;
+    std::unique_ptr<WorkerStats[]> stat;
+    std::vector<std::thread> threads;
+    int count {1};                        // owner-side size; workers read it only while running
+    std::atomic<int> active {1}, requested {0};
+    std::atomic<size_t> remaining {0};
+    std::mutex m;
+    std::condition_variable cv;
+    uint64_t epoch {0};
+    bool stopping {false};
+};
+
+} // namespace swarm_jobs
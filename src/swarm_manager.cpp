@@ -0,0 +1,43 @@
+// Swarm core: out-of-line parts of swarm_manager.h (probe storage, ETW provider, GDI paint core)
+#include "swarm_manager.h"
+
+SWARM_TRACE_DEFINE_PROVIDER()
+
+const char *const kProbeNames[(size_t)Probe::Count] = { "frameWork", "updateAll", "snapshot", "render", "paintClear", "paintDraw", "paintHelp", "command", "lockWait" };
+swarm_prof::Histogram gProbes[(size_t)Probe::Count];
+
+void DrawCursorShape(HDC hdc, int cx, int cy, int size) {
+    const POINT *base = kArrowBase;
+    const int n = kArrowPoints;
+    double scale = size / (double)kArrowBoxH; // scale height
+    // Determine width for centering (approx max x); keep in sync with CursorBounds
+    int maxX = kArrowBoxW; int maxY = kArrowBoxH;
+    int w = (int)(maxX * scale);
+    int h = (int)(maxY * scale);
+    int ox = cx - w/2; // shift so shape centered at (cx,cy)
+    int oy = cy - h/2;
+    POINT pts[16];
+    for(int i=0;i<n;i++) {
+        pts[i].x = (LONG)(ox + base[i].x * scale);
+        pts[i].y = (LONG)(oy + base[i].y * scale);
+    }
+    Polygon(hdc, pts, n);
+}
+
+void PaintCursorsGdi(HDC hdc, const RECT &rc, const std::vector<CursorRenderRecord> &records, GdiColorCache &cache) {
+    HGDIOBJ oldBrush = SelectObject(hdc, GetStockObject(NULL_BRUSH));
+    HGDIOBJ oldPen = SelectObject(hdc, GetStockObject(BLACK_PEN));
+    bool haveColor = false; COLORREF selColor = 0;
+    for(const auto &c : records) {
+        RECT b = CursorBounds(c.pos.x, c.pos.y, c.size), isect;
+        if(!IntersectRect(&isect, &b, &rc)) continue;
+        if(!haveColor || c.color != selColor) {
+            const GdiColorCache::Entry &e = cache.get(c.color);
+            SelectObject(hdc, e.brush); SelectObject(hdc, e.pen);
+            selColor = c.color; haveColor = true;
+        }
+        DrawCursorShape(hdc, c.pos.x, c.pos.y, c.size);
+    }
+    SelectObject(hdc, oldPen);
+    SelectObject(hdc, oldBrush);
+}
@@ -0,0 +1,818 @@
+// Swarm core: cursor model, SoA behavior lanes, SwarmManager simulation and the GDI paint core
+// Shared by SwarmOverlay and the headless SwarmBench (SwarmCore library). No windows, pipes or
+// threads here: callers own the update loop, the lock discipline (mtx) and where frames are presented.
+#pragma once
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "swarm_simd.h"
+#include "swarm_profile.h"
+#include "swarm_trace.h"
+#include "swarm_vm.h"
+#include "swarm_plugin.h"
+#include "swarm_jobs.h"
+
+enum class BehaviorType { Mirror, Static, Orbit, FollowLag, Script, Flock, Plugin };
+static const int kBehaviorCount = 6; // built-in lanes; Plugin cursors live in one lane per registered plugin behavior
+
+// Arrow glyph box used by DrawCursorShape (unscaled); size scales the 28px height
+static const int kArrowBoxW = 20;
+static const int kArrowBoxH = 28;
+// Base arrow coordinates (approx Windows arrow) in the 20x28 box, origin at tip
+// Points (x,y): tip at (0,0), down to (0,20), across to (6,14), to (11,28), (15,26), (9,13), (20,13), back to tip
+static const POINT kArrowBase[] = { {0,0},{0,20},{6,14},{11,28},{15,26},{9,13},{20,13} };
+static const int kArrowPoints = (int)(sizeof(kArrowBase)/sizeof(kArrowBase[0]));
+// Halo drawn around each arrow by the per-pixel-alpha (ULW) renderer
+static const int kGlowPad = 3;
+
+// Screen rect touched by any renderer for a cursor centered at (cx,cy), incl. pen overhang and glow
+inline RECT CursorBounds(LONG cx, LONG cy, int size) {
+    double scale = size / (double)kArrowBoxH;
+    int w = (int)(kArrowBoxW * scale);
+    int h = (int)(kArrowBoxH * scale);
+    LONG ox = cx - w/2, oy = cy - h/2;
+    RECT r { ox - 1 - kGlowPad, oy - 1 - kGlowPad, ox + w + 2 + kGlowPad, oy + h + 2 + kGlowPad };
+    return r;
+}
+
+struct SwarmCursor {
+    int id {0};
+    BehaviorType behavior {BehaviorType::Mirror};
+    POINT pos {0,0}; // current render position
+    POINT target {0,0}; // for static / follow
+    COLORREF color {RGB(255,0,0)};
+    int size {12};
+    // behavior params
+    double offsetX {0};
+    double offsetY {0};
+    double radius {60};
+    double angle {0};
+    double speed {1}; // radians per second for orbit
+    double lagMs {120};
+    // Flock (boids): neighbor radius is `radius`; steering weights, speed cap (px/s) and velocity
+    double separation {1.5}, alignment {1.0}, cohesion {1.0}, seek {0.5};
+    double maxSpeed {240};
+    double vx {0}, vy {0};
+    // For FollowLag EMA / Flock initial velocity
+    bool initialized {false};
+    // Script integration (stored in the manager's cold table, not the hot lanes)
+    std::string scriptPath;              // .ahk path when behavior==Script
+    // behavior==Plugin: registered behavior index and its params in schema order
+    int plugin {-1};
+    std::vector<float> pluginParams;
+};
+
+// POD per-cursor record published for renderers and `list` (no strings or handles)
+struct CursorRenderRecord {
+    int id;
+    POINT pos;
+    int size;
+    COLORREF color;
+    BehaviorType behavior;
+};
+
+// Triple-buffered render snapshot. UpdateThread fills a spare buffer and publishes it with a single
+// atomic index store; readers pin the latest buffer instead of taking SwarmManager::mtx. The writer
+// only ever fills a buffer that is neither the latest nor pinned.
+class RenderSnapshot {
+    std::vector<CursorRenderRecord> bufs[3];
+    std::atomic<int> pins[3];
+    std::atomic<int> latest {0};
+    int writing {-1}; // writer thread only
+public:
+    std::atomic<unsigned long long> skipped {0}; // frames not published: both spare buffers were pinned
+    RenderSnapshot() { for(auto &p : pins) p = 0; }
+
+    // Writer: emptied buffer to fill (capacity kept), or nullptr to skip this frame
+    std::vector<CursorRenderRecord> *beginWrite() {
+        int cur = latest.load();
+        for(int i=0;i<3;i++) if(i!=cur && pins[i].load()==0) { writing = i; bufs[i].clear(); return &bufs[i]; }
+        skipped++;
+        return nullptr;
+    }
+    void publish() { if(writing>=0) { latest.store(writing); writing = -1; } }
+
+    // Reader: pins the latest buffer for its lifetime; keep it short (copy out before blocking I/O)
+    class View {
+        RenderSnapshot *snap; int idx;
+    public:
+        explicit View(RenderSnapshot &s) : snap(&s) {
+            for(;;) {
+                idx = snap->latest.load();
+                snap->pins[idx]++;
+                if(snap->latest.load()==idx) break; // still latest => writer cannot pick it
+                snap->pins[idx]--;
+            }
+        }
+        ~View() { snap->pins[idx]--; }
+        View(const View&) = delete;
+        View &operator=(const View&) = delete;
+        const std::vector<CursorRenderRecord> &records() const { return snap->bufs[idx]; }
+    };
+};
+
+// Cold per-cursor data, kept out of the update loop's cache lines (keyed by id in SwarmManager::cold)
+struct CursorCold {
+    std::string scriptPath;
+    PROCESS_INFORMATION scriptPi{0};
+    bool scriptProcessRunning {false};
+};
+
+// Hot per-cursor state as structure-of-arrays, one lane per BehaviorType, so updateAll runs a
+// single SIMD kernel per lane instead of switching per cursor (floats: kernels are 8 wide on AVX2)
+struct CursorLane {
+    std::vector<int> id;
+    std::vector<float> x, y;              // current render position
+    std::vector<float> targetX, targetY;  // static / script target
+    std::vector<float> offsetX, offsetY;
+    std::vector<float> radius, angle, speed, lagMs;
+    std::vector<float> separation, alignment, cohesion, seek, maxSpeed, vx, vy; // Flock
+    std::vector<COLORREF> color;
+    std::vector<int> size;
+    std::vector<uint8_t> initialized;     // FollowLag: snapped to systemPos / Flock: velocity seeded, on first update
+    std::vector<std::vector<float>> params; // plugin lanes: params[k][i] in schema order (empty for built-ins)
+    size_t pendingInit {0};               // count of initialized==0 entries
+    // Damage tracking: bounds/color as last painted (empty until first update)
+    std::vector<RECT> drawn;
+    std::vector<COLORREF> drawnColor;
+
+    size_t count() const { return id.size(); }
+    void push(const SwarmCursor &c) {
+        id.push_back(c.id);
+        x.push_back((float)c.pos.x); y.push_back((float)c.pos.y);
+        targetX.push_back((float)c.target.x); targetY.push_back((float)c.target.y);
+        offsetX.push_back((float)c.offsetX); offsetY.push_back((float)c.offsetY);
+        radius.push_back((float)c.radius); angle.push_back(swarm_simd::WrapAngle((float)std::remainder(c.angle, (double)swarm_simd::kTwoPi)));
+        speed.push_back((float)c.speed); lagMs.push_back((float)c.lagMs);
+        separation.push_back((float)c.separation); alignment.push_back((float)c.alignment); cohesion.push_back((float)c.cohesion);
+        seek.push_back((float)c.seek); maxSpeed.push_back((float)c.maxSpeed); vx.push_back((float)c.vx); vy.push_back((float)c.vy);
+        color.push_back(c.color); size.push_back(c.size);
+        initialized.push_back(c.initialized ? 1 : 0); if(!c.initialized) pendingInit++;
+        drawn.push_back(RECT{0,0,0,0}); drawnColor.push_back(0);
+        for(size_t k=0;k<params.size();k++) params[k].push_back(k < c.pluginParams.size() ? c.pluginParams[k] : 0.0f);
+    }
+    void read(size_t i, SwarmCursor &c) const {
+        c.id = id[i];
+        c.pos.x = (LONG)x[i]; c.pos.y = (LONG)y[i];
+        c.target.x = (LONG)targetX[i]; c.target.y = (LONG)targetY[i];
+        c.offsetX = offsetX[i]; c.offsetY = offsetY[i];
+        c.radius = radius[i]; c.angle = angle[i]; c.speed = speed[i]; c.lagMs = lagMs[i];
+        c.separation = separation[i]; c.alignment = alignment[i]; c.cohesion = cohesion[i]; c.seek = seek[i];
+        c.maxSpeed = maxSpeed[i]; c.vx = vx[i]; c.vy = vy[i];
+        c.color = color[i]; c.size = size[i]; c.initialized = initialized[i]!=0;
+        c.pluginParams.resize(params.size());
+        for(size_t k=0;k<params.size();k++) c.pluginParams[k] = params[k][i];
+    }
+    // Write back an edited record; sub-pixel position is kept unless the integer position changed
+    void write(size_t i, const SwarmCursor &c) {
+        if((LONG)x[i] != c.pos.x) x[i] = (float)c.pos.x;
+        if((LONG)y[i] != c.pos.y) y[i] = (float)c.pos.y;
+        targetX[i] = (float)c.target.x; targetY[i] = (float)c.target.y;
+        offsetX[i] = (float)c.offsetX; offsetY[i] = (float)c.offsetY;
+        radius[i] = (float)c.radius; speed[i] = (float)c.speed; lagMs[i] = (float)c.lagMs;
+        separation[i] = (float)c.separation; alignment[i] = (float)c.alignment; cohesion[i] = (float)c.cohesion;
+        seek[i] = (float)c.seek; maxSpeed[i] = (float)c.maxSpeed; vx[i] = (float)c.vx; vy[i] = (float)c.vy;
+        color[i] = c.color; size[i] = c.size;
+        if(c.pluginParams.size() == params.size()) for(size_t k=0;k<params.size();k++) params[k][i] = c.pluginParams[k];
+    }
+    // Swap-and-pop removal: the last entry moves into i. Returns the id that moved (0 if i was last);
+    // painted is set to the removed entry's last bounds so the caller can damage them
+    int swapRemove(size_t i, RECT &painted) {
+        painted = drawn[i];
+        if(!initialized[i]) pendingInit--;
+        size_t last = id.size() - 1;
+        auto e = [i, last](auto &v){ if(i != last) v[i] = v[last]; v.pop_back(); };
+        e(id); e(x); e(y); e(targetX); e(targetY); e(offsetX); e(offsetY);
+        e(radius); e(angle); e(speed); e(lagMs); e(color); e(size); e(initialized); e(drawn); e(drawnColor);
+        e(separation); e(alignment); e(cohesion); e(seek); e(maxSpeed); e(vx); e(vy);
+        for(auto &p : params) e(p);
+        return i != last ? id[i] : 0;
+    }
+    void clear() {
+        auto c = [](auto &v){ v.clear(); };
+        c(id); c(x); c(y); c(targetX); c(targetY); c(offsetX); c(offsetY);
+        c(radius); c(angle); c(speed); c(lagMs); c(color); c(size); c(initialized); c(drawn); c(drawnColor);
+        c(separation); c(alignment); c(cohesion); c(seek); c(maxSpeed); c(vx); c(vy);
+        for(auto &p : params) c(p);
+        pendingInit = 0;
+    }
+};
+
+// Spatial hash over every cursor position: square cells hashed into a power-of-two bucket table and
+// counting-sorted, so a rebuild is O(n) without allocation once warm and a radius query visits only
+// the cells it overlaps. Entries carry lane/index back to the lane arrays.
+struct SpatialGrid {
+    struct Entry { float x, y; int32_t cx, cy; uint32_t lane, index; };
+    float cell {64};
+    int maxSize {0};                        // largest cursor size indexed (hit-test reach)
+    std::vector<Entry> entries;             // grouped by bucket
+    std::vector<uint32_t> start, next;      // bucket b owns entries [start[b], start[b+1]); next: build scratch
+    std::vector<uint32_t> bucketOf;         // build scratch, one per cursor in lane order
+    uint32_t mask {0};
+
+    static uint32_t HashCell(int32_t cx, int32_t cy) { return (uint32_t)cx * 73856093u ^ (uint32_t)cy * 19349663u; }
+    int32_t cellOf(float v) const { return (int32_t)std::floor(v / cell); }
+
+    template<class LaneAt> void build(int laneCount, LaneAt laneAt, size_t total, float cellSize) {
+        cell = cellSize;
+        size_t buckets = 64; while(buckets < total * 2) buckets <<= 1;
+        mask = (uint32_t)buckets - 1;
+        start.assign(buckets + 1, 0);
+        entries.resize(total); bucketOf.resize(total);
+        maxSize = 0;
+        size_t n = 0;
+        for(int k=0;k<laneCount;k++) {
+            const CursorLane &l = laneAt(k);
+            for(size_t i=0;i<l.count();i++) {
+                uint32_t b = HashCell(cellOf(l.x[i]), cellOf(l.y[i])) & mask;
+                bucketOf[n++] = b; start[b + 1]++;
+                maxSize = std::max(maxSize, l.size[i]);
+            }
+        }
+        for(size_t b=0;b<buckets;b++) start[b + 1] += start[b];
+        next.assign(start.begin(), start.end() - 1);
+        n = 0;
+        for(int k=0;k<laneCount;k++) {
+            const CursorLane &l = laneAt(k);
+            for(size_t i=0;i<l.count();i++)
+                entries[next[bucketOf[n++]]++] = Entry{ l.x[i], l.y[i], cellOf(l.x[i]), cellOf(l.y[i]), (uint32_t)k, (uint32_t)i };
+        }
+    }
+    // f(const Entry&) for every entry in the cells overlapping the square of half-width r around (x,y), until f
+    // returns false. Callers check the exact distance; very large r falls back to a scan of every entry.
+    template<class F> void query(float x, float y, float r, F f) const {
+        int32_t x0 = cellOf(x - r), x1 = cellOf(x + r), y0 = cellOf(y - r), y1 = cellOf(y + r);
+        if((int64_t)(x1 - x0 + 1) * (y1 - y0 + 1) > (int64_t)mask + 1) {
+            for(const Entry &e : entries) if(!f(e)) return;
+            return;
+        }
+        for(int32_t cy=y0; cy<=y1; cy++)
+            for(int32_t cx=x0; cx<=x1; cx++) {
+                uint32_t b = HashCell(cx, cy) & mask;
+                for(uint32_t j=start[b]; j<start[b + 1]; j++) {
+                    const Entry &e = entries[j];
+                    if(e.cx == cx && e.cy == cy && !f(e)) return; // other cells sharing the bucket are skipped
+                }
+            }
+    }
+    // As query, but the cells are visited nearest first (the one holding (x,y), then by distance to each
+    // cell's closest point), so a caller that stops early keeps the nearest neighbors from all sides.
+    // More than kNearCells cells falls back to query's order.
+    static const int kNearCells = 49;
+    template<class F> void queryNearest(float x, float y, float r, F f) const {
+        int32_t x0 = cellOf(x - r), x1 = cellOf(x + r), y0 = cellOf(y - r), y1 = cellOf(y + r);
+        if((int64_t)(x1 - x0 + 1) * (y1 - y0 + 1) > kNearCells) { query(x, y, r, f); return; }
+        struct Cell { float d2; int32_t cx, cy; };
+        Cell cells[kNearCells];
+        int n = 0;
+        for(int32_t cy=y0; cy<=y1; cy++)
+            for(int32_t cx=x0; cx<=x1; cx++) {
+                float lx = cx * cell, ly = cy * cell;
+                float dx = x < lx ? lx - x : (x > lx + cell ? x - lx - cell : 0.0f);
+                float dy = y < ly ? ly - y : (y > ly + cell ? y - ly - cell : 0.0f);
+                Cell c { cx == cellOf(x) && cy == cellOf(y) ? -1.0f : dx*dx + dy*dy, cx, cy }; // own cell first, even on an edge
+                int j = n++;
+                for(; j > 0 && cells[j - 1].d2 > c.d2; j--) cells[j] = cells[j - 1]; // insertion sort, stable
+                cells[j] = c;
+            }
+        for(int k=0;k<n;k++) {
+            uint32_t b = HashCell(cells[k].cx, cells[k].cy) & mask;
+            for(uint32_t j=start[b]; j<start[b + 1]; j++) {
+                const Entry &e = entries[j];
+                if(e.cx == cells[k].cx && e.cy == cells[k].cy && !f(e)) return;
+            }
+        }
+    }
+};
+
+// Solid brush + 1px pen per color, reused across frames (UI thread only; counters readable anywhere)
+struct GdiColorCache {
+    struct Entry { HBRUSH brush {nullptr}; HPEN pen {nullptr}; };
+    static const size_t kMaxEntries = 512; // flushed by trim() between frames when exceeded
+    std::unordered_map<COLORREF, Entry> entries;
+    std::atomic<unsigned long long> hits {0};
+    std::atomic<unsigned long long> misses {0};
+    std::atomic<size_t> size {0};
+
+    const Entry &get(COLORREF color) {
+        auto it = entries.find(color);
+        if(it != entries.end()) { hits++; return it->second; }
+        misses++;
+        Entry e; e.brush = CreateSolidBrush(color); e.pen = CreatePen(PS_SOLID, 1, color);
+        size = entries.size() + 1;
+        return entries.emplace(color, e).first->second;
+    }
+    // Call only while no cached object is selected into a DC
+    void trim() { if(entries.size() > kMaxEntries) clear(); }
+    void clear() {
+        for(auto &kv : entries) { DeleteObject(kv.second.brush); DeleteObject(kv.second.pen); }
+        entries.clear(); size = 0;
+    }
+    double hitRate() const {
+        unsigned long long h = hits.load(), m = misses.load();
+        return (h + m) ? (double)h / (double)(h + m) : 0.0;
+    }
+    ~GdiColorCache() { clear(); }
+};
+
+// Dense id -> (lane, index) map; ids index slots directly. gen is bumped each time an id is inserted,
+// so a (id, gen) pair taken earlier is detected as stale once that id is removed or reused. Ids at or
+// above kMaxId and ids already live are rejected; a removed id sits in freeIds at most once.
+struct CursorSlotMap {
+    struct Slot { uint32_t gen {0}; uint32_t index {0}; uint8_t lane {0}; bool live {false}, queued {false}; };
+    static const int kMaxId = 1 << 20;
+    std::vector<Slot> slots;
+    std::deque<int> freeIds; // FIFO: a removed id is handed out again as late as possible
+
+    // gen 0 matches any generation
+    Slot *find(int id, uint32_t gen = 0) {
+        if(id <= 0 || id >= (int)slots.size()) return nullptr;
+        Slot &s = slots[id];
+        return (s.live && (gen==0 || s.gen==gen)) ? &s : nullptr;
+    }
+    // Returns the new generation, or 0 if id is out of range or already live
+    uint32_t insert(int id, uint8_t lane, uint32_t index) {
+        if(id <= 0 || id >= kMaxId) return 0;
+        if(id >= (int)slots.size()) slots.resize(std::max((size_t)id + 1, slots.size() * 2));
+        Slot &s = slots[id];
+        if(s.live) return 0;
+        if(++s.gen == 0) s.gen = 1;
+        s.index = index; s.lane = lane; s.live = true;
+        return s.gen;
+    }
+    void erase(int id) {
+        Slot &s = slots[id];
+        s.live = false;
+        if(!s.queued) { s.queued = true; freeIds.push_back(id); } // removed, re-taken explicitly, removed again
+    }
+    // Next id for a cursor added without one: recycled ids first, then nextId (0 when exhausted).
+    // Nothing is consumed until takeId, so an add that is rejected afterwards loses no id.
+    int peekId(const std::atomic<int> &nextId) {
+        while(!freeIds.empty()) {
+            int id = freeIds.front();
+            if(!slots[id].live) return id;
+            freeIds.pop_front(); slots[id].queued = false; // re-taken explicitly since removal
+        }
+        return nextId < kMaxId ? nextId.load() : 0;
+    }
+    // id was just inserted: consume it from freeIds, or move nextId past it
+    void takeId(int id, std::atomic<int> &nextId) {
+        if(!freeIds.empty() && freeIds.front()==id) { freeIds.pop_front(); slots[id].queued = false; }
+        else if(id >= nextId) nextId = id + 1;
+    }
+    void clear() {
+        for(size_t id=1; id<slots.size(); id++) if(slots[id].live) erase((int)id);
+    }
+};
+
+// ---------------- Profiling probes (sys/perf "profile" event) ----------------
+// Nanosecond histograms; see swarm_profile.h. frameWork is the update loop minus the pacing wait.
+enum class Probe { FrameWork, Update, Snapshot, Render, PaintClear, PaintDraw, PaintHelp, Command, LockWait, Count };
+extern const char *const kProbeNames[(size_t)Probe::Count];
+extern swarm_prof::Histogram gProbes[(size_t)Probe::Count];
+inline swarm_prof::Histogram &Prof(Probe p) { return gProbes[(size_t)p]; }
+
+// Every gManager.mtx acquisition: records its wait time into the lockWait probe
+struct ManagerLock : swarm_prof::TimedLock<std::mutex> {
+    explicit ManagerLock(std::mutex &m) : TimedLock(m, Prof(Probe::LockWait)) {
+        if(waitedNs()) SWARM_TRACE_LOCK_WAIT("gManager.mtx", waitedNs());
+    }
+};
+
+// Native behavior registered by a plugin DLL (swarm_plugin.h); copied out of its SwarmBehaviorDesc
+struct PluginBehavior {
+    struct Param { std::string name; float def, lo, hi; uint32_t flags; };
+    std::string name;
+    std::vector<Param> params;
+    SwarmBehaviorUpdateFn update {nullptr};
+    void *user {nullptr};
+    int param(std::string_view n) const {
+        for(size_t k=0;k<params.size();k++) if(params[k].name == n) return (int)k;
+        return -1;
+    }
+};
+
+class SwarmManager {
+public:
+    CursorLane lanes[kBehaviorCount]; // indexed by BehaviorType (guarded by mtx)
+    CursorSlotMap slots;                      // id -> lane/index (guarded by mtx)
+    std::unordered_map<int, CursorCold> cold; // script path / process per id (guarded by mtx)
+    std::unordered_map<int, swarm_vm::Instance> vms; // embedded .lua scripts per id (guarded by mtx)
+    uint32_t vmBudget {swarm_vm::kDefaultBudget};  // VM instructions per script call
+    std::atomic<unsigned long long> vmCalls {0}, vmOverBudget {0};
+    // Plugin behaviors are registered at startup only (before pipes and UpdateThread run), so plugins is
+    // read without mtx afterwards; pluginLanes[p] holds behavior p's cursors (guarded by mtx)
+    std::vector<PluginBehavior> plugins;
+    std::vector<CursorLane> pluginLanes;
+    static const int kMaxPlugins = 64; // slot lane index is a uint8_t
+    // Spatial index of every cursor (guarded by mtx): rebuilt by the flock step each frame, or on demand by hitTestLocked
+    SpatialGrid grid;
+    bool gridFresh {false};
+    std::vector<float> flockVx, flockVy; // flock step scratch: next velocities
+    static const int kFlockMaxCandidates = 32; // neighbor visits per boid (nearest cells first, self excluded): bounds a pile-up to O(n)
+    // updateAll splits the lanes into jobs on this pool (owner: the thread calling updateAll)
+    swarm_jobs::JobPool jobs;
+    std::vector<swarm_jobs::Job> frameJobs;                    // updateAll scratch
+    std::vector<std::pair<swarm_vm::Instance*, size_t>> vmRun; // updateAll scratch: script lane index per VM
+    static const size_t kLaneChunk = 4096, kFlockChunk = 512, kScriptChunk = 32; // cursors per job
+    std::atomic<size_t> cursorCount {0};      // readable without mtx (perf, heartbeat)
+    std::atomic<uint64_t> stateVersion {0};   // bumped by every add/remove/modify (what a save captures; autosave polls it)
+    std::mutex mtx;
+    std::atomic<bool> running {true};
+    std::atomic<HWND> overlayWnd {nullptr}; // written on the UI thread (window rebuilds), read from any
+    std::atomic<int> nextId {1};
+    GdiColorCache gdiCache; // brushes/pens for WM_PAINT
+    RenderSnapshot snapshot; // published by updateAll, read lock-free by renderers and `list`
+    // Screen rects that changed since the last takeDirty (guarded by mtx)
+    std::vector<RECT> dirty;
+    static const size_t kMaxDirtyRects = 256; // beyond this collapse into one bounding rect
+
+    CursorLane &lane(BehaviorType b) { return lanes[(int)b]; } // built-in behaviors only
+    // Lane index space: built-ins first, then one per plugin behavior
+    int laneCount() const { return kBehaviorCount + (int)pluginLanes.size(); }
+    CursorLane &laneAt(int k) { return k < kBehaviorCount ? lanes[k] : pluginLanes[k - kBehaviorCount]; }
+    static BehaviorType LaneBehavior(int k) { return k < kBehaviorCount ? (BehaviorType)k : BehaviorType::Plugin; }
+    static int LaneOf(const SwarmCursor &c) { return c.behavior == BehaviorType::Plugin ? kBehaviorCount + c.plugin : (int)c.behavior; }
+    int findPlugin(std::string_view name) const {
+        for(size_t p=0;p<plugins.size();p++) if(plugins[p].name == name) return (int)p;
+        return -1;
+    }
+    // Startup only; returns the behavior index or -1 (duplicate name / too many)
+    int registerPlugin(PluginBehavior b) {
+        ManagerLock lock(mtx);
+        if(findPlugin(b.name) >= 0 || (int)plugins.size() >= kMaxPlugins) return -1;
+        pluginLanes.emplace_back();
+        pluginLanes.back().params.resize(b.params.size());
+        plugins.push_back(std::move(b));
+        return (int)plugins.size() - 1;
+    }
+    // Drop behaviors registered after count (a plugin whose init failed); they have no cursors yet
+    void truncatePlugins(size_t count) {
+        ManagerLock lock(mtx);
+        if(count < plugins.size()) { plugins.resize(count); pluginLanes.resize(count); }
+    }
+
+    void markDirtyLocked(const RECT &r) {
+        if(IsRectEmpty(&r)) return;
+        if(dirty.size() >= kMaxDirtyRects) {
+            RECT u = r;
+            for(auto &d : dirty) UnionRect(&u, &u, &d);
+            dirty.clear();
+            dirty.push_back(u);
+            return;
+        }
+        dirty.push_back(r);
+    }
+    // Swap pending damage into out (out is cleared first); empty result means nothing to repaint
+    void takeDirty(std::vector<RECT> &out) {
+        out.clear();
+        ManagerLock lock(mtx);
+        out.swap(dirty);
+    }
+    void clearCursorsLocked() {
+        for(int k=0;k<laneCount();k++) {
+            CursorLane &l = laneAt(k);
+            for(auto &r : l.drawn) markDirtyLocked(r);
+            l.clear();
+        }
+        slots.clear();
+        cold.clear();
+        vms.clear();
+        gridFresh = false; stateVersion++;
+        cursorCount = 0;
+    }
+    // Locate id (and generation, 0 = any); returns false if absent or stale
+    bool findLocked(int id, BehaviorType &b, size_t &idx, uint32_t gen = 0) {
+        CursorSlotMap::Slot *s = slots.find(id, gen);
+        if(!s) return false;
+        b = LaneBehavior(s->lane); idx = s->index;
+        return true;
+    }
+    bool findLaneLocked(int id, int &laneIdx, size_t &idx, uint32_t gen = 0) {
+        CursorSlotMap::Slot *s = slots.find(id, gen);
+        if(!s) return false;
+        laneIdx = s->lane; idx = s->index;
+        return true;
+    }
+    uint32_t genLocked(int id) { CursorSlotMap::Slot *s = slots.find(id); return s ? s->gen : 0; }
+    // Remove lane entry i and repoint the slot of whichever cursor filled the hole
+    RECT eraseFromLaneLocked(int laneIdx, size_t i) {
+        RECT painted;
+        if(int moved = laneAt(laneIdx).swapRemove(i, painted)) slots.slots[moved].index = (uint32_t)i;
+        return painted;
+    }
+    CursorCold *coldLocked(int id) {
+        auto it = cold.find(id);
+        return it==cold.end() ? nullptr : &it->second;
+    }
+
+    // Returns the id (0 if the requested id is out of range or already in use); gen receives its generation
+    int addCursor(const SwarmCursor &base, uint32_t *gen = nullptr) {
+        ManagerLock lock(mtx);
+        return addCursorLocked(base, gen);
+    }
+    int addCursorLocked(const SwarmCursor &base, uint32_t *gen = nullptr) {
+        SwarmCursor c = base;
+        if(c.behavior == BehaviorType::Plugin && (c.plugin < 0 || c.plugin >= (int)plugins.size())) return 0;
+        if(c.id==0) c.id = slots.peekId(nextId);
+        int k = LaneOf(c);
+        uint32_t g = slots.insert(c.id, (uint8_t)k, (uint32_t)laneAt(k).count());
+        if(!g) return 0; // out of range or live: no id consumed
+        slots.takeId(c.id, nextId);
+        laneAt(k).push(c);
+        gridFresh = false; stateVersion++;
+        if(!c.scriptPath.empty()) cold[c.id].scriptPath = c.scriptPath;
+        cursorCount++;
+        if(gen) *gen = g;
+        return c.id;
+    }
+    bool removeCursor(int id, uint32_t gen = 0) {
+        ManagerLock lock(mtx);
+        return removeCursorLocked(id, gen);
+    }
+    // Caller has stopped any script process/pipe for id
+    bool removeCursorLocked(int id, uint32_t gen = 0) {
+        int k; size_t i;
+        if(!findLaneLocked(id, k, i, gen)) return false;
+        markDirtyLocked(eraseFromLaneLocked(k, i));
+        gridFresh = false; stateVersion++;
+        slots.erase(id);
+        cold.erase(id);
+        vms.erase(id);
+        cursorCount--;
+        return true;
+    }
+    std::optional<SwarmCursor> getCursorCopy(int id) {
+        ManagerLock lock(mtx);
+        int k; size_t i;
+        if(!findLaneLocked(id, k, i)) return std::nullopt;
+        SwarmCursor c; readLocked(k, i, c);
+        if(CursorCold *cc = coldLocked(id)) c.scriptPath = cc->scriptPath;
+        return c;
+    }
+    // Read-modify-write one cursor through the AoS view; a changed behavior moves it to its new lane
+    template<class F> bool modifyLocked(int id, F f, uint32_t gen = 0) {
+        int k; size_t i;
+        if(!findLaneLocked(id, k, i, gen)) return false;
+        SwarmCursor c; readLocked(k, i, c);
+        f(c);
+        gridFresh = false; stateVersion++;
+        if(c.behavior == BehaviorType::Plugin && (c.plugin < 0 || c.plugin >= (int)plugins.size())) return false;
+        int to = LaneOf(c);
+        if(to == k) { laneAt(k).write(i, c); return true; }
+        RECT old = eraseFromLaneLocked(k, i);
+        CursorSlotMap::Slot &s = slots.slots[id];
+        s.lane = (uint8_t)to; s.index = (uint32_t)laneAt(to).count();
+        laneAt(to).push(c);
+        laneAt(to).drawn.back() = old; // damage old bounds on next update
+        return true;
+    }
+    void buildGridLocked(float cellSize) {
+        grid.build(laneCount(), [this](int k) -> const CursorLane& { return laneAt(k); }, cursorCount.load(), cellSize);
+        gridFresh = true;
+    }
+    // Id of the topmost cursor (drawn last) whose bounds contain (x,y), 0 if none
+    int hitTestLocked(LONG x, LONG y) {
+        if(!gridFresh) buildGridLocked(64);
+        RECT reach = CursorBounds(0, 0, grid.maxSize);
+        float r = (float)std::max(std::max(-reach.left, reach.right), std::max(-reach.top, reach.bottom));
+        uint32_t bestLane = 0, bestIndex = 0; bool found = false;
+        POINT pt { x, y };
+        grid.query((float)x, (float)y, r, [&](const SpatialGrid::Entry &e) {
+            RECT b = CursorBounds((LONG)e.x, (LONG)e.y, laneAt((int)e.lane).size[e.index]);
+            if(PtInRect(&b, pt) && (!found || e.lane > bestLane || (e.lane == bestLane && e.index > bestIndex))) { bestLane = e.lane; bestIndex = e.index; found = true; }
+            return true;
+        });
+        return found ? laneAt((int)bestLane).id[bestIndex] : 0;
+    }
+    // Boids over the Flock lane: separation (within radius/2, from every cursor), alignment and cohesion
+    // (flock neighbors within radius) and seek (system cursor), each a weighted steer toward maxSpeed.
+    // Neighbors come from the grid, so a frame is O(n) in cursors; all boids read last frame's velocities.
+    void flockStepLocked(float dt, float sx, float sy) {
+        CursorLane &f = lane(BehaviorType::Flock);
+        const size_t n = f.count();
+        if(f.pendingInit) { // spread initial headings by id (golden angle)
+            for(size_t i=0;i<n;i++) if(!f.initialized[i]) {
+                float a = (float)f.id[i] * 2.39996f;
+                f.vx[i] = std::cos(a) * f.maxSpeed[i] * 0.5f; f.vy[i] = std::sin(a) * f.maxSpeed[i] * 0.5f;
+                f.initialized[i] = 1;
+            }
+            f.pendingInit = 0;
+        }
+        float cellSize = 32;
+        for(size_t i=0;i<n;i++) cellSize = std::max(cellSize, f.radius[i]);
+        buildGridLocked(std::min(cellSize, 512.0f));
+        flockVx.resize(n); flockVy.resize(n);
+        const uint32_t kLane = (uint32_t)BehaviorType::Flock;
+        const float gain = std::min(1.0f, 4.0f * dt); // steering settles in about a quarter second
+        // Reads: grid entries (positions as of the build) and f.vx; writes: flockVx/flockVy and the boid's own
+        // position, so chunks run in parallel and nobody sees a neighbor that already moved this frame
+        auto step = [&](size_t b, size_t e) { for(size_t i=b;i<e;i++) {
+            const float x = f.x[i], y = f.y[i], r = std::max(1.0f, f.radius[i]), r2 = r * r, sep2 = r2 * 0.25f;
+            float sepX = 0, sepY = 0, aliX = 0, aliY = 0, cohX = 0, cohY = 0;
+            int flockmates = 0, visited = 0;
+            grid.queryNearest(x, y, r, [&](const SpatialGrid::Entry &e) {
+                if(e.lane == kLane && e.index == i) return true;
+                if(++visited > kFlockMaxCandidates) return false;
+                float dx = x - e.x, dy = y - e.y, d2 = dx*dx + dy*dy;
+                if(d2 >= r2) return true;
+                if(d2 < sep2 && d2 > 1e-4f) { sepX += dx / d2; sepY += dy / d2; } // nearer pushes harder
+                if(e.lane == kLane) { aliX += f.vx[e.index]; aliY += f.vy[e.index]; cohX += e.x; cohY += e.y; flockmates++; }
+                return true;
+            });
+            const float ms = std::max(1.0f, f.maxSpeed[i]), vx = f.vx[i], vy = f.vy[i];
+            float ax = 0, ay = 0;
+            auto steer = [&](float dx, float dy, float w) {
+                float len = std::sqrt(dx*dx + dy*dy);
+                if(w == 0 || len < 1e-6f) return;
+                ax += w * (dx / len * ms - vx); ay += w * (dy / len * ms - vy);
+            };
+            steer(sepX, sepY, f.separation[i]);
+            if(flockmates) {
+                steer(aliX, aliY, f.alignment[i]);
+                steer(cohX / flockmates - x, cohY / flockmates - y, f.cohesion[i]);
+            }
+            steer(sx - x, sy - y, f.seek[i]);
+            float nvx = vx + ax * gain, nvy = vy + ay * gain, sp = std::sqrt(nvx*nvx + nvy*nvy);
+            if(sp > ms) { nvx *= ms / sp; nvy *= ms / sp; }
+            flockVx[i] = nvx; flockVy[i] = nvy;
+            f.x[i] = f.targetX[i] = x + nvx * dt; f.y[i] = f.targetY[i] = y + nvy * dt;
+        } };
+        frameJobs.clear();
+        swarm_jobs::Split(frameJobs, n, kFlockChunk, step);
+        jobs.run(frameJobs);
+        f.vx.swap(flockVx); f.vy.swap(flockVy);
+        gridFresh = false; // flock moved after the build
+    }
+    // AoS view of lane k entry i (behavior and plugin index from the lane)
+    void readLocked(int k, size_t i, SwarmCursor &c) {
+        c.behavior = LaneBehavior(k);
+        c.plugin = k < kBehaviorCount ? -1 : k - kBehaviorCount;
+        laneAt(k).read(i, c);
+    }
+    void setPosLocked(int id, LONG px, LONG py, uint32_t gen = 0) {
+        int k; size_t i;
+        if(!findLaneLocked(id, k, i, gen)) return;
+        CursorLane &l = laneAt(k);
+        gridFresh = false; stateVersion++;
+        l.x[i] = l.targetX[i] = (float)px; l.y[i] = l.targetY[i] = (float)py;
+    }
+    // AoS copy of every cursor (lane order); withCold fills scriptPath
+    void copyCursorsLocked(std::vector<SwarmCursor> &out, bool withCold = false) {
+        out.clear(); out.reserve(cursorCount);
+        for(int k=0;k<laneCount();k++) {
+            const CursorLane &l = laneAt(k);
+            for(size_t i=0;i<l.count();i++) {
+                out.emplace_back(); readLocked(k, i, out.back());
+                if(withCold) if(CursorCold *cc = coldLocked(l.id[i])) out.back().scriptPath = cc->scriptPath;
+            }
+        }
+    }
+    void copyCursors(std::vector<SwarmCursor> &out, bool withCold = false) {
+        ManagerLock lock(mtx);
+        copyCursorsLocked(out, withCold);
+    }
+    // Attach a compiled .lua script to id (replacing any) and run its top level once from the current position
+    bool attachScriptLocked(int id, std::shared_ptr<const swarm_vm::Program> prog) {
+        int k; size_t i;
+        if(!findLaneLocked(id, k, i)) return false;
+        swarm_vm::Instance &vm = vms.insert_or_assign(id, swarm_vm::Instance(std::move(prog), id)).first->second;
+        runScriptLocked(vm, laneAt(k), i, vm.prog->initPc);
+        return true;
+    }
+    // One VM call for lane entry i; an over-budget call leaves the position unchanged
+    void runScriptLocked(swarm_vm::Instance &vm, CursorLane &l, size_t i, uint32_t pc) {
+        double *v = vm.vars.data();
+        v[swarm_vm::kSlotX] = l.x[i]; v[swarm_vm::kSlotY] = l.y[i]; v[swarm_vm::kSlotT] = vm.time;
+        vm.calls++; vmCalls++;
+        if(swarm_vm::Run(*vm.prog, pc, v, vm.rng, vmBudget) != swarm_vm::Status::Ok) { vm.overBudget++; vmOverBudget++; return; }
+        double nx = v[swarm_vm::kSlotX], ny = v[swarm_vm::kSlotY];
+        if(std::isfinite(nx) && std::isfinite(ny) && std::fabs(nx) < 1e7 && std::fabs(ny) < 1e7) {
+            l.x[i] = l.targetX[i] = (float)nx; l.y[i] = l.targetY[i] = (float)ny;
+        }
+    }
+    void updateAll(double dt, POINT systemPos) {
+        ManagerLock lock(mtx);
+        gridFresh = false;
+        const float sx = (float)systemPos.x, sy = (float)systemPos.y, fdt = (float)dt;
+        CursorLane &mirror = lane(BehaviorType::Mirror), &fixed = lane(BehaviorType::Static), &orbit = lane(BehaviorType::Orbit);
+        CursorLane &follow = lane(BehaviorType::FollowLag), &script = lane(BehaviorType::Script);
+        if(follow.pendingInit) {
+            for(size_t i=0;i<follow.count();i++) if(!follow.initialized[i]) { follow.x[i] = sx; follow.y[i] = sy; follow.initialized[i] = 1; }
+            follow.pendingInit = 0;
+        }
+        // Script lane: .lua scripts run as one batch; AHK scripts push positions through their pipe instead
+        vmRun.clear();
+        for(auto &kv : vms) {
+            BehaviorType b; size_t i;
+            if(kv.second.prog->updatePc >= 0 && findLocked(kv.first, b, i) && b == BehaviorType::Script) vmRun.emplace_back(&kv.second, i);
+        }
+        // Built-in lanes as range jobs: each reads and writes only its own indices of one lane
+        auto mirrorStep = [&](size_t b, size_t e) {
+            swarm_simd::MirrorStep(mirror.x.data() + b, mirror.y.data() + b, mirror.offsetX.data() + b, mirror.offsetY.data() + b, e - b, sx, sy);
+        };
+        auto fixedStep = [&](size_t b, size_t e) {
+            std::copy(fixed.targetX.begin() + b, fixed.targetX.begin() + e, fixed.x.begin() + b);
+            std::copy(fixed.targetY.begin() + b, fixed.targetY.begin() + e, fixed.y.begin() + b);
+        };
+        auto orbitStep = [&](size_t b, size_t e) {
+            swarm_simd::OrbitStep(orbit.angle.data() + b, orbit.speed.data() + b, orbit.radius.data() + b, orbit.x.data() + b, orbit.y.data() + b, e - b, fdt, sx, sy);
+        };
+        auto followStep = [&](size_t b, size_t e) {
+            swarm_simd::FollowStep(follow.x.data() + b, follow.y.data() + b, follow.lagMs.data() + b, e - b, fdt, sx, sy);
+        };
+        auto scriptStep = [&](size_t b, size_t e) {
+            for(size_t j=b;j<e;j++) {
+                swarm_vm::Instance &vm = *vmRun[j].first;
+                vm.time += dt;
+                vm.vars[swarm_vm::kSlotDt] = dt; vm.vars[swarm_vm::kSlotMouseX] = sx; vm.vars[swarm_vm::kSlotMouseY] = sy;
+                runScriptLocked(vm, script, vmRun[j].second, (uint32_t)vm.prog->updatePc);
+            }
+        };
+        frameJobs.clear();
+        swarm_jobs::Split(frameJobs, vmRun.size(), kScriptChunk, scriptStep); // scripts first: the steal end of every deque
+        swarm_jobs::Split(frameJobs, mirror.count(), kLaneChunk, mirrorStep);
+        swarm_jobs::Split(frameJobs, fixed.count(), kLaneChunk, fixedStep);
+        swarm_jobs::Split(frameJobs, orbit.count(), kLaneChunk, orbitStep);
+        swarm_jobs::Split(frameJobs, follow.count(), kLaneChunk, followStep);
+        jobs.begin(frameJobs);
+        // Plugin lanes stay on this thread (swarm_plugin.h promises the update thread) while the pool runs the rest:
+        // one native batch call per behavior over its contiguous arrays
+        for(size_t p=0;p<pluginLanes.size();p++) {
+            CursorLane &l = pluginLanes[p];
+            if(!l.count()) continue;
+            float *params[SWARM_PLUGIN_MAX_PARAMS];
+            for(size_t k=0;k<l.params.size();k++) params[k] = l.params[k].data();
+            SwarmBehaviorSpan span { l.count(), l.id.data(), l.x.data(), l.y.data(), l.targetX.data(), l.targetY.data(), params, (uint32_t)l.params.size() };
+            plugins[p].update(plugins[p].user, &span, fdt, sx, sy);
+        }
+        jobs.wait();
+        // Flock last: it steers against everybody's positions for this frame
+        if(lane(BehaviorType::Flock).count()) flockStepLocked(fdt, sx, sy);
+        // Damage: old and new bounds when anything visible changed (pos/size/color); same pass fills the snapshot
+        swarm_prof::ScopedTimer handoff(Prof(Probe::Snapshot));
+        std::vector<CursorRenderRecord> *out = snapshot.beginWrite();
+        for(int k=0;k<laneCount();k++) {
+            CursorLane &l = laneAt(k);
+            for(size_t i=0;i<l.count();i++) {
+                POINT p { (LONG)l.x[i], (LONG)l.y[i] };
+                RECT nb = CursorBounds(p.x, p.y, l.size[i]);
+                if(!EqualRect(&nb, &l.drawn[i]) || l.color[i] != l.drawnColor[i]) {
+                    markDirtyLocked(l.drawn[i]);
+                    markDirtyLocked(nb);
+                    l.drawn[i] = nb; l.drawnColor[i] = l.color[i];
+                }
+                if(out) out->push_back(CursorRenderRecord{ l.id[i], p, l.size[i], l.color[i], LaneBehavior(k) });
+            }
+        }
+        if(out) snapshot.publish();
+    }
+};
+
+// Draw a simple arrow (cursor-like) shape centered at (cx,cy) with the brush/pen selected in hdc
+// size ~= overall height of arrow
+void DrawCursorShape(HDC hdc, int cx, int cy, int size);
+// Draw every record whose bounds intersect rc with its cached brush/pen (no clear); dc state is restored
+void PaintCursorsGdi(HDC hdc, const RECT &rc, const std::vector<CursorRenderRecord> &records, GdiColorCache &cache);
+
+// Persistent 32bpp off-screen surface the size of the overlay; recreated only when the display changes
+struct BackBuffer {
+    HDC dc {nullptr};
+    HBITMAP bmp {nullptr};
+    HGDIOBJ oldBmp {nullptr};
+    int w {0}, h {0};
+
+    // Returns false if the DIB could not be created (caller paints directly)
+    bool ensure(HDC ref, int width, int height) {
+        if(dc && w==width && h==height) return true;
+        release();
+        BITMAPINFO bi{}; bi.bmiHeader.biSize = sizeof(bi.bmiHeader);
+        bi.bmiHeader.biWidth = width; bi.bmiHeader.biHeight = -height; // top-down
+        bi.bmiHeader.biPlanes = 1; bi.bmiHeader.biBitCount = 32; bi.bmiHeader.biCompression = BI_RGB;
+        void *bits = nullptr;
+        bmp = CreateDIBSection(ref, &bi, DIB_RGB_COLORS, &bits, nullptr, 0);
+        if(!bmp) { printf("BackBuffer: CreateDIBSection %dx%d failed gle=%lu\n", width, height, GetLastError()); return false; }
+        dc = CreateCompatibleDC(ref);
+        oldBmp = SelectObject(dc, bmp);
+        w = width; h = height;
+        RECT all { 0, 0, w, h };
+        FillRect(dc, &all, (HBRUSH)GetStockObject(BLACK_BRUSH));
+        return true;
+    }
+    void release() {
+        if(dc) { SelectObject(dc, oldBmp); DeleteDC(dc); dc = nullptr; }
+        if(bmp) { DeleteObject(bmp); bmp = nullptr; }
+        w = h = 0;
+    }
+    ~BackBuffer() { release(); }
+};
@@ -0,0 +1,195 @@
+// Swarm LAN broadcast format (net/broadcast, net/subscribe)
+// The publisher sends each frame's render snapshot as UDP datagrams of at most kMaxDatagram bytes.
+// Datagrams are self-contained: a delta lists the cursors that changed since the previous frame with
+// their new absolute values, so a lost datagram only leaves its cursors one change behind. Every
+// kKeyIntervalMs a keyframe carries the full set, split into id ranges, so late joiners and anything a
+// lost datagram left stale (a cursor that stopped, recolored or was removed) recover within that time.
+//
+// Byte layout (little endian; varint = LEB128, zz = zig-zag varint; primitives from swarm_record.h):
+//   Header (24 bytes): magic "SWNB", version u8, kind u8 ('K'/'D'), part u16, parts u16, reserved u16,
+//                      session u32 (random per net/broadcast), seq u32 (datagram counter), frame u32
+//   'K' keyframe part: zz idLo, zz idHi, u16 n, n x [zz id delta, zz x, zz y, varint size, u24 color]
+//                      every cursor with idLo <= id <= idHi, ids ascending (the parts tile all ids)
+//   'D' delta:         u16 n, n x [zz id delta, u8 flags, (pos) zz x zz y, (color) u24, (size) varint]
+//                      flags as in swarm_record.h; a cursor new since the last frame sends all three
+// Id deltas start from idLo (keyframes) or 0 (deltas). The receiver drops datagrams older than the
+// newest frame it applied, so reordering cannot move a cursor backwards.
+// Anyone on the LAN can send to the group: parse() rejects a datagram with any value outside what
+// cursor/add would accept (size, coordinates, ids), and a subscriber creates at most kMaxCursors.
+// No <windows.h>: the format builds anywhere; main.cpp owns the sockets.
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "swarm_record.h"
+
+namespace swarm_net {
+
+using swarm_rec::Cursor;
+static const uint32_t kMagic = 0x424E5753;    // "SWNB"
+static const uint8_t kVersion = 1;
+static const size_t kHeaderSize = 24;
+static const size_t kMaxDatagram = 1200;      // under the 1472-byte Ethernet UDP payload, with room for VPN/VLAN headers
+static const uint32_t kKeyIntervalMs = 500;
+static const size_t kMaxEntry = 24;           // worst-case encoded cursor entry
+static const uint16_t kDefaultPort = 47800;
+static const char kDefaultGroup[] = "239.255.77.1"; // administratively scoped (site-local) multicast
+static const int32_t kMinSize = 3, kMaxSize = 399;   // as cursor/add: 2 < size < 400
+static const int64_t kMaxCoord = 1 << 24;            // |x|, |y|: far beyond any virtual desktop
+static const size_t kMaxCursors = 16384;             // cursors one subscription creates at most
+
+struct Header { uint8_t kind; uint16_t part, parts; uint32_t session, seq, frame; };
+
+inline void PutU16(std::string &o, uint16_t v) { o.push_back((char)(v & 0xFF)); o.push_back((char)(v >> 8)); }
+inline void SetU16(std::string &o, size_t at, uint16_t v) { o[at] = (char)(v & 0xFF); o[at + 1] = (char)(v >> 8); }
+
+// ---- encoder: frame() per published snapshot, datagrams appended to out ----
+class Encoder {
+    std::unordered_map<int32_t, Cursor> last; // as of the previous frame
+    std::vector<Cursor> cur;
+    std::vector<std::pair<Cursor, uint8_t>> changes;
+    uint32_t session {0}, seq {0}, frameNo {0};
+    size_t first {0}; // index in out of this frame's first datagram
+
+    std::string &open(std::vector<std::string> &out, uint8_t kind) {
+        out.emplace_back();
+        std::string &d = out.back();
+        d.reserve(kMaxDatagram);
+        swarm_rec::PutU32(d, kMagic); d.push_back((char)kVersion); d.push_back((char)kind);
+        PutU16(d, (uint16_t)(out.size() - 1 - first)); PutU16(d, 0); PutU16(d, 0);
+        swarm_rec::PutU32(d, session); swarm_rec::PutU32(d, seq++); swarm_rec::PutU32(d, frameNo);
+        return d;
+    }
+    // parts is only known once the frame is packed
+    void seal(std::vector<std::string> &out) {
+        for(size_t i=first;i<out.size();i++) SetU16(out[i], 8, (uint16_t)(out.size() - first));
+    }
+public:
+    explicit Encoder(uint32_t sessionId = 0) : session(sessionId) {}
+    uint32_t frames() const { return frameNo; }
+
+    // records: the frame's snapshot in any order. Nothing is appended for a delta frame without changes.
+    template<class Records> void frame(const Records &records, bool key, std::vector<std::string> &out) {
+        cur.clear();
+        // clamped to what parse() accepts, so one odd cursor cannot get a whole datagram rejected
+        for(const auto &r : records) cur.push_back(Cursor{ r.id, (int32_t)std::clamp<int64_t>(r.pos.x, -kMaxCoord, kMaxCoord), (int32_t)std::clamp<int64_t>(r.pos.y, -kMaxCoord, kMaxCoord),
+                                                           std::clamp<int32_t>(r.size, kMinSize, kMaxSize), (uint32_t)r.color & 0xFFFFFF });
+        std::sort(cur.begin(), cur.end());
+        first = out.size();
+        frameNo++;
+        if(key) {
+            size_t i = 0;
+            int32_t lo = INT32_MIN;
+            do {
+                std::string &d = open(out, 'K');
+                swarm_rec::PutZz(d, lo);
+                size_t hiAt = d.size(); // idHi is written after the part is full: reserve the 5-byte worst case
+                d.append(5, '\0');
+                size_t nAt = d.size(); PutU16(d, 0);
+                uint16_t n = 0;
+                int32_t prevId = lo;
+                for(; i < cur.size() && d.size() + kMaxEntry <= kMaxDatagram && n < 0xFFFF; i++, n++) {
+                    const Cursor &c = cur[i];
+                    swarm_rec::PutZz(d, (int64_t)c.id - prevId); swarm_rec::PutZz(d, c.x); swarm_rec::PutZz(d, c.y);
+                    swarm_rec::PutVar(d, (uint32_t)c.size); swarm_rec::PutU24(d, c.color);
+                    prevId = c.id;
+                }
+                int32_t hi = i < cur.size() ? prevId : INT32_MAX;
+                std::string z; swarm_rec::PutZz(z, hi);
+                while(z.size() < 5) { z.back() = (char)(z.back() | 0x80); z.push_back('\0'); } // padded varint: same value, fixed width
+                d.replace(hiAt, 5, z);
+                SetU16(d, nAt, n);
+                lo = hi == INT32_MAX ? hi : hi + 1;
+            } while(i < cur.size());
+            last.clear();
+            for(const Cursor &c : cur) last[c.id] = c;
+            seal(out);
+            return;
+        }
+        changes.clear();
+        for(const Cursor &c : cur) {
+            auto it = last.find(c.id);
+            if(it == last.end()) { changes.emplace_back(c, (uint8_t)(swarm_rec::kPos | swarm_rec::kColor | swarm_rec::kSize)); continue; }
+            const Cursor &o = it->second;
+            uint8_t f = (uint8_t)((c.x != o.x || c.y != o.y ? swarm_rec::kPos : 0) | (c.color != o.color ? swarm_rec::kColor : 0) | (c.size != o.size ? swarm_rec::kSize : 0));
+            if(f) changes.emplace_back(c, f);
+        }
+        for(const auto &kv : last)
+            if(!std::binary_search(cur.begin(), cur.end(), Cursor{ kv.first, 0, 0, 0, 0 })) changes.emplace_back(kv.second, (uint8_t)swarm_rec::kGone);
+        if(changes.empty()) return;
+        std::sort(changes.begin(), changes.end(), [](const std::pair<Cursor, uint8_t> &a, const std::pair<Cursor, uint8_t> &b) { return a.first.id < b.first.id; });
+        for(size_t i = 0; i < changes.size();) {
+            std::string &d = open(out, 'D');
+            size_t nAt = d.size(); PutU16(d, 0);
+            uint16_t n = 0;
+            int32_t prevId = 0;
+            for(; i < changes.size() && d.size() + kMaxEntry <= kMaxDatagram && n < 0xFFFF; i++, n++) {
+                const Cursor &c = changes[i].first; uint8_t f = changes[i].second;
+                swarm_rec::PutZz(d, (int64_t)c.id - prevId); d.push_back((char)f);
+                prevId = c.id;
+                if(f & swarm_rec::kGone) continue;
+                if(f & swarm_rec::kPos) { swarm_rec::PutZz(d, c.x); swarm_rec::PutZz(d, c.y); }
+                if(f & swarm_rec::kColor) swarm_rec::PutU24(d, c.color);
+                if(f & swarm_rec::kSize) swarm_rec::PutVar(d, (uint32_t)c.size);
+            }
+            SetU16(d, nAt, n);
+        }
+        for(const auto &ch : changes) if(ch.second & swarm_rec::kGone) last.erase(ch.first.id);
+        for(const Cursor &c : cur) last[c.id] = c;
+        seal(out);
+    }
+};
+
+// ---- decoder: one datagram at a time ----
+struct Change { Cursor c; uint8_t flags; }; // values present per flags (keyframe entries: kPos|kColor|kSize)
+
+struct Datagram {
+    Header h {};
+    int32_t idLo {0}, idHi {0}; // keyframe: the id range this part is the whole truth for
+    std::vector<Change> changes;
+
+    // false for anything that is not a well-formed datagram of this version
+    bool parse(const uint8_t *data, size_t n) {
+        changes.clear();
+        swarm_rec::In in { data, data + n };
+        if(n < kHeaderSize || in.fixed(4) != kMagic || in.u8() != kVersion) return false;
+        h.kind = in.u8();
+        h.part = (uint16_t)in.fixed(2); h.parts = (uint16_t)in.fixed(2); in.fixed(2);
+        h.session = (uint32_t)in.fixed(4); h.seq = (uint32_t)in.fixed(4); h.frame = (uint32_t)in.fixed(4);
+        if((h.kind != 'K' && h.kind != 'D') || h.part >= h.parts) return false;
+        auto coord = [](int64_t v) { return v >= -kMaxCoord && v <= kMaxCoord; };
+        int64_t id = 0;
+        if(h.kind == 'K') {
+            int64_t lo = in.zz(), hi = in.zz();
+            if(lo < INT32_MIN || hi > INT32_MAX || lo > hi) return false;
+            idLo = (int32_t)lo; idHi = (int32_t)hi; id = lo;
+        }
+        uint16_t count = (uint16_t)in.fixed(2);
+        changes.reserve(count);
+        for(uint16_t i=0;i<count && !in.bad;i++) {
+            id += in.zz();
+            if(id < INT32_MIN || id > INT32_MAX) return false;
+            Cursor c { (int32_t)id, 0, 0, 0, 0 };
+            uint8_t f = h.kind == 'K' ? (uint8_t)(swarm_rec::kPos | swarm_rec::kColor | swarm_rec::kSize) : in.u8();
+            if(!(f & swarm_rec::kGone)) {
+                // keyframe entries are x, y, size, color; delta entries pos, color, size per flags
+                int64_t x = 0, y = 0; uint64_t size = kMinSize;
+                if(f & swarm_rec::kPos) { x = in.zz(); y = in.zz(); }
+                if(h.kind == 'K') size = in.var();
+                if(f & swarm_rec::kColor) c.color = in.u24();
+                if(h.kind != 'K' && (f & swarm_rec::kSize)) size = in.var();
+                if(!coord(x) || !coord(y) || size < (uint64_t)kMinSize || size > (uint64_t)kMaxSize) return false;
+                c.x = (int32_t)x; c.y = (int32_t)y; c.size = (int32_t)size;
+            }
+            changes.push_back(Change{ c, f });
+        }
+        return !in.bad;
+    }
+};
+
+} // namespace swarm_net
@@ -0,0 +1,74 @@
+/* Swarm native behavior plugin ABI (plain C: any compiler, no C++ types cross the DLL boundary)
+ * A plugin is a DLL in plugins\ next to SwarmOverlay.exe that exports SwarmPluginInit. At startup the overlay
+ * loads each DLL and calls init, which registers one or more named behaviors through host->registerBehavior.
+ * {"op":"cursor/add","behavior":"plugin:<name>","params":{"stiffness":60}} then places a cursor in that
+ * behavior's lane, and its update callback runs once per frame over every such cursor as contiguous arrays.
+ * update runs on the overlay's update thread with the cursor lock held: keep it non-blocking and do not
+ * call back into the overlay from it.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWARM_PLUGIN_API_VERSION 1
+#define SWARM_PLUGIN_MAX_PARAMS 16
+
+#if defined(_WIN32)
+#define SWARM_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define SWARM_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+/* Param flags */
+#define SWARM_PARAM_STATE 1u /* per-cursor state owned by update (velocity, phase): not settable or saved */
+
+typedef struct SwarmParamDesc {
+    const char *name;        /* [A-Za-z0-9_], unique within the behavior */
+    float defaultValue;
+    float minValue, maxValue; /* commands are clamped to this range */
+    uint32_t flags;
+} SwarmParamDesc;
+
+/* Every cursor of one behavior as structure-of-arrays; index i is the same cursor in each array.
+ * Cursors may be added, removed or reordered between calls: keep per-cursor state in params, not by index. */
+typedef struct SwarmBehaviorSpan {
+    size_t count;
+    const int32_t *id;
+    float *x, *y;                    /* position: read, and write to move */
+    const float *targetX, *targetY;  /* last commanded position (cursor/add or cursor/update x,y) */
+    float *const *params;            /* params[k][i], k in schema order */
+    uint32_t paramCount;
+} SwarmBehaviorSpan;
+
+typedef void (*SwarmBehaviorUpdateFn)(void *user, const SwarmBehaviorSpan *span, float dt, float systemX, float systemY);
+
+typedef struct SwarmBehaviorDesc {
+    uint32_t structSize;          /* sizeof(SwarmBehaviorDesc) */
+    const char *name;             /* [A-Za-z0-9_-], addressed as "plugin:<name>" */
+    const SwarmParamDesc *params;
+    uint32_t paramCount;          /* <= SWARM_PLUGIN_MAX_PARAMS */
+    SwarmBehaviorUpdateFn update;
+    void *user;                   /* passed back to update */
+} SwarmBehaviorDesc;
+
+typedef struct SwarmHost {
+    uint32_t apiVersion;          /* SWARM_PLUGIN_API_VERSION of the overlay */
+    void *context;
+    /* 0 on success. The host copies desc and its params, so both may be temporaries. */
+    int (*registerBehavior)(void *context, const SwarmBehaviorDesc *desc);
+    void (*log)(void *context, const char *msg);
+} SwarmHost;
+
+/* Required export "SwarmPluginInit": return 0 to stay loaded; nonzero unloads the DLL and drops its behaviors. */
+typedef int (*SwarmPluginInitFn)(const SwarmHost *host);
+/* Optional export "SwarmPluginShutdown": called once at exit, after the last update. */
+typedef void (*SwarmPluginShutdownFn)(void);
+
+#ifdef __cplusplus
+}
+#endif
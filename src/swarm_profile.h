@@ -0,0 +1,111 @@
+// Swarm profiling counters: lock-free log-linear latency histograms + scoped timers
+// Each Histogram is a fixed array of relaxed atomic counters (HdrHistogram-style buckets: every power of
+// two splits into kSub linear buckets, so any recorded value is reported within ~6%). Recording is one
+// fetch_add plus a max CAS; readers (sys/perf) scan the buckets without stopping writers.
+// No <windows.h>: steady_clock is QueryPerformanceCounter on Windows.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace swarm_prof {
+
+static inline int Msb(uint64_t v) { // v != 0
+    int n = 0;
+    if(v >> 32) { v >>= 32; n += 32; }
+    if(v >> 16) { v >>= 16; n += 16; }
+    if(v >> 8) { v >>= 8; n += 8; }
+    if(v >> 4) { v >>= 4; n += 4; }
+    if(v >> 2) { v >>= 2; n += 2; }
+    if(v >> 1) n += 1;
+    return n;
+}
+
+class Histogram {
+public:
+    static constexpr int kSubBits = 4, kSub = 1 << kSubBits;
+    static constexpr int kBuckets = (64 - kSubBits + 1) * kSub;
+
+    static int BucketOf(uint64_t v) {
+        if(v < (uint64_t)kSub) return (int)v;
+        int m = Msb(v);
+        return (m - kSubBits + 1) * kSub + (int)((v >> (m - kSubBits)) & (kSub - 1));
+    }
+    // Largest value that lands in bucket b (what percentiles report)
+    static uint64_t BucketHigh(int b) {
+        if(b < kSub) return (uint64_t)b;
+        int m = b / kSub - 1 + kSubBits, sub = b % kSub;
+        uint64_t width = uint64_t(1) << (m - kSubBits);
+        return (uint64_t(kSub + sub) << (m - kSubBits)) + width - 1;
+    }
+
+    void record(uint64_t v) {
+        counts[BucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        uint64_t m = maxV.load(std::memory_order_relaxed);
+        while(v > m && !maxV.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+    }
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return maxV.load(std::memory_order_relaxed); }
+    // q in [0,1]; 0 when empty. Concurrent records may be half-counted, which only shifts the result by one sample.
+    uint64_t percentile(double q) const {
+        uint64_t n = count();
+        if(!n) return 0;
+        uint64_t rank = (uint64_t)(q * (double)(n - 1)) + 1, seen = 0;
+        for(int b = 0; b < kBuckets; b++) {
+            seen += counts[b].load(std::memory_order_relaxed);
+            if(seen >= rank) { uint64_t hi = BucketHigh(b), mx = max(); return hi < mx ? hi : mx; }
+        }
+        return max();
+    }
+    // Not atomic as a whole: samples recorded during a reset may survive it
+    void reset() {
+        for(auto &c : counts) c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        maxV.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> counts[kBuckets] {};
+    std::atomic<uint64_t> total {0}, maxV {0};
+};
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t ElapsedNs(Clock::time_point t0) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+}
+
+// Records the enclosing scope's duration (ns) into h
+class ScopedTimer {
+    Histogram &h;
+    Clock::time_point t0;
+public:
+    explicit ScopedTimer(Histogram &hist) : h(hist), t0(Clock::now()) {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer &operator=(const ScopedTimer&) = delete;
+    ~ScopedTimer() { h.record(ElapsedNs(t0)); }
+};
+
+// lock_guard that records how long acquiring the mutex took (ns) into h
+template<class Mutex>
+class TimedLock {
+    Mutex &m;
+    uint64_t waited {0};
+public:
+    TimedLock(Mutex &mtx, Histogram &h) : m(mtx) {
+        if(m.try_lock()) { h.record(0); return; } // uncontended: skip the clock reads
+        Clock::time_point t0 = Clock::now();
+        m.lock();
+        waited = ElapsedNs(t0);
+        h.record(waited);
+    }
+    uint64_t waitedNs() const { return waited; }
+    TimedLock(const TimedLock&) = delete;
+    TimedLock &operator=(const TimedLock&) = delete;
+    ~TimedLock() { m.unlock(); }
+};
+
+} // namespace swarm_prof
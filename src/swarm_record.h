@@ -0,0 +1,293 @@
+// Swarm motion recording format (record/start, play/start)
+// A recording is the render snapshot of every frame as compact deltas against the previous frame, with a
+// full keyframe every kKeyInterval frames so playback can seek without decoding from the start.
+//
+// Byte layout (little endian; varint = LEB128, zz = zig-zag varint):
+//   Header (16 bytes): magic "SWRC", version u32, keyInterval u32, tickUs u32 (time unit)
+//   Blocks: tag u8, varint payload length, payload
+//     'K' keyframe: varint frame, varint time (ticks since start), varint n, n x
+//                   [zz id delta, zz x, zz y, varint size, u24 color]            every cursor, ids ascending
+//     'D' delta:    varint frame delta, varint time delta, varint n, n x
+//                   [zz id delta, u8 flags, (pos) zz dx zz dy, (color) u24, (size) varint]   changed ids ascending
+//                   flags: kPos/kColor/kSize/kGone; a cursor new since the last frame sends all three
+//     'I' index:    n x [u64 block offset, u64 time] of every keyframe (written by stop)
+//   Trailer (16 bytes, after 'I'): u64 index block offset, magic "SWRI", u32 keyframe count
+// A file whose trailer is missing (the recorder died) still plays: the reader rebuilds the index by
+// walking block lengths and stops at the first truncated block.
+// No <windows.h>: the format builds anywhere; main.cpp owns the file and the mapping.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace swarm_rec {
+
+static const uint32_t kMagic = 0x43525753;        // "SWRC"
+static const uint32_t kIndexMagic = 0x49525753;   // "SWRI"
+static const uint32_t kVersion = 1;
+static const uint32_t kKeyInterval = 300;         // frames between keyframes (5 s at 60 Hz)
+static const uint32_t kTickUs = 100;              // time unit
+static const size_t kHeaderSize = 16, kTrailerSize = 16;
+enum Flags : uint8_t { kPos = 1, kColor = 2, kSize = 4, kGone = 8 };
+
+struct Cursor { int32_t id, x, y, size; uint32_t color; };
+inline bool operator<(const Cursor &a, const Cursor &b) { return a.id < b.id; }
+
+// ---- primitives ----
+inline void PutVar(std::string &o, uint64_t v) {
+    while(v >= 0x80) { o.push_back((char)(uint8_t)(v | 0x80)); v >>= 7; }
+    o.push_back((char)(uint8_t)v);
+}
+inline void PutZz(std::string &o, int64_t v) { PutVar(o, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+inline void PutU24(std::string &o, uint32_t v) { o.push_back((char)(v & 0xFF)); o.push_back((char)((v >> 8) & 0xFF)); o.push_back((char)((v >> 16) & 0xFF)); }
+inline void PutU32(std::string &o, uint32_t v) { for(int i=0;i<4;i++) o.push_back((char)((v >> (8*i)) & 0xFF)); }
+inline void PutU64(std::string &o, uint64_t v) { for(int i=0;i<8;i++) o.push_back((char)((v >> (8*i)) & 0xFF)); }
+
+// Bounds-checked cursor over a byte range; any read past the end sets bad and returns 0
+struct In {
+    const uint8_t *p, *end;
+    bool bad {false};
+    uint64_t var() {
+        uint64_t v = 0;
+        for(int s=0; s<64; s+=7) {
+            if(p >= end) { bad = true; return 0; }
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7F) << s;
+            if(!(b & 0x80)) return v;
+        }
+        bad = true; return 0;
+    }
+    int64_t zz() { uint64_t v = var(); return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+    uint8_t u8() { if(p >= end) { bad = true; return 0; } return *p++; }
+    uint32_t u24() { uint32_t v = u8(); v |= (uint32_t)u8() << 8; v |= (uint32_t)u8() << 16; return v; }
+    uint64_t fixed(int bytes) { uint64_t v = 0; for(int i=0;i<bytes;i++) v |= (uint64_t)u8() << (8*i); return v; }
+};
+
+// ---- encoder: frame() per published snapshot, bytes appended to out for the caller to write ----
+class Writer {
+    std::unordered_map<int32_t, Cursor> last; // as of the previous frame
+    std::vector<Cursor> cur;
+    std::vector<std::pair<Cursor, uint8_t>> changes;
+    std::string payload;
+    uint64_t prevFrame {0}, prevTime {0}, frames {0};
+public:
+    struct Key { uint64_t offset, time; };
+    std::vector<Key> keys;
+    uint64_t offset {0}; // bytes emitted so far (block offsets in the index)
+
+    void begin(std::string &out) {
+        last.clear(); keys.clear(); frames = 0; offset = 0;
+        PutU32(out, kMagic); PutU32(out, kVersion); PutU32(out, kKeyInterval); PutU32(out, kTickUs);
+        offset = out.size();
+    }
+    uint64_t frameCount() const { return frames; }
+    // cursors: the frame's snapshot in any order (sorted here); time in ticks since start
+    template<class Records> void frame(uint64_t frameNo, uint64_t time, const Records &records, std::string &out) {
+        cur.clear();
+        for(const auto &r : records) cur.push_back(Cursor{ r.id, (int32_t)r.pos.x, (int32_t)r.pos.y, r.size, (uint32_t)r.color & 0xFFFFFF });
+        std::sort(cur.begin(), cur.end());
+        bool key = frames % kKeyInterval == 0;
+        payload.clear(); changes.clear();
+        if(key) {
+            last.clear();
+            PutVar(payload, frameNo); PutVar(payload, time); PutVar(payload, cur.size());
+            int32_t prevId = 0;
+            for(const Cursor &c : cur) {
+                PutZz(payload, (int64_t)c.id - prevId); PutZz(payload, c.x); PutZz(payload, c.y); PutVar(payload, (uint32_t)c.size); PutU24(payload, c.color);
+                prevId = c.id;
+            }
+        } else {
+            for(const Cursor &c : cur) {
+                auto it = last.find(c.id);
+                if(it == last.end()) { changes.emplace_back(c, (uint8_t)(kPos | kColor | kSize)); continue; }
+                const Cursor &o = it->second;
+                uint8_t f = (uint8_t)((c.x != o.x || c.y != o.y ? kPos : 0) | (c.color != o.color ? kColor : 0) | (c.size != o.size ? kSize : 0));
+                if(f) changes.emplace_back(c, f);
+            }
+            for(const auto &kv : last)
+                if(!std::binary_search(cur.begin(), cur.end(), Cursor{ kv.first, 0, 0, 0, 0 })) changes.emplace_back(kv.second, (uint8_t)kGone);
+            std::sort(changes.begin(), changes.end(), [](const std::pair<Cursor, uint8_t> &a, const std::pair<Cursor, uint8_t> &b) { return a.first.id < b.first.id; });
+            PutVar(payload, frameNo - prevFrame); PutVar(payload, time - prevTime); PutVar(payload, changes.size());
+            int32_t prevId = 0;
+            for(const auto &ch : changes) {
+                const Cursor &c = ch.first; uint8_t f = ch.second;
+                PutZz(payload, (int64_t)c.id - prevId); payload.push_back((char)f);
+                prevId = c.id;
+                if(f & kGone) continue;
+                auto it = last.find(c.id);
+                int32_t ox = it == last.end() ? 0 : it->second.x, oy = it == last.end() ? 0 : it->second.y;
+                if(f & kPos) { PutZz(payload, (int64_t)c.x - ox); PutZz(payload, (int64_t)c.y - oy); }
+                if(f & kColor) PutU24(payload, c.color);
+                if(f & kSize) PutVar(payload, (uint32_t)c.size);
+            }
+        }
+        for(const auto &ch : changes) if(ch.second & kGone) last.erase(ch.first.id);
+        for(const Cursor &c : cur) last[c.id] = c;
+        if(key) keys.push_back(Key{ offset, time });
+        size_t before = out.size();
+        out.push_back(key ? 'K' : 'D'); PutVar(out, payload.size()); out += payload;
+        offset += out.size() - before;
+        prevFrame = frameNo; prevTime = time; frames++;
+    }
+    // Index block + trailer; the recording is complete after this
+    void finish(std::string &out) {
+        uint64_t at = offset;
+        size_t before = out.size();
+        out.push_back('I'); PutVar(out, keys.size() * 16);
+        for(const Key &k : keys) { PutU64(out, k.offset); PutU64(out, k.time); }
+        PutU64(out, at); PutU32(out, kIndexMagic); PutU32(out, (uint32_t)keys.size());
+        offset += out.size() - before;
+    }
+};
+
+// ---- decoder over a mapped file; state is the set of cursors as of the last decoded frame ----
+class Reader {
+    const uint8_t *base {nullptr};
+    size_t size {0}, pos {0};
+    uint64_t frameNo {0}, time {0};
+public:
+    struct Key { uint64_t offset, time; };
+    struct Change { Cursor c; uint8_t flags; }; // absolute values; flags as in the block (keyframes: all + key)
+    std::vector<Key> keys;
+    std::unordered_map<int32_t, Cursor> state;
+    std::vector<Change> changes; // of the last next()
+    bool indexed {false};        // trailer was present (else the index was rebuilt by a scan)
+    uint64_t duration {0};       // ticks of the last keyframe or frame seen while indexing
+
+    bool open(const uint8_t *data, size_t n, std::string &err) {
+        base = data; size = n; keys.clear(); state.clear(); indexed = false; duration = 0;
+        In h { data, data + std::min(n, kHeaderSize) };
+        if(n < kHeaderSize || h.fixed(4) != kMagic) { err = "not a swarm recording"; return false; }
+        if(h.fixed(4) != kVersion) { err = "unsupported recording version"; return false; }
+        h.fixed(4); // keyInterval
+        if(h.fixed(4) != kTickUs) { err = "unsupported time unit"; return false; }
+        if(n >= kHeaderSize + kTrailerSize) {
+            In t { data + n - kTrailerSize, data + n };
+            uint64_t at = t.fixed(8); uint32_t magic = (uint32_t)t.fixed(4), count = (uint32_t)t.fixed(4);
+            if(magic == kIndexMagic && at < n) {
+                In ix { data + at, data + n - kTrailerSize };
+                if(ix.u8() == 'I' && ix.var() == (uint64_t)count * 16) {
+                    for(uint32_t i=0;i<count && !ix.bad;i++) { uint64_t o = ix.fixed(8), tm = ix.fixed(8); keys.push_back(Key{ o, tm }); }
+                    if(!ix.bad && validKeys(at)) { indexed = true; size = at; }
+                    else keys.clear(); // damaged index: rebuilt by scan()
+                }
+            }
+        }
+        if(!indexed) scan();
+        if(keys.empty()) { err = "recording has no frames"; return false; }
+        if(indexed) duration = lastTime(keys.back().offset);
+        return seek(0);
+    }
+    // Positions decoding at the last keyframe at or before t; the next next() returns that keyframe
+    bool seek(uint64_t t) {
+        size_t k = 0;
+        while(k + 1 < keys.size() && keys[k + 1].time <= t) k++;
+        pos = (size_t)keys[k].offset;
+        state.clear();
+        return true;
+    }
+    // Time of the block at pos without consuming it; false at the end
+    bool peekTime(uint64_t &t) const {
+        In in { base + pos, base + size };
+        uint8_t tag = in.u8(); uint64_t len = in.var();
+        if(in.bad || (tag != 'K' && tag != 'D') || len > (uint64_t)(in.end - in.p)) return false;
+        In pl { in.p, in.p + len };
+        if(tag == 'K') { pl.var(); t = pl.var(); }
+        else { pl.var(); t = time + pl.var(); }
+        return !pl.bad;
+    }
+    // Decodes one block into changes and state; false at the end or on a malformed block
+    bool next(bool &key) {
+        In in { base + pos, base + size };
+        uint8_t tag = in.u8(); uint64_t len = in.var();
+        if(in.bad || (tag != 'K' && tag != 'D') || len > (uint64_t)(in.end - in.p)) return false;
+        In pl { in.p, in.p + len };
+        key = tag == 'K';
+        changes.clear();
+        if(key) {
+            frameNo = pl.var(); time = pl.var();
+            uint64_t n = pl.var();
+            state.clear();
+            int32_t id = 0;
+            for(uint64_t i=0;i<n && !pl.bad;i++) {
+                Cursor c; c.id = id = (int32_t)(id + pl.zz()); c.x = (int32_t)pl.zz(); c.y = (int32_t)pl.zz(); c.size = (int32_t)pl.var(); c.color = pl.u24();
+                state[c.id] = c; changes.push_back(Change{ c, (uint8_t)(kPos | kColor | kSize) });
+            }
+        } else {
+            frameNo += pl.var(); time += pl.var();
+            uint64_t n = pl.var();
+            int32_t id = 0;
+            for(uint64_t i=0;i<n && !pl.bad;i++) {
+                id = (int32_t)(id + pl.zz());
+                uint8_t f = pl.u8();
+                if(f & kGone) {
+                    auto it = state.find(id);
+                    if(it != state.end()) { changes.push_back(Change{ it->second, f }); state.erase(it); }
+                    continue;
+                }
+                auto ins = state.try_emplace(id, Cursor{ id, 0, 0, 0, 0 });
+                Cursor &c = ins.first->second;
+                if(f & kPos) { c.x = (int32_t)(c.x + pl.zz()); c.y = (int32_t)(c.y + pl.zz()); }
+                if(f & kColor) c.color = pl.u24();
+                if(f & kSize) c.size = (int32_t)pl.var();
+                changes.push_back(Change{ c, f });
+            }
+        }
+        if(pl.bad) return false;
+        pos = (size_t)(pl.end - base);
+        return true;
+    }
+    uint64_t frame() const { return frameNo; }
+    uint64_t now() const { return time; }
+
+private:
+    // Index entries must be increasing offsets of 'K' blocks before the index, with non-decreasing times
+    bool validKeys(uint64_t end) const {
+        uint64_t prevOff = 0, prevTime = 0;
+        for(size_t k=0;k<keys.size();k++) {
+            const Key &e = keys[k];
+            if(e.offset < kHeaderSize || e.offset >= end || (k && (e.offset <= prevOff || e.time < prevTime))) return false;
+            if(base[e.offset] != 'K') return false;
+            prevOff = e.offset; prevTime = e.time;
+        }
+        return true;
+    }
+    // Rebuild the keyframe index from block lengths (no trailer); stops at the first truncated block
+    void scan() {
+        In in { base + kHeaderSize, base + size };
+        uint64_t t = 0;
+        while(in.p < in.end) {
+            const uint8_t *at = in.p;
+            uint8_t tag = in.u8(); uint64_t len = in.var();
+            if(in.bad || (tag != 'K' && tag != 'D') || len > (uint64_t)(in.end - in.p)) break;
+            In pl { in.p, in.p + len };
+            pl.var(); uint64_t tm = pl.var();
+            t = tag == 'K' ? tm : t + tm;
+            if(tag == 'K') keys.push_back(Key{ (uint64_t)(at - base), t });
+            in.p += len;
+            size = (size_t)(in.p - base);
+        }
+        if(!keys.empty() && size < (size_t)keys[0].offset) size = (size_t)keys[0].offset;
+        duration = t;
+    }
+    // Time of the last block, walking from the last keyframe
+    uint64_t lastTime(uint64_t from) const {
+        In in { base + from, base + size };
+        uint64_t t = 0;
+        while(in.p < in.end) {
+            uint8_t tag = in.u8(); uint64_t len = in.var();
+            if(in.bad || len > (uint64_t)(in.end - in.p)) break;
+            In pl { in.p, in.p + len };
+            pl.var(); uint64_t tm = pl.var();
+            t = tag == 'K' ? tm : t + tm;
+            in.p += len;
+        }
+        return t;
+    }
+};
+
+} // namespace swarm_rec
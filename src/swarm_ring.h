@@ -0,0 +1,159 @@
+// Swarm shared-memory command ring (layout + producer client)
+// One named file mapping holds kProducers single-producer/single-consumer rings of fixed-size binary
+// records (pos / color / add / remove). A producer claims a free ring once, then each push is a
+// plain memory write plus one release store of head: no syscalls per update. The overlay's update
+// thread drains every ring once per frame.
+//
+// Fixed byte layout (little endian, for DllCall/NumPut producers such as ahk/swarm_ring.ahk):
+//   0    Header (64 bytes): magic, version, producers, capacity, recordSize, ringStride, firstRing
+//   64   ring[i] at firstRing + i*ringStride:
+//          +0   owner pid   (u32, 0 = free; claim while holding the kClaimMutexName mutex)
+//          +64  head        (u32, producer-written record count)
+//          +128 tail        (u32, consumer-written record count)
+//          +192 dropped     (u32, producer-written: pushes rejected because the ring was full)
+//          +256 records[capacity], 24 bytes each: type u16, behavior u16, id i32, x i32, y i32, color u32, size i32
+//
+// The same Record also travels over SwarmPipe in binary framing mode: a client that writes kPipeMagic
+// as its first four bytes then sends frames of [u32 length][u8 kind][length-1 payload bytes].
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace swarm_ring {
+
+static const wchar_t kMappingName[] = L"Local\\SwarmRing";
+static const wchar_t kClaimMutexName[] = L"Local\\SwarmRingClaim"; // serializes producers picking a free ring
+static const uint32_t kMagic = 0x42525753; // "SWRB"
+static const uint32_t kVersion = 1;
+static const uint32_t kProducers = 8;
+static const uint32_t kCapacity = 4096; // records per ring, power of two
+
+enum RecordType : uint16_t { kPos = 1, kColor = 2, kAdd = 3, kRemove = 4 };
+
+struct Record {
+    uint16_t type;
+    uint16_t behavior; // add: 0 mirror, 1 static, 2 orbit, 3 follow, 4 script (not via the ring), 5 flock
+    int32_t id;        // add: 0 = allocate
+    int32_t x, y;      // pos; add: mirror offset, otherwise target / initial position
+    uint32_t color;    // 0x00RRGGBB (color, add)
+    int32_t size;      // add: glyph height, 0 = default
+};
+static_assert(sizeof(Record) == 24, "ring record layout is part of the protocol");
+
+struct alignas(64) Counter {
+    std::atomic<uint32_t> v;
+    char pad[64 - sizeof(std::atomic<uint32_t>)];
+};
+static_assert(sizeof(std::atomic<uint32_t>) == 4, "u32 counters must map 1:1 onto shared memory");
+
+struct Ring {
+    Counter owner, head, tail, dropped;
+    Record records[kCapacity];
+};
+
+struct alignas(64) Header {
+    uint32_t magic, version, producers, capacity, recordSize, ringStride, firstRing;
+};
+
+struct Shared {
+    Header hdr;
+    Ring rings[kProducers];
+};
+static_assert(sizeof(Header) == 64, "header layout");
+static_assert(offsetof(Ring, head) == 64 && offsetof(Ring, tail) == 128 && offsetof(Ring, dropped) == 192, "ring control layout");
+static_assert(offsetof(Ring, records) == 256, "ring record offset");
+static_assert(offsetof(Shared, rings) == 64 && sizeof(Ring) % 64 == 0, "ring array layout");
+
+// ---- SwarmPipe binary framing ----
+static const char kPipeMagic[4] = { 'S', 'W', 'B', '1' };
+enum FrameKind : uint8_t {
+    kFrameCommand = 1, // payload: one JSON command line (batch envelopes included)
+    kFrameRecords = 2, // payload: Record[n], applied under one lock like a ring drain
+};
+static const uint32_t kMaxFrameBytes = 1u << 20; // length field includes the kind byte
+
+// Append one frame to out (encoder for clients)
+inline void AppendFrame(std::string &out, FrameKind kind, const void *payload, uint32_t n) {
+    uint32_t len = n + 1;
+    out.append(reinterpret_cast<const char*>(&len), 4);
+    out.push_back((char)kind);
+    out.append(static_cast<const char*>(payload), n);
+}
+
+inline void InitHeader(Header &h) {
+    h.magic = kMagic; h.version = kVersion; h.producers = kProducers; h.capacity = kCapacity;
+    h.recordSize = sizeof(Record); h.ringStride = sizeof(Ring); h.firstRing = offsetof(Shared, rings);
+}
+inline bool HeaderValid(const Header &h) {
+    return h.magic==kMagic && h.version==kVersion && h.producers==kProducers && h.capacity==kCapacity
+        && h.recordSize==sizeof(Record) && h.ringStride==sizeof(Ring);
+}
+
+// Producer side: open the overlay's mapping, claim one ring, push records. Not thread-safe; use one
+// Producer per producing thread.
+class Producer {
+    HANDLE mapping {nullptr};
+    Shared *shm {nullptr};
+    Ring *ring {nullptr};
+    uint32_t head {0}, tailCache {0};
+public:
+    Producer() = default;
+    Producer(const Producer&) = delete;
+    Producer &operator=(const Producer&) = delete;
+    ~Producer() { close(); }
+
+    // False if the overlay is not running, the layout differs, or all rings are claimed
+    bool open() {
+        close();
+        mapping = OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, kMappingName);
+        if(!mapping) return false;
+        shm = static_cast<Shared*>(MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(Shared)));
+        if(!shm || !HeaderValid(shm->hdr)) { close(); return false; }
+        // Named mutex rather than a CAS so DllCall producers (no interlocked export on x64) can claim too;
+        // the overlay only ever resets owners of dead processes, never writes a free slot
+        HANDLE claim = CreateMutexW(nullptr, FALSE, kClaimMutexName);
+        if(claim && WaitForSingleObject(claim, 1000) != WAIT_TIMEOUT) {
+            for(uint32_t i=0;i<kProducers;i++) {
+                if(shm->rings[i].owner.v.load(std::memory_order_acquire)==0) {
+                    shm->rings[i].owner.v.store(GetCurrentProcessId(), std::memory_order_release);
+                    ring = &shm->rings[i];
+                    break;
+                }
+            }
+            ReleaseMutex(claim);
+        }
+        if(claim) CloseHandle(claim);
+        if(!ring) { close(); return false; }
+        head = ring->head.v.load(std::memory_order_relaxed);
+        tailCache = ring->tail.v.load(std::memory_order_acquire);
+        return true;
+    }
+    void close() {
+        if(ring) { ring->owner.v.store(0, std::memory_order_release); ring = nullptr; }
+        if(shm) { UnmapViewOfFile(shm); shm = nullptr; }
+        if(mapping) { CloseHandle(mapping); mapping = nullptr; }
+    }
+    bool isOpen() const { return ring != nullptr; }
+
+    // False (and dropped++) when the overlay has not drained kCapacity earlier records yet
+    bool push(const Record &r) {
+        if(!ring) return false;
+        if(head - tailCache >= kCapacity) {
+            tailCache = ring->tail.v.load(std::memory_order_acquire);
+            if(head - tailCache >= kCapacity) { ring->dropped.v.fetch_add(1, std::memory_order_relaxed); return false; }
+        }
+        ring->records[head & (kCapacity - 1)] = r;
+        ring->head.v.store(++head, std::memory_order_release);
+        return true;
+    }
+    bool pos(int id, int x, int y) { return push(Record{ kPos, 0, id, x, y, 0, 0 }); }
+    bool color(int id, uint32_t rgb) { return push(Record{ kColor, 0, id, 0, 0, rgb, 0 }); }
+    bool add(int id, uint16_t behavior, int x, int y, uint32_t rgb, int size) { return push(Record{ kAdd, behavior, id, x, y, rgb, size }); }
+    bool remove(int id) { return push(Record{ kRemove, 0, id, 0, 0, 0, 0 }); }
+};
+
+} // namespace swarm_ring
@@ -0,0 +1,254 @@
+// Swarm SIMD behavior kernels
+// Batch updates over structure-of-arrays cursor lanes (see CursorLane in main.cpp).
+// Each kernel has an AVX2 (8 wide), SSE2 (4 wide) and scalar body; the widest one the CPU
+// supports is picked once at first use. Pure float math, no Windows dependencies.
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define SWARM_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SWARM_SSE2_FN
+#define SWARM_AVX2_FN
+#else
+#define SWARM_SSE2_FN __attribute__((target("sse2")))
+#define SWARM_AVX2_FN __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace swarm_simd {
+
+enum class Isa { Scalar, Sse2, Avx2 };
+
+static const float kPi = 3.14159265358979f;
+static const float kTwoPi = 6.28318530717959f;
+
+// Keep an accumulated angle in [-pi, pi] so float sin/cos stay accurate. Subtracts at most one period
+// (as do the SSE2/AVX2 kernels), so a must lie in [-3pi, 3pi]: stored angles are in range because
+// CursorLane::push reduces them with std::remainder first, and one orbit step (speed * dt) has to stay
+// under 2pi. A larger step leaves the angle outside [-pi, pi] and it keeps drifting.
+inline float WrapAngle(float a) {
+    if(a > kPi) a -= kTwoPi; else if(a < -kPi) a += kTwoPi;
+    return a;
+}
+inline float FollowAlpha(float dt, float lagMs) {
+    float a = dt * 1000.0f / (lagMs > 1.0f ? lagMs : 1.0f); // proportion per frame
+    return a > 1.0f ? 1.0f : a;
+}
+
+// ---------------- scalar reference ----------------
+inline void MirrorScalar(float *x, float *y, const float *ox, const float *oy, size_t n, float sx, float sy) {
+    for(size_t i=0;i<n;i++) { x[i] = sx + ox[i]; y[i] = sy + oy[i]; }
+}
+inline void OrbitScalar(float *angle, const float *speed, const float *radius, float *x, float *y, size_t n, float dt, float sx, float sy) {
+    for(size_t i=0;i<n;i++) {
+        float a = WrapAngle(angle[i] + speed[i] * dt);
+        angle[i] = a;
+        x[i] = sx + std::cos(a) * radius[i];
+        y[i] = sy + std::sin(a) * radius[i];
+    }
+}
+inline void FollowScalar(float *x, float *y, const float *lagMs, size_t n, float dt, float sx, float sy) {
+    for(size_t i=0;i<n;i++) {
+        float a = FollowAlpha(dt, lagMs[i]);
+        x[i] += (sx - x[i]) * a;
+        y[i] += (sy - y[i]) * a;
+    }
+}
+
+#ifdef SWARM_SIMD_X86
+// Cephes-style sincos: octant reduction + minimax polynomials, ~1e-7 abs error on [-pi, pi]
+#define SWARM_SINCOS_CONSTANTS \
+    const float kFourOverPi = 1.27323954473516f; \
+    const float kDP1 = -0.78515625f, kDP2 = -2.4187564849853515625e-4f, kDP3 = -3.77489497744594108e-8f; \
+    const float kS0 = -1.9515295891e-4f, kS1 = 8.3321608736e-3f, kS2 = -1.6666654611e-1f; \
+    const float kC0 = 2.443315711809948e-5f, kC1 = -1.388731625493765e-3f, kC2 = 4.166664568298827e-2f;
+
+SWARM_SSE2_FN inline void SinCos4(__m128 x, __m128 *s, __m128 *c) {
+    SWARM_SINCOS_CONSTANTS
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    __m128 signSin = _mm_and_ps(x, signMask);
+    x = _mm_andnot_ps(signMask, x);
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(kFourOverPi)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(j);
+    __m128 swapSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+    __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+    __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP1)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP2)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP3)));
+    signSin = _mm_xor_ps(signSin, swapSin);
+    __m128 z = _mm_mul_ps(x, x);
+    __m128 pc = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(kC0), z), _mm_set1_ps(kC1)), z), _mm_set1_ps(kC2));
+    pc = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(pc, z), z), _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+    __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(kS0), z), _mm_set1_ps(kS1)), z), _mm_set1_ps(kS2));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+    __m128 sinV = _mm_or_ps(_mm_and_ps(polyMask, ps), _mm_andnot_ps(polyMask, pc));
+    __m128 cosV = _mm_or_ps(_mm_and_ps(polyMask, pc), _mm_andnot_ps(polyMask, ps));
+    *s = _mm_xor_ps(sinV, signSin);
+    *c = _mm_xor_ps(cosV, signCos);
+}
+
+SWARM_AVX2_FN inline void SinCos8(__m256 x, __m256 *s, __m256 *c) {
+    SWARM_SINCOS_CONSTANTS
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    __m256 signSin = _mm256_and_ps(x, signMask);
+    x = _mm256_andnot_ps(signMask, x);
+    __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(kFourOverPi)));
+    j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+    __m256 y = _mm256_cvtepi32_ps(j);
+    __m256 swapSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29));
+    __m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+    __m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+    x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kDP1)));
+    x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kDP2)));
+    x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kDP3)));
+    signSin = _mm256_xor_ps(signSin, swapSin);
+    __m256 z = _mm256_mul_ps(x, x);
+    __m256 pc = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kC0), z), _mm256_set1_ps(kC1)), z), _mm256_set1_ps(kC2));
+    pc = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(pc, z), z), _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+    __m256 ps = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kS0), z), _mm256_set1_ps(kS1)), z), _mm256_set1_ps(kS2));
+    ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ps, z), x), x);
+    *s = _mm256_xor_ps(_mm256_blendv_ps(pc, ps, polyMask), signSin);
+    *c = _mm256_xor_ps(_mm256_blendv_ps(ps, pc, polyMask), signCos);
+}
+#undef SWARM_SINCOS_CONSTANTS
+
+// ---------------- SSE2 ----------------
+SWARM_SSE2_FN inline void MirrorSse2(float *x, float *y, const float *ox, const float *oy, size_t n, float sx, float sy) {
+    const __m128 vx = _mm_set1_ps(sx), vy = _mm_set1_ps(sy);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(x + i, _mm_add_ps(vx, _mm_loadu_ps(ox + i)));
+        _mm_storeu_ps(y + i, _mm_add_ps(vy, _mm_loadu_ps(oy + i)));
+    }
+    MirrorScalar(x + i, y + i, ox + i, oy + i, n - i, sx, sy);
+}
+SWARM_SSE2_FN inline void OrbitSse2(float *angle, const float *speed, const float *radius, float *x, float *y, size_t n, float dt, float sx, float sy) {
+    const __m128 vdt = _mm_set1_ps(dt), vx = _mm_set1_ps(sx), vy = _mm_set1_ps(sy);
+    const __m128 pi = _mm_set1_ps(kPi), npi = _mm_set1_ps(-kPi), twoPi = _mm_set1_ps(kTwoPi);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128 a = _mm_add_ps(_mm_loadu_ps(angle + i), _mm_mul_ps(_mm_loadu_ps(speed + i), vdt));
+        a = _mm_sub_ps(a, _mm_and_ps(_mm_cmpgt_ps(a, pi), twoPi));
+        a = _mm_add_ps(a, _mm_and_ps(_mm_cmplt_ps(a, npi), twoPi));
+        _mm_storeu_ps(angle + i, a);
+        __m128 s, c; SinCos4(a, &s, &c);
+        __m128 r = _mm_loadu_ps(radius + i);
+        _mm_storeu_ps(x + i, _mm_add_ps(vx, _mm_mul_ps(c, r)));
+        _mm_storeu_ps(y + i, _mm_add_ps(vy, _mm_mul_ps(s, r)));
+    }
+    OrbitScalar(angle + i, speed + i, radius + i, x + i, y + i, n - i, dt, sx, sy);
+}
+SWARM_SSE2_FN inline void FollowSse2(float *x, float *y, const float *lagMs, size_t n, float dt, float sx, float sy) {
+    const __m128 vms = _mm_set1_ps(dt * 1000.0f), one = _mm_set1_ps(1.0f), vx = _mm_set1_ps(sx), vy = _mm_set1_ps(sy);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128 a = _mm_min_ps(_mm_div_ps(vms, _mm_max_ps(_mm_loadu_ps(lagMs + i), one)), one);
+        __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i);
+        _mm_storeu_ps(x + i, _mm_add_ps(px, _mm_mul_ps(_mm_sub_ps(vx, px), a)));
+        _mm_storeu_ps(y + i, _mm_add_ps(py, _mm_mul_ps(_mm_sub_ps(vy, py), a)));
+    }
+    FollowScalar(x + i, y + i, lagMs + i, n - i, dt, sx, sy);
+}
+
+// ---------------- AVX2 ----------------
+SWARM_AVX2_FN inline void MirrorAvx2(float *x, float *y, const float *ox, const float *oy, size_t n, float sx, float sy) {
+    const __m256 vx = _mm256_set1_ps(sx), vy = _mm256_set1_ps(sy);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_add_ps(vx, _mm256_loadu_ps(ox + i)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(vy, _mm256_loadu_ps(oy + i)));
+    }
+    MirrorScalar(x + i, y + i, ox + i, oy + i, n - i, sx, sy);
+}
+SWARM_AVX2_FN inline void OrbitAvx2(float *angle, const float *speed, const float *radius, float *x, float *y, size_t n, float dt, float sx, float sy) {
+    const __m256 vdt = _mm256_set1_ps(dt), vx = _mm256_set1_ps(sx), vy = _mm256_set1_ps(sy);
+    const __m256 pi = _mm256_set1_ps(kPi), npi = _mm256_set1_ps(-kPi), twoPi = _mm256_set1_ps(kTwoPi);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_add_ps(_mm256_loadu_ps(angle + i), _mm256_mul_ps(_mm256_loadu_ps(speed + i), vdt));
+        a = _mm256_sub_ps(a, _mm256_and_ps(_mm256_cmp_ps(a, pi, _CMP_GT_OQ), twoPi));
+        a = _mm256_add_ps(a, _mm256_and_ps(_mm256_cmp_ps(a, npi, _CMP_LT_OQ), twoPi));
+        _mm256_storeu_ps(angle + i, a);
+        __m256 s, c; SinCos8(a, &s, &c);
+        __m256 r = _mm256_loadu_ps(radius + i);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(vx, _mm256_mul_ps(c, r)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(vy, _mm256_mul_ps(s, r)));
+    }
+    OrbitScalar(angle + i, speed + i, radius + i, x + i, y + i, n - i, dt, sx, sy);
+}
+SWARM_AVX2_FN inline void FollowAvx2(float *x, float *y, const float *lagMs, size_t n, float dt, float sx, float sy) {
+    const __m256 vms = _mm256_set1_ps(dt * 1000.0f), one = _mm256_set1_ps(1.0f), vx = _mm256_set1_ps(sx), vy = _mm256_set1_ps(sy);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_min_ps(_mm256_div_ps(vms, _mm256_max_ps(_mm256_loadu_ps(lagMs + i), one)), one);
+        __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(px, _mm256_mul_ps(_mm256_sub_ps(vx, px), a)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(py, _mm256_mul_ps(_mm256_sub_ps(vy, py), a)));
+    }
+    FollowScalar(x + i, y + i, lagMs + i, n - i, dt, sx, sy);
+}
+
+inline Isa DetectIsa() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    if(r[0] >= 7) {
+        __cpuid(r, 1);
+        bool osxsave = (r[2] & (1<<27)) != 0, avx = (r[2] & (1<<28)) != 0;
+        __cpuidex(r, 7, 0);
+        bool avx2 = (r[1] & (1<<5)) != 0;
+        if(osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) return Isa::Avx2; // OS saves YMM state
+    }
+#if defined(_M_X64)
+    return Isa::Sse2;
+#else
+    __cpuid(r, 1);
+    return (r[3] & (1<<26)) ? Isa::Sse2 : Isa::Scalar;
+#endif
+#else
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return Isa::Avx2;
+    return __builtin_cpu_supports("sse2") ? Isa::Sse2 : Isa::Scalar;
+#endif
+}
+#else
+inline Isa DetectIsa() { return Isa::Scalar; }
+#endif // SWARM_SIMD_X86
+
+// Selected kernel set (detected once; tests/bench may force a narrower one)
+inline Isa &ActiveIsa() { static Isa isa = DetectIsa(); return isa; }
+inline const char *IsaName(Isa isa) { return isa==Isa::Avx2 ? "avx2" : (isa==Isa::Sse2 ? "sse2" : "scalar"); }
+
+// x/y = systemPos + offset
+inline void MirrorStep(float *x, float *y, const float *ox, const float *oy, size_t n, float sx, float sy) {
+#ifdef SWARM_SIMD_X86
+    if(ActiveIsa()==Isa::Avx2) return MirrorAvx2(x, y, ox, oy, n, sx, sy);
+    if(ActiveIsa()==Isa::Sse2) return MirrorSse2(x, y, ox, oy, n, sx, sy);
+#endif
+    MirrorScalar(x, y, ox, oy, n, sx, sy);
+}
+// angle += speed*dt (wrapped); x/y = systemPos + (cos, sin)(angle) * radius
+inline void OrbitStep(float *angle, const float *speed, const float *radius, float *x, float *y, size_t n, float dt, float sx, float sy) {
+#ifdef SWARM_SIMD_X86
+    if(ActiveIsa()==Isa::Avx2) return OrbitAvx2(angle, speed, radius, x, y, n, dt, sx, sy);
+    if(ActiveIsa()==Isa::Sse2) return OrbitSse2(angle, speed, radius, x, y, n, dt, sx, sy);
+#endif
+    OrbitScalar(angle, speed, radius, x, y, n, dt, sx, sy);
+}
+// EMA toward systemPos with per-cursor time constant lagMs
+inline void FollowStep(float *x, float *y, const float *lagMs, size_t n, float dt, float sx, float sy) {
+#ifdef SWARM_SIMD_X86
+    if(ActiveIsa()==Isa::Avx2) return FollowAvx2(x, y, lagMs, n, dt, sx, sy);
+    if(ActiveIsa()==Isa::Sse2) return FollowSse2(x, y, lagMs, n, dt, sx, sy);
+#endif
+    FollowScalar(x, y, lagMs, n, dt, sx, sy);
+}
+
+} // namespace swarm_simd
@@ -0,0 +1,58 @@
+// Swarm ETW tracing (opt-in: cmake -DSWARM_TRACE_ETW=ON defines SWARM_TRACE_ETW=1)
+// TraceLogging provider "Swarm.Overlay". Its GUID is the standard name hash, so `PerfView /Providers=*Swarm.Overlay`
+// and `tracelog -guid *Swarm.Overlay` find it without a manifest. Events, all self-describing:
+//   Zone     start/stop pair (opcode) with Name - scoped hot paths, shown per thread in WPA Generic Events
+//   Thread   Name, once when a long-lived thread starts
+//   Frame    update-thread frame number, once per frame (correlate with Present / DWM in the same capture)
+//   LockWait Name + ns, only when acquiring the mutex actually blocked
+// With the option off every macro expands to nothing.
+#pragma once
+
+#if defined(SWARM_TRACE_ETW) && SWARM_TRACE_ETW
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+#include <cstdint>
+
+TRACELOGGING_DECLARE_PROVIDER(gSwarmTraceProvider);
+
+namespace swarm_trace {
+
+class Zone {
+    const char *name;
+public:
+    explicit Zone(const char *n) : name(n) {
+        TraceLoggingWrite(gSwarmTraceProvider, "Zone", TraceLoggingOpcode(WINEVENT_OPCODE_START), TraceLoggingString(name, "Name"));
+    }
+    Zone(const Zone&) = delete;
+    Zone &operator=(const Zone&) = delete;
+    ~Zone() { TraceLoggingWrite(gSwarmTraceProvider, "Zone", TraceLoggingOpcode(WINEVENT_OPCODE_STOP), TraceLoggingString(name, "Name")); }
+};
+
+} // namespace swarm_trace
+
+#define SWARM_TRACE_CAT2(a, b) a##b
+#define SWARM_TRACE_CAT(a, b) SWARM_TRACE_CAT2(a, b)
+// Exactly one translation unit: 9d184f5e-60f9-5457-b440-66403cb1e85c = ETW name hash of "Swarm.Overlay"
+#define SWARM_TRACE_DEFINE_PROVIDER() \
+    TRACELOGGING_DEFINE_PROVIDER(gSwarmTraceProvider, "Swarm.Overlay", \
+        (0x9d184f5e, 0x60f9, 0x5457, 0xb4, 0x40, 0x66, 0x40, 0x3c, 0xb1, 0xe8, 0x5c));
+#define SWARM_TRACE_REGISTER() TraceLoggingRegister(gSwarmTraceProvider)
+#define SWARM_TRACE_UNREGISTER() TraceLoggingUnregister(gSwarmTraceProvider)
+#define SWARM_TRACE_ZONE(name) ::swarm_trace::Zone SWARM_TRACE_CAT(swarmTraceZone_, __LINE__)(name)
+#define SWARM_TRACE_THREAD(name) TraceLoggingWrite(gSwarmTraceProvider, "Thread", TraceLoggingString(name, "Name"))
+#define SWARM_TRACE_FRAME(n) TraceLoggingWrite(gSwarmTraceProvider, "Frame", TraceLoggingUInt64((uint64_t)(n), "Frame"))
+#define SWARM_TRACE_LOCK_WAIT(name, ns) \
+    TraceLoggingWrite(gSwarmTraceProvider, "LockWait", TraceLoggingString(name, "Name"), TraceLoggingUInt64((uint64_t)(ns), "Ns"))
+
+#else
+
+#define SWARM_TRACE_DEFINE_PROVIDER()
+#define SWARM_TRACE_REGISTER() ((void)0)
+#define SWARM_TRACE_UNREGISTER() ((void)0)
+#define SWARM_TRACE_ZONE(name) ((void)0)
+#define SWARM_TRACE_THREAD(name) ((void)0)
+#define SWARM_TRACE_FRAME(n) ((void)0)
+#define SWARM_TRACE_LOCK_WAIT(name, ns) ((void)0)
+
+#endif
@@ -0,0 +1,395 @@
+// Lua-subset compiler (single pass, recursive descent straight to bytecode) and interpreter; see swarm_vm.h
+#include "swarm_vm.h"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace swarm_vm {
+
+namespace {
+
+enum Builtin : int32_t { kSin, kCos, kTan, kAsin, kAcos, kAtan, kAbs, kSqrt, kFloor, kCeil, kMin, kMax, kExp, kLog, kRandom, kClamp, kLerp, kBuiltinCount };
+struct BuiltinInfo { const char *name; int minArgs, maxArgs; };
+const BuiltinInfo kBuiltins[kBuiltinCount] = {
+    {"sin",1,1}, {"cos",1,1}, {"tan",1,1}, {"asin",1,1}, {"acos",1,1}, {"atan",1,2}, {"abs",1,1}, {"sqrt",1,1},
+    {"floor",1,1}, {"ceil",1,1}, {"min",1,8}, {"max",1,8}, {"exp",1,1}, {"log",1,1}, {"random",0,2}, {"clamp",3,3}, {"lerp",3,3}
+};
+
+inline double Random01(uint64_t &s) { // xorshift64
+    s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+    return (double)(s >> 11) * (1.0 / 9007199254740992.0);
+}
+
+struct Tok {
+    enum Kind { Eof, Num, Name, Sym } kind {Eof};
+    std::string_view text;
+    double num {0};
+    int line {1};
+};
+
+class Compiler {
+public:
+    Compiler(std::string_view s, Program &p) : src(s), prog(p) {}
+
+    bool run(std::string &err) {
+        prog = Program();
+        static const char *const kFixed[kFixedSlots] = { "dt", "mouse.x", "mouse.y", "x", "y", "t", "id" };
+        for(const char *n : kFixed) slotOf(n);
+        advance();
+        while(ok && tok.kind != Tok::Eof) statement(true);
+        emit(OpCode::Ret);
+        if(!ok) { err = "line " + std::to_string(errLine) + ": " + errMsg; return false; }
+        return true;
+    }
+
+private:
+    std::string_view src;
+    Program &prog;
+    size_t pos {0};
+    int line {1};
+    Tok tok;
+    bool ok {true};
+    int errLine {0};
+    std::string errMsg;
+    int depth {0}, maxDepth {0};
+    int blockNesting {0}, exprNesting {0}; // recursive descent depth, each bounded by kMaxNesting
+    bool inUpdate {false};
+    std::string_view dtName {"dt"}, mouseName {"mouse"};
+    std::unordered_map<std::string, int> slots;
+    std::vector<std::vector<size_t>> breaks; // per enclosing loop: jumps to patch at its exit
+    int hidden {0};
+
+    void fail(const std::string &m) { if(ok) { ok = false; errLine = tok.line; errMsg = m; } }
+    struct Nest { // one level of block() or subexpr() recursion
+        Compiler &c; int &n; bool in;
+        Nest(Compiler &cc, int &counter, const char *msg) : c(cc), n(counter), in(++counter <= kMaxNesting) { if(!in) c.fail(msg); }
+        ~Nest() { n--; }
+    };
+
+    // ---- lexer ----
+    void advance() {
+        for(;;) {
+            while(pos < src.size() && (src[pos]==' ' || src[pos]=='\t' || src[pos]=='\r' || src[pos]=='\n')) { if(src[pos]=='\n') line++; pos++; }
+            if(src.compare(pos, 2, "--") != 0) break;
+            while(pos < src.size() && src[pos] != '\n') pos++; // comment
+        }
+        tok = Tok(); tok.line = line;
+        if(pos >= src.size()) return;
+        size_t b = pos;
+        char c = src[pos];
+        if(isalpha((unsigned char)c) || c=='_') {
+            while(pos < src.size() && (isalnum((unsigned char)src[pos]) || src[pos]=='_')) pos++;
+            tok.kind = Tok::Name;
+        } else if(isdigit((unsigned char)c) || (c=='.' && pos+1 < src.size() && isdigit((unsigned char)src[pos+1]))) {
+            auto r = std::from_chars(src.data() + pos, src.data() + src.size(), tok.num);
+            if(r.ec != std::errc()) { tok.text = src.substr(b, 1); fail("bad number"); return; }
+            pos = (size_t)(r.ptr - src.data());
+            tok.kind = Tok::Num;
+        } else {
+            static const char *const kTwo[] = { "==", "~=", "!=", "<=", ">=" };
+            pos++;
+            for(const char *t : kTwo) if(src.compare(b, 2, t) == 0) { pos = b + 2; break; }
+            tok.kind = Tok::Sym;
+            if(pos == b + 1 && !strchr("+-*/%^<>=(),.;", c)) { tok.text = src.substr(b, 1); fail("unsupported character '" + std::string(1, c) + "'"); return; }
+        }
+        tok.text = src.substr(b, pos - b);
+    }
+    bool is(std::string_view t) const { return tok.kind != Tok::Eof && tok.kind != Tok::Num && tok.text == t; }
+    bool accept(std::string_view t) { if(!is(t)) return false; advance(); return true; }
+    std::string near() const { return tok.kind == Tok::Eof ? std::string("end of script") : "'" + std::string(tok.text) + "'"; }
+    void expect(std::string_view t) { if(!accept(t)) fail("expected '" + std::string(t) + "' near " + near()); }
+    static bool Keyword(std::string_view n) {
+        static const char *const kKeywords[] = { "and","break","do","else","elseif","end","false","for","function","if","in",
+            "local","nil","not","or","repeat","return","then","true","until","while" };
+        for(const char *k : kKeywords) if(n == k) return true;
+        return false;
+    }
+    std::string_view name() {
+        if(tok.kind != Tok::Name || Keyword(tok.text)) { fail("expected a name near " + near()); return {}; }
+        std::string_view n = tok.text; advance(); return n;
+    }
+
+    // ---- code ----
+    int slotOf(std::string_view n) {
+        auto it = slots.find(std::string(n));
+        if(it != slots.end()) return it->second;
+        int s = (int)prog.names.size();
+        prog.names.emplace_back(n);
+        slots.emplace(std::string(n), s);
+        return s;
+    }
+    // Stack effect of each op, for the compile-time depth bound
+    size_t emit(OpCode op, int32_t a = 0, int argc = 0) {
+        switch(op) {
+            case OpCode::Const: case OpCode::Load: depth++; break;
+            case OpCode::Store: case OpCode::Jz: case OpCode::AndJz: case OpCode::OrJnz:
+            case OpCode::Add: case OpCode::Sub: case OpCode::Mul: case OpCode::Div: case OpCode::Mod: case OpCode::Pow:
+            case OpCode::Eq: case OpCode::Ne: case OpCode::Lt: case OpCode::Le: case OpCode::Gt: case OpCode::Ge: depth--; break;
+            case OpCode::ForTest: depth -= 2; break;
+            case OpCode::Call: depth += 1 - argc; break;
+            default: break;
+        }
+        if(depth > maxDepth) { maxDepth = depth; if(maxDepth > kMaxStack) fail("expression too deep"); }
+        prog.code.push_back(Ins{ op, (uint8_t)argc, a });
+        return prog.code.size() - 1;
+    }
+    void constant(double v) {
+        size_t k = 0;
+        while(k < prog.consts.size() && !(prog.consts[k] == v && std::signbit(prog.consts[k]) == std::signbit(v))) k++;
+        if(k == prog.consts.size()) prog.consts.push_back(v);
+        emit(OpCode::Const, (int32_t)k);
+    }
+    void patch(size_t at) { prog.code[at].a = (int32_t)prog.code.size(); }
+    int32_t here() const { return (int32_t)prog.code.size(); }
+
+    // ---- statements ----
+    void block() { // until end / else / elseif (not consumed)
+        Nest nest(*this, blockNesting, "blocks nested too deeply");
+        if(!nest.in) return;
+        while(ok && tok.kind != Tok::Eof && !is("end") && !is("else") && !is("elseif")) statement(false);
+    }
+    void statement(bool topLevel) {
+        if(accept("if")) {
+            std::vector<size_t> exits;
+            expression(); expect("then");
+            size_t skip = emit(OpCode::Jz);
+            block();
+            while(ok && (is("elseif") || is("else"))) {
+                exits.push_back(emit(OpCode::Jmp));
+                patch(skip);
+                if(accept("elseif")) { expression(); expect("then"); skip = emit(OpCode::Jz); block(); }
+                else { advance(); block(); skip = SIZE_MAX; break; }
+            }
+            if(skip != SIZE_MAX) patch(skip);
+            expect("end");
+            for(size_t j : exits) patch(j);
+        } else if(accept("while")) {
+            int32_t top = here();
+            expression(); expect("do");
+            size_t exit = emit(OpCode::Jz);
+            loopBody(top);
+            patch(exit);
+            closeLoop();
+        } else if(accept("for")) {
+            int var = variable(name());
+            std::string tag = std::to_string(hidden++);
+            int limit = slotOf("(for limit " + tag + ")"), step = slotOf("(for step " + tag + ")");
+            if(is("in")) { fail("generic for is not supported"); return; }
+            expect("="); expression(); emit(OpCode::Store, var);
+            expect(","); expression(); emit(OpCode::Store, limit);
+            if(accept(",")) expression(); else constant(1);
+            emit(OpCode::Store, step);
+            expect("do");
+            int32_t top = here();
+            emit(OpCode::Load, var); emit(OpCode::Load, limit); emit(OpCode::Load, step); emit(OpCode::ForTest);
+            size_t exit = emit(OpCode::Jz);
+            breaks.emplace_back();
+            block(); expect("end");
+            emit(OpCode::Load, var); emit(OpCode::Load, step); emit(OpCode::Add); emit(OpCode::Store, var);
+            emit(OpCode::Jmp, top);
+            patch(exit);
+            closeLoop();
+        } else if(accept("function")) {
+            if(!topLevel || inUpdate) { fail("functions must be declared at the top level"); return; }
+            if(name() != "update" && ok) { fail("only function update(dt, mouse) is supported"); return; }
+            if(prog.updatePc >= 0) { fail("update is defined twice"); return; }
+            expect("(");
+            std::string_view params[2] = { "dt", "mouse" };
+            int n = 0;
+            if(!is(")")) do { if(n == 2) { fail("update takes (dt, mouse)"); return; } params[n++] = name(); } while(ok && accept(","));
+            expect(")");
+            size_t over = emit(OpCode::Jmp); // top level skips the body
+            prog.updatePc = here();
+            inUpdate = true; dtName = params[0]; mouseName = params[1];
+            block(); expect("end");
+            emit(OpCode::Ret);
+            inUpdate = false; dtName = "dt"; mouseName = "mouse";
+            patch(over);
+        } else if(accept("return")) {
+            emit(OpCode::Ret);
+            if(!is("end") && !is("else") && !is("elseif") && tok.kind != Tok::Eof) fail("return must end a block (return values are not supported)");
+        } else if(accept("break")) {
+            if(breaks.empty()) { fail("break outside a loop"); return; }
+            breaks.back().push_back(emit(OpCode::Jmp));
+        } else if(accept("local")) {
+            if(is("function")) { fail("local functions are not supported"); return; }
+            int s = variable(name());
+            if(accept("=")) expression(); else constant(0);
+            emit(OpCode::Store, s);
+        } else if(is("do")) {
+            advance(); block(); expect("end");
+        } else if(tok.kind == Tok::Name && !Keyword(tok.text)) {
+            std::string_view n = name();
+            if(is(".")) { fail("'" + std::string(n) + "' fields are read-only"); return; }
+            if(n == "math") { fail("math is read-only"); return; }
+            int s = variable(n);
+            expect("="); expression();
+            emit(OpCode::Store, s);
+        } else {
+            fail("unexpected " + near());
+            return;
+        }
+        accept(";");
+    }
+    void loopBody(int32_t top) {
+        breaks.emplace_back();
+        block(); expect("end");
+        emit(OpCode::Jmp, top);
+    }
+    void closeLoop() {
+        for(size_t j : breaks.back()) patch(j);
+        breaks.pop_back();
+    }
+    int variable(std::string_view n) {
+        if(inUpdate && n == dtName) return kSlotDt;
+        return slotOf(n);
+    }
+
+    // ---- expressions (Lua precedence) ----
+    void expression() { subexpr(0); }
+    struct BinOp { const char *text; int left, right; OpCode op; };
+    const BinOp *binop() const {
+        static const BinOp kOps[] = {
+            {"or",1,1,OpCode::OrJnz}, {"and",2,2,OpCode::AndJz},
+            {"==",3,3,OpCode::Eq}, {"~=",3,3,OpCode::Ne}, {"!=",3,3,OpCode::Ne}, {"<",3,3,OpCode::Lt}, {"<=",3,3,OpCode::Le}, {">",3,3,OpCode::Gt}, {">=",3,3,OpCode::Ge},
+            {"+",10,10,OpCode::Add}, {"-",10,10,OpCode::Sub}, {"*",11,11,OpCode::Mul}, {"/",11,11,OpCode::Div}, {"%",11,11,OpCode::Mod},
+            {"^",14,13,OpCode::Pow} // right associative, binds tighter than unary minus
+        };
+        if(tok.kind != Tok::Sym && tok.kind != Tok::Name) return nullptr;
+        for(const BinOp &b : kOps) if(tok.text == b.text) return &b;
+        return nullptr;
+    }
+    void subexpr(int limit) {
+        static const int kUnary = 12;
+        Nest nest(*this, exprNesting, "expression too deep");
+        if(!nest.in) return;
+        if(accept("not")) { subexpr(kUnary); emit(OpCode::Not); }
+        else if(accept("-")) { subexpr(kUnary); emit(OpCode::Neg); }
+        else primary();
+        while(ok) {
+            const BinOp *b = binop();
+            if(!b || b->left <= limit) break;
+            advance();
+            if(b->op == OpCode::AndJz || b->op == OpCode::OrJnz) {
+                size_t j = emit(b->op);
+                subexpr(b->right);
+                patch(j);
+            } else {
+                subexpr(b->right);
+                emit(b->op);
+            }
+        }
+    }
+    void primary() {
+        if(tok.kind == Tok::Num) { constant(tok.num); advance(); return; }
+        if(accept("true")) { constant(1); return; }
+        if(accept("false") || accept("nil")) { constant(0); return; }
+        if(accept("(")) { expression(); expect(")"); return; }
+        if(tok.kind != Tok::Name || Keyword(tok.text)) { fail("unexpected " + near()); return; }
+        std::string_view n = name();
+        if(n == "math") {
+            expect(".");
+            std::string_view f = name();
+            if(f == "pi") { constant(3.14159265358979323846); return; }
+            if(f == "huge") { constant(HUGE_VAL); return; }
+            int b = 0; while(b < kBuiltinCount && f != kBuiltins[b].name) b++;
+            if(b == kBuiltinCount) { fail("unknown math." + std::string(f)); return; }
+            expect("(");
+            int argc = 0;
+            if(!is(")")) do { expression(); argc++; } while(ok && accept(","));
+            expect(")");
+            if(argc < kBuiltins[b].minArgs || argc > kBuiltins[b].maxArgs) { fail("wrong argument count for math." + std::string(f)); return; }
+            emit(OpCode::Call, b, argc);
+            return;
+        }
+        if(is("(")) { fail("only math.* functions can be called"); return; }
+        if(accept(".")) {
+            std::string_view f = name();
+            if(!inUpdate || n != mouseName || (f != "x" && f != "y")) { fail("unknown field " + std::string(n) + "." + std::string(f)); return; }
+            emit(OpCode::Load, f == "x" ? kSlotMouseX : kSlotMouseY);
+            return;
+        }
+        emit(OpCode::Load, variable(n));
+    }
+};
+
+} // namespace
+
+bool Compile(std::string_view src, Program &out, std::string &err) {
+    if(src.size() > kMaxSource) { err = "script larger than " + std::to_string(kMaxSource / 1024) + " KB"; return false; }
+    Compiler c(src, out);
+    return c.run(err);
+}
+
+Status Run(const Program &p, uint32_t pc, double *v, uint64_t &rng, uint32_t budget) {
+    double st[kMaxStack];
+    int sp = 0;
+    const Ins *code = p.code.data();
+    const double *k = p.consts.data();
+    for(uint32_t n = 0; n < budget; n++) {
+        const Ins &in = code[pc++];
+        switch(in.op) {
+            case OpCode::Const: st[sp++] = k[in.a]; break;
+            case OpCode::Load: st[sp++] = v[in.a]; break;
+            case OpCode::Store: v[in.a] = st[--sp]; break;
+            case OpCode::Add: sp--; st[sp-1] += st[sp]; break;
+            case OpCode::Sub: sp--; st[sp-1] -= st[sp]; break;
+            case OpCode::Mul: sp--; st[sp-1] *= st[sp]; break;
+            case OpCode::Div: sp--; st[sp-1] /= st[sp]; break;
+            case OpCode::Mod: sp--; st[sp-1] = st[sp-1] - std::floor(st[sp-1] / st[sp]) * st[sp]; break;
+            case OpCode::Pow: sp--; st[sp-1] = std::pow(st[sp-1], st[sp]); break;
+            case OpCode::Neg: st[sp-1] = -st[sp-1]; break;
+            case OpCode::Not: st[sp-1] = st[sp-1] == 0 ? 1 : 0; break;
+            case OpCode::Eq: sp--; st[sp-1] = st[sp-1] == st[sp]; break;
+            case OpCode::Ne: sp--; st[sp-1] = st[sp-1] != st[sp]; break;
+            case OpCode::Lt: sp--; st[sp-1] = st[sp-1] < st[sp]; break;
+            case OpCode::Le: sp--; st[sp-1] = st[sp-1] <= st[sp]; break;
+            case OpCode::Gt: sp--; st[sp-1] = st[sp-1] > st[sp]; break;
+            case OpCode::Ge: sp--; st[sp-1] = st[sp-1] >= st[sp]; break;
+            case OpCode::Jmp: pc = (uint32_t)in.a; break;
+            case OpCode::Jz: if(st[--sp] == 0) pc = (uint32_t)in.a; break;
+            case OpCode::AndJz: if(st[sp-1] == 0) pc = (uint32_t)in.a; else sp--; break;
+            case OpCode::OrJnz: if(st[sp-1] != 0) pc = (uint32_t)in.a; else sp--; break;
+            case OpCode::ForTest: sp -= 2; st[sp-1] = st[sp+1] >= 0 ? st[sp-1] <= st[sp] : st[sp-1] >= st[sp]; break;
+            case OpCode::Call: {
+                int argc = in.argc;
+                double *a = st + sp - argc, r = 0;
+                switch((Builtin)in.a) {
+                    case kSin: r = std::sin(a[0]); break;
+                    case kCos: r = std::cos(a[0]); break;
+                    case kTan: r = std::tan(a[0]); break;
+                    case kAsin: r = std::asin(a[0]); break;
+                    case kAcos: r = std::acos(a[0]); break;
+                    case kAtan: r = argc == 2 ? std::atan2(a[0], a[1]) : std::atan(a[0]); break;
+                    case kAbs: r = std::fabs(a[0]); break;
+                    case kSqrt: r = std::sqrt(a[0]); break;
+                    case kFloor: r = std::floor(a[0]); break;
+                    case kCeil: r = std::ceil(a[0]); break;
+                    case kMin: r = a[0]; for(int i=1;i<argc;i++) if(a[i] < r) r = a[i]; break;
+                    case kMax: r = a[0]; for(int i=1;i<argc;i++) if(a[i] > r) r = a[i]; break;
+                    case kExp: r = std::exp(a[0]); break;
+                    case kLog: r = std::log(a[0]); break;
+                    case kRandom: { // Lua: random() in [0,1), random(m) in 1..m, random(m,n) in m..n
+                        double u = Random01(rng);
+                        if(argc == 0) r = u;
+                        else { double lo = argc == 2 ? a[0] : 1, hi = argc == 2 ? a[1] : a[0]; r = std::floor(lo + u * (std::floor(hi) - lo + 1)); }
+                        break;
+                    }
+                    case kClamp: r = a[0] < a[1] ? a[1] : (a[0] > a[2] ? a[2] : a[0]); break;
+                    case kLerp: r = a[0] + (a[1] - a[0]) * a[2]; break;
+                    default: break;
+                }
+                sp -= argc;
+                st[sp++] = r;
+                break;
+            }
+            case OpCode::Ret: return Status::Ok;
+        }
+    }
+    return Status::OverBudget;
+}
+
+} // namespace swarm_vm
@@ -0,0 +1,67 @@
+// Swarm embedded behavior scripts: Lua-subset compiler + stack bytecode VM
+// A script cursor whose path ends in .lua runs in-process. SwarmManager::updateAll calls every script's
+// update(dt, mouse) as one batch on the update thread, so there is no process, pipe or reader thread and
+// no text `pos` line per frame. The top level runs once when the script loads. Every call has an
+// instruction budget: a call that runs out stops where it is, and the cursor keeps its last position.
+// Language (numbers only; true/false/nil are 1/0/0):
+//   assignment, local, if/elseif/else, while, numeric for, break, return, one `function update(dt, mouse)`
+//   + - * / % ^, == ~= < <= > >=, and/or/not, math.sin/cos/tan/asin/acos/atan/abs/sqrt/floor/ceil/
+//   min/max/exp/log/random, math.clamp/lerp, math.pi/huge
+// Variables persist between frames. Predefined: x, y (position; assign to move), t (seconds since load),
+// id, and the update parameters (dt, mouse.x, mouse.y under whatever names the script declares).
+// No <windows.h>: portable like swarm_command.h.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace swarm_vm {
+
+enum class OpCode : uint8_t {
+    Const, Load, Store,
+    Add, Sub, Mul, Div, Mod, Pow, Neg, Not,
+    Eq, Ne, Lt, Le, Gt, Ge,
+    Jmp, Jz, AndJz, OrJnz, ForTest, // AndJz/OrJnz: short-circuit, keep the operand when jumping
+    Call, Ret
+};
+struct Ins { OpCode op; uint8_t argc; int32_t a; };
+
+// Variable slots every script has; script variables follow
+enum Slot : int { kSlotDt, kSlotMouseX, kSlotMouseY, kSlotX, kSlotY, kSlotT, kSlotId, kFixedSlots };
+
+static const int kMaxStack = 64;
+static const int kMaxNesting = 200; // compiler recursion, blocks and expressions each: stays far inside a 1 MB stack
+static const uint32_t kDefaultBudget = 10000; // instructions per update call (and for the top level)
+static const size_t kMaxSource = 64 * 1024;
+
+struct Program {
+    std::vector<Ins> code;
+    std::vector<double> consts;
+    std::vector<std::string> names; // slot -> variable name
+    uint32_t initPc {0};
+    int32_t updatePc {-1};          // -1: no update function (positions itself once at load)
+};
+
+// Returns false with err = "line N: ..." on unsupported or malformed source
+bool Compile(std::string_view src, Program &out, std::string &err);
+
+enum class Status { Ok, OverBudget };
+// Runs from pc until Ret or until budget instructions have executed
+Status Run(const Program &p, uint32_t pc, double *vars, uint64_t &rng, uint32_t budget);
+
+struct Instance {
+    std::shared_ptr<const Program> prog;
+    std::vector<double> vars;
+    uint64_t rng;
+    double time {0};
+    unsigned long long calls {0}, overBudget {0};
+    Instance(std::shared_ptr<const Program> p, int id)
+        : prog(std::move(p)), vars(prog->names.size(), 0.0), rng(0x9E3779B97F4A7C15ull ^ (uint64_t)id) {
+        vars[kSlotId] = id;
+    }
+};
+
+} // namespace swarm_vm
@@ -6,6 +6,8 @@
 #include <mutex>
 #include <chrono>
 #include <thread>
+#include <cmath>
+#include "swarm_ring.h"
 
 // Helper to write a full string (with trailing \n) to inbound pipe
 bool sendCommand(const std::string &line) {
@@ -32,10 +34,11 @@ struct EventCollector {
     std::vector<std::string> lines; 
     std::mutex m;
     std::thread th;
-    void start() {
+    // filter: optional events/subscribe (and stream/subscribe) lines, written before the reader starts; null = every event
+    void start(const char *filter = nullptr) {
         // Attempt to connect (wait up to ~2s)
         for(int i=0;i<40;i++) {
-            h = CreateFileW(L"\\\\.\\pipe\\SwarmPipeOut", GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+            h = CreateFileW(L"\\\\.\\pipe\\SwarmPipeOut", GENERIC_READ | (filter ? GENERIC_WRITE : 0), 0, nullptr, OPEN_EXISTING, 0, nullptr);
             if(h!=INVALID_HANDLE_VALUE) break;
             std::this_thread::sleep_for(std::chrono::milliseconds(50));
         }
@@ -43,6 +46,10 @@ struct EventCollector {
             std::cerr << "Could not connect to outbound pipe (events will be lost).\n";
             return;
         }
+        if(filter) {
+            std::string line = std::string(filter) + "\n";
+            DWORD written=0; WriteFile(h, line.data(), (DWORD)line.size(), &written, nullptr);
+        }
         running = true;
         th = std::thread([this]{
             std::string buf; char tmp[256]; DWORD read=0;
@@ -69,6 +76,11 @@ struct EventCollector {
 int main() {
     std::cout << "SwarmPipeTest starting...\n";
     EventCollector collector; collector.start();
+    // Second subscriber at the same time: only perf and batch summaries, at most 5 events/s
+    EventCollector summaries; summaries.start("{\"op\":\"events/subscribe\",\"events\":[\"perf\",\"batchDone\"],\"maxHz\":5}");
+    // Third: position stream deltas only (connected below around the binary-frame animation; the stream rate
+    // is this subscriber's and ends when it disconnects)
+    EventCollector stream;
     // Wait for connected event to ensure subsequent add/list events are captured
     int waitMs = 0;
     while(waitMs < 1500) {
@@ -90,8 +102,80 @@ int main() {
         sendCommand(c);
         std::this_thread::sleep_for(std::chrono::milliseconds(120));
     }
+    // Shared-memory ring: one cursor driven by ~20k binary pos records in about a second
+    swarm_ring::Producer ring;
+    if(ring.open()) {
+        const int ringId = 900;
+        ring.add(ringId, 1 /*static*/, 400, 300, 0xFFDD22, 16);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        int pushed = 0, full = 0;
+        for(int i=0;i<20000;i++) {
+            double a = i * 0.002;
+            if(ring.pos(ringId, 600 + (int)(cos(a)*200), 400 + (int)(sin(a)*200))) pushed++; else full++;
+            if(i % 400 == 399) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        double secs = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t0).count();
+        ring.remove(ringId);
+        std::cout << "Ring: pushed " << pushed << " pos records (" << full << " ring-full) at " << (int)(pushed/secs) << "/s\n";
+        ring.close();
+    } else {
+        std::cout << "Ring: overlay mapping not available (skipped).\n";
+    }
+    // Batch envelope: 200-cursor ring formation in one line, one batchDone event back
+    {
+        std::string batch = "{\"op\":\"batch\",\"cmds\":[";
+        for(int i=0;i<200;i++) {
+            double a = i * 6.2831853 / 200;
+            batch += (i ? "," : "") + std::string("{\"op\":\"cursor/add\",\"behavior\":\"static\",\"id\":") + std::to_string(2000+i)
+                   + ",\"x\":" + std::to_string(700 + (int)(cos(a)*250)) + ",\"y\":" + std::to_string(450 + (int)(sin(a)*250)) + ",\"color\":\"#AA66FF\"}";
+        }
+        batch += "]}";
+        auto t0 = std::chrono::high_resolution_clock::now();
+        sendCommand(batch);
+        std::cout << "Batch: 200 adds sent in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now()-t0).count() << " ms\n";
+    }
+    stream.start("{\"op\":\"events/subscribe\",\"events\":[\"frame\"]}\n{\"op\":\"stream/subscribe\",\"hz\":20}");
+    // Binary framing on SwarmPipe: magic, then length-prefixed frames (records + a JSON batch removing the formation)
+    {
+        HANDLE h = CreateFileW(L"\\\\.\\pipe\\SwarmPipe", GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if(h!=INVALID_HANDLE_VALUE) {
+            std::string out(swarm_ring::kPipeMagic, sizeof(swarm_ring::kPipeMagic));
+            std::vector<swarm_ring::Record> recs;
+            for(int step=0;step<50;step++) {
+                recs.clear();
+                for(int i=0;i<200;i++) {
+                    double a = i * 6.2831853 / 200 + step * 0.05;
+                    recs.push_back(swarm_ring::Record{ swarm_ring::kPos, 0, 2000+i, 700 + (int)(cos(a)*250), 450 + (int)(sin(a)*250), 0, 0 });
+                }
+                swarm_ring::AppendFrame(out, swarm_ring::kFrameRecords, recs.data(), (uint32_t)(recs.size()*sizeof(swarm_ring::Record)));
+            }
+            std::string rm = "{\"op\":\"batch\",\"cmds\":[";
+            for(int i=0;i<200;i++) rm += (i ? "," : "") + std::string("{\"op\":\"cursor/remove\",\"id\":") + std::to_string(2000+i) + "}";
+            rm += "]}";
+            swarm_ring::AppendFrame(out, swarm_ring::kFrameCommand, rm.data(), (uint32_t)rm.size());
+            DWORD written=0; BOOL ok = WriteFile(h, out.data(), (DWORD)out.size(), &written, nullptr);
+            CloseHandle(h);
+            std::cout << "Binary: " << (ok ? "sent " : "failed ") << out.size() << " bytes (50 record frames + 1 command frame)\n";
+        } else {
+            std::cerr << "Binary: failed to open inbound pipe. GLE=" << GetLastError() << "\n";
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    stream.stop(); // unsubscribes the stream
+    sendCommand("{\"op\":\"sys/perf\"}");
     std::this_thread::sleep_for(std::chrono::milliseconds(700));
-    collector.stop();
+    collector.stop(); summaries.stop();
+    {
+        std::lock_guard<std::mutex> lock(stream.m);
+        size_t frames = 0, bytes = 0;
+        for(auto &e : stream.lines) if(e.find("\"event\":\"frame\"") != std::string::npos) { frames++; bytes += e.size(); }
+        std::cout << "Stream subscriber got " << frames << " frame events (" << bytes << " bytes)\n";
+    }
+    {
+        std::lock_guard<std::mutex> lock(summaries.m);
+        std::cout << "Filtered subscriber got " << summaries.lines.size() << " events:\n";
+        for(auto &e : summaries.lines) std::cout << "  " << e << '\n';
+    }
     std::lock_guard<std::mutex> lock(collector.m);
     std::cout << "Collected " << collector.lines.size() << " events:\n";
     for(auto &e : collector.lines) std::cout << e << '\n';
@@ -1,23 +1,26 @@
 // Swarm Watchdog
-// Monitors heartbeat file written by swarm overlay (swarm.exe) and restarts
-// the overlay if the process dies or heartbeat becomes stale.
-// Resume bullet: "Implemented self-healing watchdog (heartbeat + auto-restart <2s)."
+// Supervises the overlay (SwarmOverlay.exe) through its shared-memory heartbeat (src/swarm_heartbeat.h)
+// and restarts it if the process dies or the heartbeat goes stale.
+// One WaitForMultipleObjects on {overlay process, periodic timer}: an exit is seen the moment it happens,
+// and each timer tick reads the heartbeat from memory (no disk I/O). The overlay runs in a Job object,
+// so a restart also kills the AutoHotkey script processes it launched, and a crash ends the process
+// instead of leaving it parked behind an error-reporting dialog.
+// Resume bullet: "Implemented self-healing watchdog (heartbeat + auto-restart <1s)."
 
 #include <windows.h>
+#include <algorithm>
 #include <string>
 #include <chrono>
-#include <thread>
-#include <fstream>
-#include <sstream>
 #include <iostream>
+#include "swarm_heartbeat.h"
 
 struct Config {
-    std::string exePath = "swarm.exe";
-    std::string heartbeatFile = "swarm_heartbeat.txt";
+    std::string exePath = "SwarmOverlay.exe";
     std::string stopFile = "swarm_watchdog.stop";
-    int pollIntervalMs = 1000;      // ms between checks
-    int staleThresholdMs = 5000;    // consider stale if older than this
-    int staleRetries = 2;           // consecutive stale detections before restart
+    int pollIntervalMs = 100;       // ms between heartbeat checks
+    int staleThresholdMs = 600;     // stale if the heartbeat or the frame counter is older than this
+    int staleRetries = 2;           // consecutive stale checks before restart
+    int startupGraceMs = 10000;     // time a fresh overlay gets to publish its first heartbeat
 };
 
 static bool fileExists(const std::string &p) {
@@ -25,11 +28,8 @@ static bool fileExists(const std::string &p) {
     return a != INVALID_FILE_ATTRIBUTES && !(a & FILE_ATTRIBUTE_DIRECTORY);
 }
 
-static long long readHeartbeatTs(const std::string &path) {
-    std::ifstream in(path, std::ios::in);
-    if(!in) return -1;
-    std::string line; if(!std::getline(in,line)) return -1;
-    std::stringstream ss(line); long long v=-1; ss>>v; return v;
+static long long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
 static std::string nowStr() {
@@ -46,62 +46,106 @@ int main(int argc,char *argv[]) {
         std::string a = argv[i];
         auto next=[&](std::string &dst){ if(i+1<argc) dst = argv[++i]; };
         if(a=="--exe") next(cfg.exePath);
-        else if(a=="--heartbeat") next(cfg.heartbeatFile);
         else if(a=="--interval") { std::string v; next(v); cfg.pollIntervalMs = atoi(v.c_str()); }
         else if(a=="--staleMs") { std::string v; next(v); cfg.staleThresholdMs = atoi(v.c_str()); }
         else if(a=="--stopFile") next(cfg.stopFile);
         else if(a=="--retries") { std::string v; next(v); cfg.staleRetries = atoi(v.c_str()); }
+        else if(a=="--graceMs") { std::string v; next(v); cfg.startupGraceMs = atoi(v.c_str()); }
         else if(a=="--help" || a=="-h") {
-            std::cout << "Usage: swarm_watchdog.exe [--exe swarm.exe] [--heartbeat swarm_heartbeat.txt]\n"
-                      << "       [--interval 1000] [--staleMs 5000] [--retries 2] [--stopFile swarm_watchdog.stop]\n";
+            std::cout << "Usage: swarm_watchdog.exe [--exe SwarmOverlay.exe] [--interval 100] [--staleMs 600]\n"
+                      << "       [--retries 2] [--graceMs 10000] [--stopFile swarm_watchdog.stop]\n";
             return 0;
         }
     }
     if(cfg.staleRetries < 1) cfg.staleRetries = 1;
-    std::cout << "[watchdog] start exe=" << cfg.exePath << " heartbeat=" << cfg.heartbeatFile
-              << " intervalMs=" << cfg.pollIntervalMs << " staleMs=" << cfg.staleThresholdMs
-              << " retries=" << cfg.staleRetries << "\n";
+    if(cfg.pollIntervalMs < 10) cfg.pollIntervalMs = 10;
+    std::cout << "[watchdog] start exe=" << cfg.exePath << " intervalMs=" << cfg.pollIntervalMs
+              << " staleMs=" << cfg.staleThresholdMs << " retries=" << cfg.staleRetries
+              << " graceMs=" << cfg.startupGraceMs << "\n";
+
+    swarm_hb::Block hb;
+    if(!hb.open()) { std::cout << "[watchdog] heartbeat mapping failed gle=" << GetLastError() << "\n"; return 1; }
+
+    // Not KILL_ON_JOB_CLOSE: stopping the watchdog leaves the overlay running
+    HANDLE job = CreateJobObjectA(nullptr, nullptr);
+    if(job) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION li{};
+        li.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_DIE_ON_UNHANDLED_EXCEPTION;
+        SetInformationJobObject(job, JobObjectExtendedLimitInformation, &li, sizeof(li));
+    } else {
+        std::cout << "[watchdog] CreateJobObject failed gle=" << GetLastError() << " (restarts kill the overlay only)\n";
+    }
+
+    HANDLE timer = CreateWaitableTimerW(nullptr, FALSE, nullptr);
+    LARGE_INTEGER due; due.QuadPart = -10000LL * cfg.pollIntervalMs;
+    if(!timer || !SetWaitableTimer(timer, &due, cfg.pollIntervalMs, nullptr, nullptr, FALSE)) {
+        std::cout << "[watchdog] waitable timer failed gle=" << GetLastError() << "\n";
+        return 1;
+    }
 
     PROCESS_INFORMATION pi{}; STARTUPINFOA si{}; si.cb = sizeof(si);
+    long long launchedAt = 0;
+    swarm_hb::Progress progress;
+    bool sawHeartbeat = false;
     auto closeHandles=[&](){ if(pi.hProcess){ CloseHandle(pi.hProcess); pi.hProcess=nullptr;} if(pi.hThread){ CloseHandle(pi.hThread); pi.hThread=nullptr;} };
     auto launch=[&](){
         if(pi.hProcess) return; // already running
         std::string cmd = cfg.exePath; // mutable buffer for CreateProcess
-        if(CreateProcessA(nullptr, cmd.data(), nullptr,nullptr,FALSE, CREATE_NO_WINDOW, nullptr,nullptr,&si,&pi)) {
-            std::cout << "[watchdog] launched pid=" << pi.dwProcessId << " @" << nowStr() << "\n";
-        } else {
+        // Suspended until it is in the job, so nothing it spawns can escape
+        if(!CreateProcessA(nullptr, cmd.data(), nullptr,nullptr,FALSE, CREATE_NO_WINDOW | CREATE_SUSPENDED, nullptr,nullptr,&si,&pi)) {
             std::cout << "[watchdog] CreateProcess failed gle=" << GetLastError() << "\n";
+            return;
         }
+        if(job && !AssignProcessToJobObject(job, pi.hProcess))
+            std::cout << "[watchdog] AssignProcessToJobObject failed gle=" << GetLastError() << "\n";
+        ResumeThread(pi.hThread);
+        launchedAt = nowMs(); sawHeartbeat = false; progress.reset();
+        std::cout << "[watchdog] launched pid=" << pi.dwProcessId << " @" << nowStr() << "\n";
+    };
+    auto kill=[&](){
+        if(!pi.hProcess) return;
+        if(!job || !TerminateJobObject(job, 1)) TerminateProcess(pi.hProcess, 1);
+        WaitForSingleObject(pi.hProcess, 1500);
+        closeHandles();
     };
 
+    launch();
     int staleCount = 0;
     while(true) {
-        if(fileExists(cfg.stopFile)) { std::cout << "[watchdog] stop file -> exit\n"; break; }
-        DWORD wait = WAIT_TIMEOUT;
-        if(pi.hProcess) wait = WaitForSingleObject(pi.hProcess, 0);
-        if(!pi.hProcess || wait == WAIT_OBJECT_0) {
-            if(wait == WAIT_OBJECT_0) {
-                std::cout << "[watchdog] overlay exited -> restart\n";
-                closeHandles();
-            }
+        HANDLE waits[2] = { timer, pi.hProcess };
+        DWORD w = WaitForMultipleObjects(pi.hProcess ? 2 : 1, waits, FALSE, INFINITE);
+        if(w == WAIT_OBJECT_0 + 1) {
+            DWORD code = 0; GetExitCodeProcess(pi.hProcess, &code);
+            std::cout << "[watchdog] overlay exited code=" << code << " -> restart @" << nowStr() << "\n";
+            closeHandles();
             launch();
             staleCount = 0;
+            continue;
+        }
+        if(w != WAIT_OBJECT_0) { std::cout << "[watchdog] wait failed gle=" << GetLastError() << "\n"; break; }
+
+        if(fileExists(cfg.stopFile)) { std::cout << "[watchdog] stop file -> exit\n"; break; }
+        if(!pi.hProcess) { launch(); staleCount = 0; continue; } // CreateProcess failed last time
+
+        long long now = nowMs();
+        swarm_hb::Sample s{};
+        bool ours = hb.read(s) && s.pid == pi.dwProcessId; // the block outlives an overlay: skip the previous one's
+        bool stale;
+        long long age;
+        if(!ours) {
+            age = now - launchedAt;
+            stale = sawHeartbeat || age > cfg.startupGraceMs;
+        } else {
+            sawHeartbeat = true;
+            age = progress.age(s, now); // frames, or idle polls while the overlay idles
+            stale = age > cfg.staleThresholdMs;
         }
-        long long ts = readHeartbeatTs(cfg.heartbeatFile);
-        long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count();
-        bool stale = (ts < 0) || (nowMs - ts > cfg.staleThresholdMs);
         if(stale) {
             staleCount++;
-            std::cout << "[watchdog] stale heartbeat age=" << (ts<0? -1 : (nowMs - ts))
-                      << "ms count=" << staleCount << " @" << nowStr() << "\n";
+            std::cout << "[watchdog] stale heartbeat age=" << age << "ms count=" << staleCount << " @" << nowStr() << "\n";
             if(staleCount >= cfg.staleRetries) {
-                if(pi.hProcess) {
-                    std::cout << "[watchdog] restarting overlay (stale)\n";
-                    TerminateProcess(pi.hProcess, 0);
-                    WaitForSingleObject(pi.hProcess, 1500);
-                    closeHandles();
-                }
+                std::cout << "[watchdog] restarting overlay (stale)\n";
+                kill();
                 launch();
                 staleCount = 0;
             }
@@ -109,8 +153,9 @@ int main(int argc,char *argv[]) {
             std::cout << "[watchdog] heartbeat recovered\n";
             staleCount = 0;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(cfg.pollIntervalMs));
     }
     closeHandles();
+    CloseHandle(timer);
+    if(job) CloseHandle(job);
     return 0;
 }
@@ -0,0 +1,65 @@
+// swarm_hb::Progress: the watchdog's staleness rule (src/watchdog.cpp), driven by synthetic samples.
+// An overlay parked in the idle gate draws no frames but keeps polling; only a wedged one goes stale.
+#include <cstdio>
+#include "swarm_heartbeat.h"
+
+static int gFailures = 0;
+#define CHECK(cond) do { if(!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); gFailures++; } } while(0)
+
+static const int64_t kStaleMs = 600; // watchdog default --staleMs
+
+int main() {
+    // Active: frames advance every heartbeat
+    {
+        swarm_hb::Progress p; swarm_hb::Sample s {};
+        for(int64_t t = 0; t < 5000; t += swarm_hb::kPublishMs) {
+            s.epochMs = t; s.frame += 6;
+            CHECK(p.age(s, t) <= kStaleMs);
+        }
+    }
+    // Idle: the frame counter stops, idle polls (every 100 ms) keep advancing
+    {
+        swarm_hb::Progress p; swarm_hb::Sample s {};
+        s.frame = 1234; s.idle = 1;
+        for(int64_t t = 0; t < 10000; t += swarm_hb::kPublishMs) {
+            s.epochMs = t; s.idlePolls++;
+            CHECK(p.age(s, t) <= kStaleMs);
+        }
+    }
+    // Active -> idle -> active: the switch itself is progress, not a stall
+    {
+        swarm_hb::Progress p; swarm_hb::Sample s {};
+        int64_t t = 0, worst = 0;
+        for(int i = 0; i < 30; i++, t += swarm_hb::kPublishMs) { s.epochMs = t; s.frame += 6; worst = std::max(worst, p.age(s, t)); }
+        s.idle = 1;
+        for(int i = 0; i < 30; i++, t += swarm_hb::kPublishMs) { s.epochMs = t; s.idlePolls++; worst = std::max(worst, p.age(s, t)); }
+        s.idle = 0;
+        for(int i = 0; i < 30; i++, t += swarm_hb::kPublishMs) { s.epochMs = t; s.frame += 6; worst = std::max(worst, p.age(s, t)); }
+        CHECK(worst <= kStaleMs);
+    }
+    // Wedged UpdateThread: the heartbeat thread still publishes, but neither counter moves
+    {
+        swarm_hb::Progress p; swarm_hb::Sample s {};
+        s.frame = 50; s.idlePolls = 7;
+        s.epochMs = 0; CHECK(p.age(s, 0) == 0);
+        s.epochMs = 1000; CHECK(p.age(s, 1000) == 1000);
+        s.idle = 1; // wedged in the idle gate is also stale
+        s.epochMs = 2000; CHECK(p.age(s, 2000) > kStaleMs);
+    }
+    // Heartbeat thread stopped: the last sample ages even if its counters just moved
+    {
+        swarm_hb::Progress p; swarm_hb::Sample s {};
+        s.epochMs = 0; s.frame = 1; p.age(s, 0);
+        s.frame = 2; CHECK(p.age(s, 900) == 900);
+    }
+    // reset() (a relaunch) forgets the previous overlay's counters
+    {
+        swarm_hb::Progress p; swarm_hb::Sample s {};
+        s.epochMs = 0; s.frame = 99; p.age(s, 0);
+        p.reset();
+        s.epochMs = 5000; CHECK(p.age(s, 5000) == 0);
+    }
+    if(gFailures) { printf("heartbeat_test: %d failure(s)\n", gFailures); return 1; }
+    printf("heartbeat_test: ok\n");
+    return 0;
+}
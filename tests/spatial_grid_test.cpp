@@ -0,0 +1,102 @@
+// SpatialGrid (src/swarm_manager.h): radius queries against a brute-force scan, and the nearest-first
+// order flockStepLocked relies on when it stops after kFlockMaxCandidates neighbors.
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <set>
+#include "swarm_manager.h"
+
+static int gFailures = 0;
+#define CHECK(cond) do { if(!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); gFailures++; } } while(0)
+
+using Hit = std::pair<uint32_t, uint32_t>; // lane, index
+
+static void Fill(std::vector<CursorLane> &lanes, std::mt19937 &rng, size_t n, float lo, float hi) {
+    std::uniform_real_distribution<float> u(lo, hi);
+    for(size_t i=0;i<n;i++) {
+        SwarmCursor c; c.id = (int)i + 1; c.pos = POINT{ 0, 0 }; c.size = 10;
+        lanes[i % lanes.size()].push(c);
+        CursorLane &l = lanes[i % lanes.size()];
+        l.x.back() = u(rng); l.y.back() = u(rng); // sub-pixel positions, as the simulation produces
+    }
+}
+
+int main() {
+    std::mt19937 rng(12345);
+    // Query results (after the exact distance check) equal a brute-force scan, for both visit orders,
+    // across cell sizes, radii and negative coordinates
+    for(float cellSize : { 16.0f, 64.0f, 200.0f }) {
+        std::vector<CursorLane> lanes(3);
+        Fill(lanes, rng, 3000, -1500.0f, 1500.0f);
+        SpatialGrid g;
+        g.build((int)lanes.size(), [&](int k) -> const CursorLane& { return lanes[k]; }, 3000, cellSize);
+        std::uniform_real_distribution<float> q(-1600.0f, 1600.0f), rr(1.0f, 300.0f);
+        for(int t=0;t<300;t++) {
+            float x = q(rng), y = q(rng), r = rr(rng);
+            std::set<Hit> brute, grid, nearest;
+            for(uint32_t k=0;k<lanes.size();k++)
+                for(uint32_t i=0;i<lanes[k].count();i++) {
+                    float dx = lanes[k].x[i] - x, dy = lanes[k].y[i] - y;
+                    if(dx*dx + dy*dy < r*r) brute.insert(Hit{ k, i });
+                }
+            auto collect = [&](std::set<Hit> &out) { return [&, x, y, r](const SpatialGrid::Entry &e) {
+                float dx = e.x - x, dy = e.y - y;
+                if(dx*dx + dy*dy < r*r) CHECK(out.insert(Hit{ e.lane, e.index }).second); // each entry once
+                return true;
+            }; };
+            g.query(x, y, r, collect(grid));
+            g.queryNearest(x, y, r, collect(nearest));
+            CHECK(grid == brute);
+            CHECK(nearest == brute);
+        }
+    }
+    // queryNearest visits cells in non-decreasing distance, starting with the cell holding the point
+    {
+        std::vector<CursorLane> lanes(1);
+        Fill(lanes, rng, 4000, 0.0f, 1000.0f);
+        SpatialGrid g;
+        g.build(1, [&](int) -> const CursorLane& { return lanes[0]; }, 4000, 50.0f);
+        for(int t=0;t<200;t++) {
+            float x = 100.0f + (float)(rng() % 800), y = 100.0f + (float)(rng() % 800), r = 90.0f;
+            float prev = -1; bool first = true;
+            g.queryNearest(x, y, r, [&](const SpatialGrid::Entry &e) {
+                float lx = e.cx * g.cell, ly = e.cy * g.cell;
+                float dx = std::max({ lx - x, 0.0f, x - lx - g.cell }), dy = std::max({ ly - y, 0.0f, y - ly - g.cell });
+                float d2 = dx*dx + dy*dy;
+                if(first) { CHECK(e.cx == g.cellOf(x) && e.cy == g.cellOf(y)); first = false; d2 = -1; }
+                CHECK(d2 + 1e-3f >= prev);
+                prev = d2;
+                return true;
+            });
+        }
+    }
+    // Dense pile, capped at kFlockMaxCandidates: the neighbors seen surround the boid instead of lying
+    // up-left of it (the bias of row-order cells with an early stop)
+    {
+        std::vector<CursorLane> lanes(1);
+        Fill(lanes, rng, 5000, 0.0f, 300.0f);
+        SpatialGrid g;
+        g.build(1, [&](int) -> const CursorLane& { return lanes[0]; }, 5000, 60.0f);
+        double meanX = 0, meanY = 0; int samples = 0;
+        const CursorLane &l = lanes[0];
+        for(uint32_t i=0;i<l.count();i++) {
+            float x = l.x[i], y = l.y[i], r = 60.0f;
+            if(x < 80 || x > 220 || y < 80 || y > 220) continue; // away from the pile's edge
+            int visited = 0; double sx = 0, sy = 0;
+            g.queryNearest(x, y, r, [&](const SpatialGrid::Entry &e) {
+                if(e.index == i) return true;
+                if(++visited > SwarmManager::kFlockMaxCandidates) return false;
+                sx += e.x - x; sy += e.y - y;
+                return true;
+            });
+            CHECK(visited > SwarmManager::kFlockMaxCandidates); // the pile fills the cap
+            meanX += sx / SwarmManager::kFlockMaxCandidates; meanY += sy / SwarmManager::kFlockMaxCandidates; samples++;
+        }
+        meanX /= samples; meanY /= samples;
+        printf("pile: %d boids, mean neighbor offset (%.2f, %.2f) px\n", samples, meanX, meanY);
+        CHECK(std::fabs(meanX) < 3.0 && std::fabs(meanY) < 3.0);
+    }
+    if(gFailures) { printf("spatial_grid_test: %d failure(s)\n", gFailures); return 1; }
+    printf("spatial_grid_test: ok\n");
+    return 0;
+}